@@ -12,8 +12,248 @@
 #include "exceptions.hpp"
 #include <cstdlib>
 #include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <string>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "parallel_task.hpp"
+#include "pool_allocator.hpp"
+#include "simd.hpp"
+#include "stats.hpp"
 
-template<class T, typename KeyType> class AVLTree {
+//
+//	Class		: NoAugmentation
+//	Description : Default node augmentation of AVLTree, keeps nothing.
+//					An augmentation is a base class of the tree nodes, which
+//					keeps data computed from the node's subtree. It's
+//					Update method is called with the node's sons every time
+//					the node's heights are updated (links, rotations and
+//					deletes). PROPAGATE tells whether the data of every
+//					ancestor of a changed node must be updated, even when
+//					it's height is unchanged.
+//
+struct NoAugmentation {
+	static const bool PROPAGATE = false;
+
+	template<class NodeType>
+	void Update(NodeType*, NodeType*) {
+	}
+};
+
+//
+//	Class		: OrderStatisticAugmentation
+//	Description : Keeps the number of nodes in the node's subtree, which
+//					lets the tree answer Select, Rank and CountInRange in
+//					O(log n).
+//
+struct OrderStatisticAugmentation {
+	static const bool PROPAGATE = true;
+
+	int _subtree_size;
+
+	OrderStatisticAugmentation() :
+			_subtree_size(1) {
+	}
+
+	template<class NodeType>
+	void Update(NodeType* left, NodeType* right) {
+		_subtree_size = 1 + subtreeSize(left) + subtreeSize(right);
+	}
+
+	// Name			: subtreeSize
+	// Description	: Returns the number of nodes in the subtree of the given
+	//					node.
+	// Parameters	:
+	//	@node - the subtree root, may be NULL
+	// Return Value : the subtree size, 0 for NULL
+	static int subtreeSize(const OrderStatisticAugmentation* node) {
+		return (node == NULL) ? 0 : node->_subtree_size;
+	}
+};
+
+//
+//	Class		: IsTransparent
+//	Description : Tells whether a hash or compare functor declares
+//					is_transparent, that is it takes the key-like types of
+//					it's key type as well as the keys.
+//
+template<class T> struct VoidType {
+	typedef void type;
+};
+
+template<class Functor, class Enable = void> struct IsTransparent: std::false_type {
+};
+
+template<class Functor> struct IsTransparent<Functor,
+		typename VoidType<typename Functor::is_transparent>::type> : std::true_type {
+};
+
+//
+//	Class		: TransparentKeys
+//	Description : Tells whether the keys of a tree can be compared with
+//					other key-like types (<, > and ==) without converting
+//					them. DefaultCompare is transparent for such keys, so
+//					a std::string tree is searched with a const char* (or a
+//					std::string_view) without allocating a string.
+//					Specialize it for other key types.
+//
+template<class KeyType> struct TransparentKeys: std::false_type {
+};
+
+template<> struct TransparentKeys<std::string> : std::true_type {
+};
+
+struct TransparentTag {
+	typedef void is_transparent;
+};
+
+struct OpaqueTag {
+};
+
+//
+//	Class		: DefaultCompare
+//	Description : Default comparator of AVLTree, orders the keys by
+//					operator<. A comparator is a functor class, invoked as
+//					compare(a, b), which either returns a bool for a < b,
+//					or is a three-way comparator returning a value which
+//					is negative, zero or positive as a is less than, equal
+//					to or greater than b (an int in the style of strcmp, or
+//					the result of operator<=>). A node visit of a search
+//					costs one call of a three-way comparator, and up to two
+//					calls of a bool one.
+//
+template<class KeyType> struct DefaultCompare: std::conditional<
+		TransparentKeys<KeyType>::value, TransparentTag, OpaqueTag>::type {
+	template<class A, class B>
+	bool operator()(const A& a, const B& b) const {
+		return a < b;
+	}
+};
+
+//
+//	Class		: StringCompare
+//	Description : Transparent three-way comparator of std::string keys,
+//					by std::string::compare. It's the DefaultCompare of
+//					std::string, so a string tree reads a node's key once
+//					per visit. The order is that of operator<.
+//
+struct StringCompare: TransparentTag {
+	int operator()(const std::string& a, const std::string& b) const {
+		return a.compare(b);
+	}
+
+	int operator()(const std::string& a, const char* b) const {
+		return a.compare(b);
+	}
+
+	int operator()(const char* a, const std::string& b) const {
+		return reverse(b.compare(a));
+	}
+
+#if __cplusplus >= 201703L
+	int operator()(const std::string& a, std::string_view b) const {
+		return a.compare(b);
+	}
+
+	int operator()(std::string_view a, const std::string& b) const {
+		return reverse(b.compare(a));
+	}
+#endif
+
+	// Name			: reverse
+	// Description	: Returns the order of (b, a) for the order of (a, b),
+	//					without negating, which overflows for INT_MIN.
+	static int reverse(int order) {
+		return (order < 0) - (order > 0);
+	}
+};
+
+template<> struct DefaultCompare<std::string> : StringCompare {
+};
+
+//
+//	Class		: KeyOrder
+//	Description : Calls a comparator of either kind (see DefaultCompare).
+//					Order returns a negative, zero or positive int, Less
+//					returns a < b.
+//
+template<class Compare, class KeyType> class KeyOrder {
+private:
+	typedef typename std::decay<
+			decltype(std::declval<const Compare&>()(
+					std::declval<const KeyType&>(),
+					std::declval<const KeyType&>()))>::type Result;
+
+	template<class A, class B>
+	static int order(const Compare& compare, const A& a, const B& b,
+			std::true_type) {
+		const Result res = compare(a, b);
+		return (res < 0) ? -1 : (0 < res);
+	}
+
+	template<class A, class B>
+	static int order(const Compare& compare, const A& a, const B& b,
+			std::false_type) {
+		return compare(a, b) ? -1 : (compare(b, a) ? 1 : 0);
+	}
+
+	template<class A, class B>
+	static bool less(const Compare& compare, const A& a, const B& b,
+			std::true_type) {
+		return (compare(a, b) < 0);
+	}
+
+	template<class A, class B>
+	static bool less(const Compare& compare, const A& a, const B& b,
+			std::false_type) {
+		return compare(a, b);
+	}
+
+public:
+	// The comparator is three-way unless it returns a bool
+	static const bool THREE_WAY = !std::is_same<Result, bool>::value;
+	typedef std::integral_constant<bool, THREE_WAY> ThreeWay;
+
+	template<class A, class B>
+	static int Order(const Compare& compare, const A& a, const B& b) {
+		return order(compare, a, b, ThreeWay());
+	}
+
+	template<class A, class B>
+	static bool Less(const Compare& compare, const A& a, const B& b) {
+		return less(compare, a, b, ThreeWay());
+	}
+};
+
+//
+//	Class		: IsKeyLike
+//	Description : Selects the key-like overloads of the lookups, for a
+//					transparent comparator and the types which aren't the
+//					key type itself.
+//
+template<class Compare, class KeyType, class Key> struct IsKeyLike: std::integral_constant<
+		bool,
+		IsTransparent<Compare>::value
+				&& !std::is_same<typename std::decay<Key>::type, KeyType>::value> {
+};
+
+template<class T, typename KeyType, class Allocator = std::allocator<T>,
+		class Augmentation = NoAugmentation, class Stats = NoStats,
+		class Compare = DefaultCompare<KeyType> >
+class AVLTree: private Stats, private Compare {
+	//
+	//	Class		: AVLTree
+	//	Description : Stats is the statistics policy (see stats.hpp), and
+	//					Compare orders the keys (see DefaultCompare). The
+	//					tree inherits both, so the empty defaults take no
+	//					space.
+	//
 
 protected:
 
@@ -21,7 +261,7 @@ protected:
 	//	Class		: Node
 	//	Description : AVL Tree node object class
 	//
-	class Node {
+	class Node: public Augmentation {
 	private:
 		KeyType _key;
 		T _data;
@@ -42,11 +282,20 @@ protected:
 						HEIGHT_ZERO), _right_height(HEIGHT_ZERO) {
 		}
 
-		// Node contstructor
-		Node(KeyType key, T data) :
-				_key(key), _data(data), _left(NULL), _right(NULL), _parent(
-						NULL), _left_height(HEIGHT_ZERO), _right_height(
-						HEIGHT_ZERO) {
+		// Node contstructor, the data is constructed in place from the
+		// given arguments
+		template<class ... Args>
+		explicit Node(const KeyType& key, Args&&... args) :
+				_key(key), _data(std::forward<Args>(args)...), _left(NULL),
+						_right(NULL), _parent(NULL), _left_height(HEIGHT_ZERO),
+						_right_height(HEIGHT_ZERO) {
+		}
+
+		template<class ... Args>
+		explicit Node(KeyType&& key, Args&&... args) :
+				_key(std::move(key)), _data(std::forward<Args>(args)...), _left(
+						NULL), _right(NULL), _parent(NULL), _left_height(
+						HEIGHT_ZERO), _right_height(HEIGHT_ZERO) {
 		}
 
 		//
@@ -137,7 +386,7 @@ protected:
 		// Parameters	:
 		//	data - the new data to set
 		// Return Value : none
-		void setData(T & data) {
+		void setData(T const& data) {
 			_data = data;
 		}
 
@@ -166,6 +415,7 @@ protected:
 		// Return Value : None
 		void updateLeftHeight() {
 			_left_height = (_left == NULL) ? 0 : _left->getHeight();
+			this->Update(_left, _right);
 		}
 
 		// Name			: updateRightHeight
@@ -175,6 +425,16 @@ protected:
 		// Return Value : None
 		void updateRightHeight() {
 			_right_height = (_right == NULL) ? 0 : _right->getHeight();
+			this->Update(_left, _right);
+		}
+
+		// Name			: updateAugmentation
+		// Description	: Updates the augmented data of the node from it's
+		//					sons, when it's heights stay the same.
+		// Parameters	: None
+		// Return Value : None
+		void updateAugmentation() {
+			this->Update(_left, _right);
 		}
 		// Name			: getHeight
 		// Description	: This function returns the height of the node.
@@ -250,55 +510,91 @@ protected:
 			return (_parent->getRight() == this);
 		}
 
-		// Name			: swap
-		// Description	: This function swaps between the current node to the
-		// given node.
+		// Name			: resetLinks
+		// Description	: Clears the links, the heights and the augmented data
+		//					of a node which was taken out of it's tree.
+		// Parameters	: None
+		// Return Value	: None
+		void resetLinks(void) {
+			_left = _right = _parent = NULL;
+			_left_height = _right_height = HEIGHT_ZERO;
+			static_cast<Augmentation&>(*this) = Augmentation();
+		}
+
+		// Name			: exchangeWithSuccessor
+		// Description	: Swaps the places of the node and it's successor in
+		//					the tree, by relinking them (the keys and the data
+		//					aren't moved). The heights and the augmented data
+		//					belong to the places, so they're swapped too.
+		//					The caller must update the root if it was the node.
 		// Parameters	:
-		//	@node - the node to swap with
+		//	@next - the successor, the leftmost node of the right subtree.
+		//			The node must have two sons.
 		// Return Value	: None
-		void swap(Node * node) {
-			if (node == NULL) {
+		void exchangeWithSuccessor(Node* next) {
+			if (next == NULL) {
 				throw AVLTreeNullArgException();
 			}
 
-			T temp_data = _data;
-			_data = node->getData();
-			node->setData(temp_data);
+			Node* parent = _parent;
+			Node* left = _left;
+			Node* right = _right;
+			Node* next_parent = next->_parent;
+			Node* next_right = next->_right;
 
-			KeyType temp_key = _key;
-			_key = node->getKey();
-			node->setKey(temp_key);
-		}
+			if (parent != NULL) {
+				if (parent->_left == this) {
+					parent->_left = next;
+				} else {
+					parent->_right = next;
+				}
+			}
+			next->_parent = parent;
+			next->_left = left;
+			left->_parent = next;
+
+			if (right == next) {
+				next->_right = this;
+				_parent = next;
+			} else {
+				next->_right = right;
+				right->_parent = next;
+				next_parent->_left = this;
+				_parent = next_parent;
+			}
+
+			_left = NULL;
+			_right = next_right;
+			if (next_right != NULL) {
+				next_right->_parent = this;
+			}
 
-		// Node destructor
-		~Node() {
+			std::swap(_left_height, next->_left_height);
+			std::swap(_right_height, next->_right_height);
+			std::swap(static_cast<Augmentation&>(*this),
+					static_cast<Augmentation&>(*next));
 		}
 
 		// Name			: getKey
 		// Description	: This function returns the node's key
 		// Parameters	: None
 		// Return Value	: the node's key
-		KeyType getKey(void) {
+		const KeyType& getKey(void) const {
 			return _key;
 		}
-
-		bool operator<(const Node& node) const {
-			return _key < node._key;
-		}
-
-		bool operator>(const Node& node) const {
-			return node < *this;
-		}
-
-		bool operator==(const Node& node) const {
-			return !(*this > node) && !(*this < node);
-		}
 	};
 
 private:
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<
+			Node> NodeAllocator;
+	typedef std::allocator_traits<NodeAllocator> NodeAllocatorTraits;
+
 	Node * root;
+	// The extreme nodes, kept up on every link and unlink
 	Node * minimal;
+	Node * maximal;
 	int size;
+	NodeAllocator node_alloc;
 
 	//
 	// Constants
@@ -311,35 +607,184 @@ private:
 	static const int NEW_NODE_HEIGHT = 1;
 	static const int INITIAL_SIZE = 0;
 	static const int UNBALANCED_TREE = 2;
-	static const int POWER_TWO = 2;
-	/*
-	 int pow(int base, int exp){
-	 int res = 1;
-	 while (exp != 0) res *= base;
-
-	 return res;
-	 }
-	 */
-	// Name			: recursiveFind
-	// Description	: Searches a given key recursively from the given tree node
-	// Parameters	:
-	//	@current - the node to start from
-	//	@key - the key to find
+	// Trees smaller than this aren't split between threads
+	static const int PARALLEL_MIN_NODES = 1 << 14;
+	static const int PARALLEL_SUBTREES_PER_THREAD = 4;
+	static const int PARALLEL_MAX_DEPTH = 16;
+	// Name			: createNode
+	// Description	: Allocates and constructs a new node with the tree's
+	//					allocator.
+	// Parameters	:
+	//	@args - the arguments of the Node constructor
+	// Return Value : pointer to the new node
+	template<class ... Args>
+	Node* createNode(Args&&... args) {
+		Node* node = NodeAllocatorTraits::allocate(node_alloc, 1);
+		try {
+			NodeAllocatorTraits::construct(node_alloc, node,
+					std::forward<Args>(args)...);
+		} catch (...) {
+			NodeAllocatorTraits::deallocate(node_alloc, node, 1);
+			throw;
+		}
+		Stats::RecordMemory(1, (long long) sizeof(Node));
+		return node;
+	}
+
+	// Name			: destroyNode
+	// Description	: Destructs a node and returns it's memory to the tree's
+	//					allocator.
+	// Parameters	:
+	//	@node - the node to destroy
+	// Return Value : None
+	void destroyNode(Node* node) {
+		NodeAllocatorTraits::destroy(node_alloc, node);
+		NodeAllocatorTraits::deallocate(node_alloc, node, 1);
+		Stats::RecordMemory(-1, -(long long) sizeof(Node));
+	}
+
+	// Name			: compareKeys
+	// Description	: Orders two keys by the comparator, with one call of a
+	//					three-way comparator.
+	// Parameters	:
+	//	@a - a key, or a key-like object
+	//	@b - a key, or a key-like object
+	// Return Value : negative, zero or positive as a is less than, equal to
+	//					or greater than b
+	template<class A, class B>
+	int compareKeys(const A& a, const B& b) const {
+		return KeyOrder<Compare, KeyType>::Order(
+				static_cast<const Compare&>(*this), a, b);
+	}
+
+	// Name			: lessKeys
+	// Description	: Tests if a key is less than another by the comparator
+	// Parameters	:
+	//	@a - a key, or a key-like object
+	//	@b - a key, or a key-like object
+	// Return Value : true if a is less than b
+	template<class A, class B>
+	bool lessKeys(const A& a, const B& b) const {
+		return KeyOrder<Compare, KeyType>::Less(
+				static_cast<const Compare&>(*this), a, b);
+	}
+
+	// Name			: findNode
+	// Description	: Searches a given key from the root of the tree
+	// Parameters	:
+	//	@key - the key to find, or a key-like object (see TransparentKeys)
 	// Return Value : If the key was found, the suitable node will be returned,
 	//				  otherwise, NULL.
-	Node * recursiveFind(Node * current, KeyType key) {
-		if (current == NULL) {
-			return NULL;
+	template<class Key>
+	Node * findNode(const Key& key) const {
+		Node* current = root;
+		int length = 0;
+
+		while (current != NULL) {
+			length++;
+			int order = compareKeys(key, current->getKey());
+			if (order < 0) {
+				current = current->getLeft();
+			} else if (order > 0) {
+				current = current->getRight();
+			} else {
+				break;
+			}
 		}
+		Stats::RecordSearch(length);
+		return current;
+	}
 
-		if (current->getKey() > key) {
-			return recursiveFind(current->getLeft(), key);
-		} else if (current->getKey() < key) {
-			return recursiveFind(current->getRight(), key);
-		} else {
-			return current;
+	// Name			: lowerBoundNode
+	// Description	: Searches the first node whose key isn't less than the
+	//					given key (or greater than it, for an upper bound).
+	// Parameters	:
+	//	@key	- the bound
+	//	@upper	- true for the first key greater than the bound
+	// Return Value : the node, or NULL if all the keys are smaller
+	Node* lowerBoundNode(const KeyType& key, bool upper) const {
+		Node* current = root;
+		Node* res = NULL;
+
+		while (current != NULL) {
+			bool goes_left = (upper == true) ?
+					lessKeys(key, current->getKey()) :
+					!lessKeys(current->getKey(), key);
+			if (goes_left == true) {
+				res = current;
+				current = current->getLeft();
+			} else {
+				current = current->getRight();
+			}
+		}
+		return res;
+	}
+
+	// Name			: leftmost
+	// Description	: Returns the node with the minimal key in a subtree
+	// Parameters	:
+	//	@node - the subtree root
+	// Return Value : The leftmost node, or NULL for an empty subtree
+	static Node* leftmost(Node* node) {
+		if (node != NULL) {
+			while (node->getLeft() != NULL) {
+				node = node->getLeft();
+			}
+		}
+		return node;
+	}
+
+	// Name			: rightmost
+	// Description	: Returns the node with the maximal key in a subtree
+	// Parameters	:
+	//	@node - the subtree root
+	// Return Value : The rightmost node, or NULL for an empty subtree
+	static Node* rightmost(Node* node) {
+		if (node != NULL) {
+			while (node->getRight() != NULL) {
+				node = node->getRight();
+			}
+		}
+		return node;
+	}
+
+	// Name			: successor
+	// Description	: Returns the next node in order, using the parent links
+	// Parameters	:
+	//	@node - the current node
+	// Return Value : The next node, or NULL if the node is the last one
+	static Node* successor(Node* node) {
+		if (node->getRight() != NULL) {
+			return leftmost(node->getRight());
+		}
+
+		Node* parent = node->getParent();
+		while (parent != NULL && parent->getRight() == node) {
+			node = parent;
+			parent = parent->getParent();
+		}
+		return parent;
+	}
+
+	// Name			: predecessor
+	// Description	: Returns the previous node in order, using the parent
+	//					links
+	// Parameters	:
+	//	@node - the current node
+	// Return Value : The previous node, or NULL if the node is the first one
+	static Node* predecessor(Node* node) {
+		if (node->getLeft() != NULL) {
+			return rightmost(node->getLeft());
 		}
+
+		Node* parent = node->getParent();
+		while (parent != NULL && parent->getLeft() == node) {
+			node = parent;
+			parent = parent->getParent();
+		}
+		return parent;
 	}
+
 	// Name			: rotateLL
 	// Description	: Makes a LL rotation
 	// Parameters	:
@@ -436,121 +881,342 @@ private:
 	// 	if so, it makes the rotation.
 	// Parameters	:
 	//		@node - the tested node
-	// Return Value : None
-	void rotate(Node * node) {
+	// Return Value : The root of the subtree after the rotation (the node
+	//	itself if no rotation occured).
+	Node* rotate(Node * node) {
 		if (node->getBalance() == UNBALANCED_FACTOR) {
 			if (node->getLeft()->getBalance() >= UNBALANCED_FACTOR_SON_ZERO) {
-				rotateLL(node);
+				Stats::RecordRotation();
+				return rotateLL(node);
 			} else if (node->getLeft()->getBalance()
 					== UNBALANCED_FACTOR_SON_NEGATIVE) {
-				rotateLR(node);
+				Stats::RecordRotation();
+				return rotateLR(node);
 			}
 		} else if (node->getBalance() == UNBALANCED_FACTOR_NEGATIVE) {
 			if (node->getRight()->getBalance() == UNBALANCED_FACTOR_SON) {
-				rotateRL(node);
+				Stats::RecordRotation();
+				return rotateRL(node);
 			} else if (node->getRight()->getBalance()
 					<= UNBALANCED_FACTOR_SON_ZERO) {
-				rotateRR(node);
+				Stats::RecordRotation();
+				return rotateRR(node);
 			}
 		}
+		return node;
 	}
 
-	// Name			: recursiveInsert
-	// Description	: Insert a given node recursively to the tree.
+	// Name			: retrace
+	// Description	: Walks from the given node up to the root, updates the
+	//					heights and rotates unbalanced nodes. The walk stops
+	//					when a subtree keeps it's old height, since no height
+	//					above it changes (the remaining ancestors only update
+	//					their augmented data, if the augmentation needs it).
 	// Parameters	:
-	//		@current - starting node
-	// 	@to_insert - the inserted node
+	//	@node		- the lowest node whose subtree was changed
+	//	@old_height	- the height of that node before the change
 	// Return Value : None
-	void recursiveInsert(Node * current, Node * to_insert) {
-		if (current->isLeaf() == true) {
-			if (*current < *to_insert) {
-				current->setRight(to_insert);
-			} else {
-				current->setLeft(to_insert);
-			}
-			to_insert->setParent(current);
-		} else if (current->isFull() == true) {
-			if (*current < *to_insert) {
-				recursiveInsert(current->getRight(), to_insert);
-				current->updateRightHeight();
-			} else {
-				recursiveInsert(current->getLeft(), to_insert);
-				current->updateRightHeight();
+	void retrace(Node* node, int old_height) {
+		while (node != NULL) {
+			node->updateLeftHeight();
+			node->updateRightHeight();
+
+			// The rotation updates the parent's heights, so it's old height
+			// is taken first
+			Node* parent = node->getParent();
+			int parent_height = (parent == NULL) ? 0 : parent->getHeight();
+
+			if (rotate(node)->getHeight() == old_height) {
+				propagateAugmentation(parent);
+				return;
 			}
-		} else if (current->getLeft() != NULL) {
-			if (*to_insert > *current) {
-				current->setRight(to_insert);
-				to_insert->setParent(current);
+			node = parent;
+			old_height = parent_height;
+		}
+	}
+
+	// Name			: propagateAugmentation
+	// Description	: Updates the augmented data from the given node up to
+	//					the root. Does nothing for augmentations that don't
+	//					depend on the whole subtree.
+	// Parameters	:
+	//	@node - the lowest node to update
+	// Return Value : None
+	void propagateAugmentation(Node* node) {
+		if (Augmentation::PROPAGATE == false) {
+			return;
+		}
+		for (; node != NULL; node = node->getParent()) {
+			node->updateAugmentation();
+		}
+	}
+
+	// Name			: findInsertPosition
+	// Description	: Searches the given key, and the place where a node with
+	//					that key would be linked if it's missing.
+	// Parameters	:
+	//	@key		- the key
+	//	@parent		- receives the parent of the new node (NULL for root)
+	//	@left_son	- receives whether the new node is a left son
+	// Return Value : The node which holds the key, NULL if it's missing
+	Node* findInsertPosition(const KeyType& key, Node** parent,
+			bool* left_son) const {
+		Node* current = root;
+		int length = 0;
+
+		*parent = NULL;
+		*left_son = false;
+		while (current != NULL) {
+			length++;
+			*parent = current;
+			int order = compareKeys(key, current->getKey());
+			if (order < 0) {
+				current = current->getLeft();
+				*left_son = true;
+			} else if (order > 0) {
+				current = current->getRight();
+				*left_son = false;
 			} else {
-				recursiveInsert(current->getLeft(), to_insert);
-				current->updateLeftHeight();
+				break;
 			}
+		}
+		Stats::RecordSearch(length);
+		return current;
+	}
+
+	// Name			: linkNode
+	// Description	: Links a new node at the place found by
+	//					findInsertPosition, and rebalances the path on the
+	//					way up.
+	// Parameters	:
+	//	@node		- the new node, which has no links
+	//	@parent		- the parent of the new node (NULL for root)
+	//	@left_son	- whether the new node is a left son
+	// Return Value : None
+	void linkNode(Node* node, Node* parent, bool left_son) {
+		size++;
+
+		if (parent == NULL) {
+			root = node;
+			minimal = node;
+			maximal = node;
 		} else {
-			if (*to_insert < *current) {
-				current->setLeft(to_insert);
-				to_insert->setParent(current);
+			int old_height = parent->getHeight();
+			node->setParent(parent);
+			// A new extreme is always a son of the old one, and rotations
+			// don't change the order of the nodes
+			if (left_son == true) {
+				parent->setLeft(node);
+				if (parent == minimal) {
+					minimal = node;
+				}
 			} else {
-				recursiveInsert(current->getRight(), to_insert);
-				current->updateRightHeight();
+				parent->setRight(node);
+				if (parent == maximal) {
+					maximal = node;
+				}
 			}
+			retrace(parent, old_height);
+		}
+	}
+
+	// Name			: insertKey
+	// Description	: Inserts a new node with the given key, unless the key
+	//					already exists. The tree is traversed once down, and
+	//					the path is rebalanced on the way up. The data is
+	//					constructed only if the node is created.
+	// Parameters	:
+	//	@key		- the key of the new node
+	//	@inserted	- set to true if a new node was created, false if the
+	//					key already existed
+	//	@args		- the arguments of the data constructor
+	// Return Value : The node which holds the key
+	template<class Key, class ... Args>
+	Node* insertKey(Key&& key, bool* inserted, Args&&... args) {
+		Node* parent;
+		bool left_son;
+
+		Node* current = findInsertPosition(key, &parent, &left_son);
+		Stats::RecordInsert(current == NULL);
+		if (current != NULL) {
+			*inserted = false;
+			return current;
 		}
 
-		rotate(current);
+		Node* node = createNode(std::forward<Key>(key),
+				std::forward<Args>(args)...);
+		*inserted = true;
+		linkNode(node, parent, left_son);
+
+		return node;
 	}
 
-	// Name			: recursiveDelete
-	// Description	: This function deletes the node that fits the given
-	// 					key. We assume that the key exists
+	// Name			: attachNode
+	// Description	: Links a node which was detached from another tree,
+	//					unless it's key already exists.
 	// Parameters	:
-	//	@current - the node to start from
-	//	@key - the key represents the node to delete
+	//	@node - the node, which has no links
+	// Return Value : true if the node was linked, false otherwise
+	bool attachNode(Node* node) {
+		Node* parent;
+		bool left_son;
+
+		if (findInsertPosition(node->getKey(), &parent, &left_son) != NULL) {
+			return false;
+		}
+		linkNode(node, parent, left_son);
+		return true;
+	}
+
+	// Name			: attachAll
+	// Description	: Links every node of a detached subtree (or a partly
+	//					flattened one) into the tree. The keys must not exist
+	//					in the tree.
+	// Parameters	:
+	//	@current - the subtree root, may be NULL
 	// Return Value : None
-	void recursiveDelete(Node * current, const KeyType& key) {
-		if (current->getKey() == key) {
-			if (current->isLeaf() == true) {
-				current->disconnectFromParent();
-				if (current == root) {
-					root = NULL;
-				}
-				delete current;
-				return;
-			} else if (current->isFull() == true) {
-				Node* current_right = current->getRight();
-				while (current_right->getLeft() != NULL) {
-					current_right = current_right->getLeft();
-				}
-				current->swap(current_right);
-				recursiveDelete(current->getRight(), key);
-				if (current->getRight() != NULL) {
-					current->updateRightHeight();
-				}
-			} else {
-				current->attachParentAndSon();
-				if (current == root) {
-					if (current->getLeft() != NULL) {
-						root = current->getLeft();
-					} else {
-						root = current->getRight();
-					}
-				}
-				delete current;
-				return;
+	void attachAll(Node* current) {
+		while (current != NULL) {
+			Node* left = current->getLeft();
+			if (left != NULL) {
+				current->setLeft(left->getRight());
+				left->setRight(current);
+				current = left;
+				continue;
+			}
+
+			Node* next = current->getRight();
+			current->resetLinks();
+			attachNode(current);
+			current = next;
+		}
+	}
+
+	// Name			: deleteNode
+	// Description	: This function deletes the given node. A node with two
+	//					sons swaps places with it's successor first, so it
+	//					has one son at most when it's unlinked. Other nodes
+	//					(and their data) are never moved.
+	// Parameters	:
+	//	@node - the node to delete
+	//	@removed - if not NULL, receives the data of the deleted node
+	// Return Value : None
+	void deleteNode(Node * node, T* removed) {
+		// The extremes have one son at most, which is a leaf, so their
+		// neighbour is found in constant time
+		if (node == minimal) {
+			minimal = successor(node);
+		}
+		if (node == maximal) {
+			maximal = predecessor(node);
+		}
+
+		if (node->isFull() == true) {
+			Node* next = leftmost(node->getRight());
+			node->exchangeWithSuccessor(next);
+			if (node == root) {
+				root = next;
+			}
+		}
+
+		Node* parent = node->getParent();
+		int old_height = (parent == NULL) ? 0 : parent->getHeight();
+
+		if (node->isLeaf() == true) {
+			node->disconnectFromParent();
+			if (node == root) {
+				root = NULL;
 			}
 		} else {
-			if (key > current->getKey()) {
-				recursiveDelete(current->getRight(), key);
-				if (current->getRight() != NULL) {
-					current->updateRightHeight();
-				}
-			} else {
-				recursiveDelete(current->getLeft(), key);
-				if (current->getLeft() != NULL) {
-					current->updateLeftHeight();
-				}
+			Node* son =
+					(node->getLeft() != NULL) ? node->getLeft() : node->getRight();
+			node->attachParentAndSon();
+			if (node == root) {
+				root = son;
 			}
 		}
 
-		rotate(current);
+		if (removed != NULL) {
+			*removed = std::move(node->getData());
+		}
+		destroyNode(node);
+		size--;
+
+		retrace(parent, old_height);
+	}
+
+	// Name			: popNode
+	// Description	: Deletes an extreme node, for PopMin and PopMax
+	// Parameters	:
+	//	@node		- minimal or maximal, NULL if the tree is empty
+	//	@key		- if not NULL, receives the key of the deleted node
+	//	@removed	- if not NULL, receives the data of the deleted node
+	// Return Value : true if a node was deleted, false if the tree is empty
+	bool popNode(Node* node, KeyType* key, T* removed) {
+		Stats::RecordErase(node != NULL);
+		if (node == NULL) {
+			return false;
+		}
+
+		if (key != NULL) {
+			*key = node->getKey();
+		}
+		deleteNode(node, removed);
+		return true;
+	}
+
+	// Name			: eraseKey
+	// Description	: Deletes the node of a key, for Erase and Delete
+	// Parameters	:
+	//	@key		- the key, or a key-like object
+	//	@removed	- if not NULL, receives the data of the deleted node
+	// Return Value : true if the node was deleted, false if the key wasn't
+	//					found
+	template<class Key>
+	bool eraseKey(const Key& key, T* removed) {
+		Node* node = findNode(key);
+		Stats::RecordErase(node != NULL);
+		if (node == NULL) {
+			return false;
+		}
+
+		deleteNode(node, removed);
+		return true;
+	}
+
+	// Name			: lookupData
+	// Description	: Searches a key, for TryFind
+	// Parameters	:
+	//	@key - the key, or a key-like object
+	// Return Value : Pointer to the data of the node, or NULL if the key
+	//					wasn't found
+	template<class Key>
+	T* lookupData(const Key& key) {
+		Node * searched_node = findNode(key);
+		Stats::RecordLookup(searched_node != NULL);
+		if (searched_node == NULL) {
+			return NULL;
+		}
+
+		return &searched_node->getData();
+	}
+
+	// Name			: lookupNodeOrThrow
+	// Description	: Searches a key, for Find
+	// Parameters	:
+	//	@key - the key, or a key-like object
+	// Return Value : the node of the key, if the key wasn't found
+	//					AVLTreeKeyNotFoundException will be thrown
+	template<class Key>
+	Node* lookupNodeOrThrow(const Key& key) {
+		Node * searched_node = findNode(key);
+		Stats::RecordLookup(searched_node != NULL);
+		if (searched_node == NULL) {
+			Stats::RecordException();
+			throw AVLTreeKeyNotFoundException();
+		}
+
+		return searched_node;
 	}
 
 	// Name			: inorderOutputAux
@@ -560,12 +1226,10 @@ private:
 	//	@output		- output stream
 	// Return Value : None
 	void inorderOutputAux(Node * current, std::ostream& output) const {
-		if (current == NULL) {
-			return;
+		for (current = leftmost(current); current != NULL;
+				current = successor(current)) {
+			output << (current->getKey()) << ",";
 		}
-		inorderOutputAux(current->getLeft(), output);
-		output << (current->getKey()) << ",";
-		inorderOutputAux(current->getRight(), output);
 	}
 
 	// Name			: getMaxBalanceFactorAux
@@ -583,37 +1247,102 @@ private:
 						getMaxBalanceFactorAux(current->getLeft())));
 	}
 
-	// Name			: recursiveDestruct
-	// Description	: This function deletes all nodes in the tree, using post
-	// order algorithm.
+	// Name			: destructTree
+	// Description	: This function deletes all nodes in the given subtree.
+	// The left sons are rotated into a right leaning list on the way, so
+	// no stack is needed. The tree size is left to the caller.
 	// Parameters	:
-	//	@current 	- the node to start the delete action from
+	//	@current 	- the subtree root
 	// Return Value : None
-	void recursiveDestruct(Node* current) {
-		if (current == NULL) {
-			return;
+	void destructTree(Node* current) {
+		while (current != NULL) {
+			Node* left = current->getLeft();
+			if (left != NULL) {
+				current->setLeft(left->getRight());
+				left->setRight(current);
+				current = left;
+			} else {
+				Node* right = current->getRight();
+				destroyNode(current);
+				current = right;
+			}
 		}
-		recursiveDestruct(current->getLeft());
-		recursiveDestruct(current->getRight());
-		delete current;
-		size--;
 	}
 
-	//
-	//	Name		:	updateMinimal
-	//	Parameters	:
-	//		@current - current node
-	//	Description	:	The function updates to minimal node field of
-	//					tree to contain the minimal value in the tree.
-	//	Return Value: None
-	void updateMinimal(Node* current) {
-		if (current == NULL) {
-			minimal = NULL;
-		} else if (current->getLeft() != NULL) {
-			updateMinimal(current->getLeft());
-		} else {
-			minimal = current;
+	// Name			: flattenTree
+	// Description	: Turns a subtree into a list of it's nodes in key order,
+	//					linked by their right sons. The left sons are rotated
+	//					away, as destructTree does, so no stack is needed.
+	// Parameters	:
+	//	@current - the subtree root
+	// Return Value : the first node of the list, NULL for an empty subtree
+	static Node* flattenTree(Node* current) {
+		Node* head = NULL;
+		Node* last = NULL;
+
+		while (current != NULL) {
+			Node* left = current->getLeft();
+			if (left != NULL) {
+				current->setLeft(left->getRight());
+				left->setRight(current);
+				current = left;
+				continue;
+			}
+
+			if (last == NULL) {
+				head = current;
+			} else {
+				last->setRight(current);
+			}
+			last = current;
+			current = current->getRight();
+		}
+		return head;
+	}
+
+	// Name			: buildFromList
+	// Description	: Links the first nodes of a list made by flattenTree
+	//					into a height balanced subtree, the way buildSubtree
+	//					builds one from a sorted array. Nothing is allocated.
+	// Parameters	:
+	//	@head	- the list, advanced past the linked nodes
+	//	@count	- number of nodes to link
+	// Return Value : the root of the new subtree, NULL if count is 0
+	static Node* buildFromList(Node** head, int count) {
+		if (count == 0) {
+			return NULL;
+		}
+
+		Node* left = buildFromList(head, count / 2);
+		Node* node = *head;
+		*head = node->getRight();
+
+		node->resetLinks();
+		node->setLeft(left);
+		if (left != NULL) {
+			left->setParent(node);
+		}
+
+		Node* right = buildFromList(head, count - count / 2 - 1);
+		node->setRight(right);
+		if (right != NULL) {
+			right->setParent(node);
 		}
+		return node;
+	}
+
+	// Name			: relinkList
+	// Description	: Makes the tree of the nodes of a list made by
+	//					flattenTree.
+	// Parameters	:
+	//	@head	- the list
+	//	@count	- number of nodes in the list
+	// Return Value : None
+	void relinkList(Node* head, int count) {
+		root = buildFromList(&head, count);
+		minimal = leftmost(root);
+		maximal = rightmost(root);
+		size = count;
 	}
 
 	//
@@ -629,150 +1358,489 @@ private:
 		if (out == NULL || index == NULL) {
 			throw AVLTreeNullArgException();
 		}
-		if (node == NULL)
-			return;
-
-		extractTreeDataInOrderAux(node->getLeft(), out, index);
-
-		T& temp = node->getData();
-		(out[*index]) = &temp;
-		*index += 1;
-
-		extractTreeDataInOrderAux(node->getRight(), out, index);
 
+		for (node = leftmost(node); node != NULL; node = successor(node)) {
+			T& temp = node->getData();
+			(out[*index]) = &temp;
+			*index += 1;
+		}
 	}
 
 	//
-	//	Name		:	getTreeHeightByNodesCount
-	//	Description	:	Given number of nodes, the function computes
-	//					the height of the smallest "full-tree" which
-	//					has more than @count nodes.
+	//	Name		:	extractTreeKeysInOrderAux
+	//	Description	:	This function extracts the keys from the tree
+	//					to the output array.
 	//	Parameters	:
-	//		@count - the number of nodes that must be in the tree
-	//	Return Value: 	the suitable height
-	//
-	int getTreeHeightByNodesCount(int count) {
-		if (count < 0) {
-			throw AVLTreeInvalidArgException();
+	//		@node - starting node
+	//		@out - pointer to the output array
+	//		@index - pointer to the index in the array
+	//	Return Value: None
+	void extractTreeKeysInOrderAux(Node* node, KeyType* out, int* index) {
+		if (out == NULL || index == NULL) {
+			throw AVLTreeNullArgException();
 		}
 
-		int height = 0;
-		while (pow(POWER_TWO, height) - 1 < count) {
-			height++;
+		for (node = leftmost(node); node != NULL; node = successor(node)) {
+			out[*index] = node->getKey();
+			*index += 1;
 		}
-
-		return height;
 	}
 
 	//
-	//	Name		:	createBlankTree
-	//	Description	:	This function creates a new "full-tree" with
-	//					the requested height (without data).
-	//	Parameters	:
-	//		@height - the height of the new tree
-	//	Return Value: pointer to the new tree
-	Node* createBlankTree(int height) {
-		if (height == 0) {
+	//	Class		: MovingSource / CopyingSource
+	//	Description : Value sources of buildSubtree. The first moves the
+	//					values out of an array, the second copies the objects
+	//					pointed by an array of pointers.
+	//
+	struct MovingSource {
+		T* values;
+
+		T&& operator[](int index) const {
+			return std::move(values[index]);
+		}
+	};
+
+	struct CopyingSource {
+		T** values;
+
+		T const& operator[](int index) const {
+			return *(values[index]);
+		}
+	};
+
+	// Name			: buildSubtree
+	// Description	: Builds a height balanced subtree from the sorted range
+	//					[first, last) of the input, in one pass. The middle
+	//					element is the subtree root, so the two halves differ
+	//					by one node at most. Nodes are allocated in key
+	//					order, so a pool allocator lays them out
+	//					contiguously.
+	// Parameters	:
+	//	@keys	- the sorted keys
+	//	@values	- the value source, indexed like the keys
+	//	@first	- the first index of the range
+	//	@last	- the index past the end of the range
+	// Return Value : the root of the new subtree, NULL for an empty range
+	// If memory allocation failes, the nodes built so far are freed and a
+	//	matching exception would be thrown by the system. The tree size is
+	//	left to the caller.
+	template<class Source>
+	Node* buildSubtree(const KeyType* keys, const Source& values, int first,
+			int last) {
+		if (first >= last) {
 			return NULL;
 		}
 
-		Node* root = new Node();
-		Node* left = createBlankTree(height - 1);
-		Node* right = createBlankTree(height - 1);
+		int middle = first + (last - first) / 2;
+		Node* left = buildSubtree(keys, values, first, middle);
+		Node* node;
 
-		root->setLeft(left);
-		if (left != NULL) {
-			left->setParent(root);
+		try {
+			node = createNode(keys[middle], values[middle]);
+		} catch (...) {
+			destructTree(left);
+			throw;
 		}
 
-		root->setRight(right);
-		if (right != NULL) {
-			right->setParent(root);
+		node->setLeft(left);
+		if (left != NULL) {
+			left->setParent(node);
 		}
 
-		size++;
-		return root;
+		try {
+			Node* right = buildSubtree(keys, values, middle + 1, last);
+			node->setRight(right);
+			if (right != NULL) {
+				right->setParent(node);
+			}
+		} catch (...) {
+			destructTree(node);
+			throw;
+		}
+		return node;
 	}
 
 	//
-	//	Name		:	fillTreeInOrder
-	//	Description	:	The function fills a blank tree with in-order
-	//					algorithm, based on the data in the given array.
-	//					NOTE: the data should be ordered.
-	//	Parameters	:
-	//		@root - the tree root
-	//		@ordered_data - input data
-	//		@ordered_keys - input keys
-	//		@index - arrays current index
-	//	The keys and data arrays should be in the same order (for example
-	//	the first data element should fit the first key).
-	void fillTreeInOrder(Node* node, T* ordered_data, KeyType* ordered_keys,
-			int * index) {
-		if (node == NULL) {
-			return;
+	//	Struct		: BuildRange
+	//	Description : A subtree of a parallel build, which is built by a
+	//					worker and then attached to it's parent.
+	//
+	struct BuildRange {
+		int first;
+		int last;
+		Node* parent;
+		bool left;
+		Node* subtree;
+	};
+
+	//
+	//	Class		: BuildTask
+	//	Description : Builds the subtrees of a parallel build, one per index.
+	//
+	template<class Source>
+	class BuildTask: public ParallelTask {
+	private:
+		AVLTree* tree;
+		const KeyType* keys;
+		const Source& values;
+		std::vector<BuildRange>& ranges;
+
+	public:
+		BuildTask(AVLTree* tree, const KeyType* keys, const Source& values,
+				std::vector<BuildRange>& ranges) :
+				tree(tree), keys(keys), values(values), ranges(ranges) {
 		}
-		if (ordered_data == NULL || ordered_keys == NULL || index == NULL) {
-			throw AVLTreeInvalidArgException();
+
+		void Run(int first, int last) {
+			for (int i = first; i < last; i++) {
+				ranges[i].subtree = tree->buildSubtree(keys, values,
+						ranges[i].first, ranges[i].last);
+			}
 		}
+	};
+
+	// Name			: splitDepth
+	// Description	: Returns the depth at which a tree is split between the
+	//					threads of an executor, so every thread gets a few
+	//					subtrees.
+	// Parameters	:
+	//	@executor - the executor
+	// Return Value : the depth, at least 1
+	static int splitDepth(Executor* executor) {
+		int subtrees = executor->getConcurrency()
+				* PARALLEL_SUBTREES_PER_THREAD;
+		int depth = 1;
 
-		fillTreeInOrder(node->getLeft(), ordered_data, ordered_keys, index);
-		node->setData(ordered_data[*index]);
-		node->setKey(ordered_keys[*index]);
-		(*index)++;
-		fillTreeInOrder(node->getRight(), ordered_data, ordered_keys, index);
+		while ((1 << depth) < subtrees && depth < PARALLEL_MAX_DEPTH) {
+			depth++;
+		}
+		return depth;
 	}
 
-	//
-	//	Name		:	trimTreeInOrder
-	//	Description	:	The function trims the tree so that after the
-	//					operation, it has exactly the requested amount of nodes.
-	//	Parameters	:
-	//		@node - starting node
-	//		@current_size - current tree size
-	//		@requested_size - final size
-	//	Return Value: None
-	void trimTreeInOrder(Node* node, int* current_size, int requested_size) {
-		if (*current_size == requested_size) {
+	// Name			: useExecutor
+	// Description	: Tests if a whole-tree operation over the given number
+	//					of nodes is worth splitting between threads.
+	// Parameters	:
+	//	@executor	- the executor, may be NULL
+	//	@count		- number of nodes
+	// Return Value : true if the operation should run in parallel
+	static bool useExecutor(Executor* executor, int count) {
+		return (executor != NULL && executor->getConcurrency() > 1
+				&& count >= PARALLEL_MIN_NODES);
+	}
+
+	// Name			: buildSkeleton
+	// Description	: Builds the top levels of a parallel build, the way
+	//					buildSubtree would. The ranges under them are recorded
+	//					for the workers. The nodes are linked to the tree as
+	//					they are created, so a failed build can free them.
+	// Parameters	:
+	//	@keys	- the sorted keys
+	//	@values	- the value source, indexed like the keys
+	//	@first	- the first index of the range
+	//	@last	- the index past the end of the range
+	//	@depth	- number of levels left to build
+	//	@parent	- the parent of the new subtree, NULL for the root
+	//	@left	- true if the subtree is the left son of the parent
+	//	@top	- output, the new nodes in pre-order
+	//	@ranges	- output, the ranges left to the workers
+	// Return Value : None
+	template<class Source>
+	void buildSkeleton(const KeyType* keys, const Source& values, int first,
+			int last, int depth, Node* parent, bool left,
+			std::vector<Node*>* top, std::vector<BuildRange>* ranges) {
+		if (first >= last) {
 			return;
 		}
-		if (node == NULL) {
+		if (depth == 0) {
+			BuildRange range = { first, last, parent, left, NULL };
+			ranges->push_back(range);
 			return;
 		}
 
-		if (current_size == NULL) {
-			throw AVLTreeNullArgException();
+		int middle = first + (last - first) / 2;
+		Node* node = createNode(keys[middle], values[middle]);
+		linkSon(parent, left, node);
+		top->push_back(node);
+
+		buildSkeleton(keys, values, first, middle, depth - 1, node, true, top,
+				ranges);
+		buildSkeleton(keys, values, middle + 1, last, depth - 1, node, false,
+				top, ranges);
+	}
+
+	// Name			: linkSon
+	// Description	: Links a subtree under a parent, or as the root.
+	// Parameters	:
+	//	@parent	- the parent, NULL for the root
+	//	@left	- true for the left son
+	//	@son	- the subtree root, may be NULL
+	// Return Value : None
+	void linkSon(Node* parent, bool left, Node* son) {
+		if (son != NULL) {
+			son->setParent(parent);
 		}
 
-		trimTreeInOrder(node->getLeft(), current_size, requested_size);
-		if (node->isLeaf()) {
-			node->disconnectFromParent();
-			delete node;
-			size--;
-			(*current_size)--;
+		if (parent == NULL) {
+			root = son;
+		} else if (left == true) {
+			parent->setLeft(son);
+		} else {
+			parent->setRight(son);
+		}
+	}
+
+	// Name			: buildParallel
+	// Description	: Builds the tree like buildSubtree, with the subtrees
+	//					under the top levels built by the executor's threads.
+	//					The heights of the top levels are fixed once the
+	//					subtrees are attached.
+	// Parameters	:
+	//	@keys		- the sorted keys
+	//	@values		- the value source, indexed like the keys
+	//	@count		- number of elements
+	//	@executor	- the executor
+	// Return Value : None
+	// If memory allocation failes, all the nodes are freed and a matching
+	//	exception would be thrown by the system.
+	template<class Source>
+	void buildParallel(const KeyType* keys, const Source& values, int count,
+			Executor* executor) {
+		std::vector<Node*> top;
+		std::vector<BuildRange> ranges;
+		std::exception_ptr error;
+
+		try {
+			buildSkeleton(keys, values, 0, count, splitDepth(executor), NULL,
+					false, &top, &ranges);
+			BuildTask<Source> task(this, keys, values, ranges);
+			executor->ParallelFor(task, (int) ranges.size(), 1);
+		} catch (...) {
+			error = std::current_exception();
+		}
+
+		for (size_t i = 0; i < ranges.size(); i++) {
+			linkSon(ranges[i].parent, ranges[i].left, ranges[i].subtree);
+		}
+		if (error) {
+			destructTree(root);
+			root = NULL;
+			std::rethrow_exception(error);
+		}
+
+		// Sons come after their parent in pre-order
+		for (size_t i = top.size(); i > 0; i--) {
+			top[i - 1]->updateLeftHeight();
+			top[i - 1]->updateRightHeight();
+		}
+	}
+
+	// Name			: buildTree
+	// Description	: Replaces the tree with a height balanced tree, built
+	//					from sorted arrays in O(n). Large trees are built by
+	//					the executor's threads, if the allocator is thread
+	//					safe (see AllocatorThreadSafety).
+	// Parameters	:
+	//	@keys		- the keys, strictly increasing
+	//	@values		- the value source, indexed like the keys
+	//	@count		- number of elements
+	//	@executor	- the executor, NULL to build serially
+	// Return Value : None
+	//	If the keys aren't strictly increasing AVLTreeInvalidArgException
+	// will be thrown, and the tree isn't changed.
+	template<class Source>
+	void buildTree(const KeyType* keys, const Source& values, int count,
+			Executor* executor) {
+		for (int i = 1; i < count; i++) {
+			if (lessKeys(keys[i - 1], keys[i]) == false) {
+				throw AVLTreeInvalidArgException();
+			}
+		}
+
+		Clear(executor);
+		if (AllocatorThreadSafety<NodeAllocator>::value
+				&& useExecutor(executor, count)) {
+			buildParallel(keys, values, count, executor);
+		} else {
+			root = buildSubtree(keys, values, 0, count);
+		}
+		minimal = leftmost(root);
+		maximal = rightmost(root);
+		size = count;
+	}
+
+	//
+	//	Class		: DestructTask
+	//	Description : Deletes the subtrees of a parallel Clear, one per
+	//					index.
+	//
+	class DestructTask: public ParallelTask {
+	private:
+		AVLTree* tree;
+		std::vector<Node*>& subtrees;
+
+	public:
+		DestructTask(AVLTree* tree, std::vector<Node*>& subtrees) :
+				tree(tree), subtrees(subtrees) {
+		}
+
+		void Run(int first, int last) {
+			for (int i = first; i < last; i++) {
+				tree->destructTree(subtrees[i]);
+			}
+		}
+	};
+
+	// Name			: splitTree
+	// Description	: Splits the tree into it's top levels and the disjoint
+	//					subtrees under them, for the executor's threads.
+	// Parameters	:
+	//	@executor	- the executor
+	//	@top		- output, the nodes of the top levels
+	//	@subtrees	- output, the subtrees under the top levels
+	// Return Value : None
+	void splitTree(Executor* executor, std::vector<Node*>* top,
+			std::vector<Node*>* subtrees) const {
+		int depth = splitDepth(executor);
+
+		subtrees->push_back(root);
+		for (int level = 0; level < depth; level++) {
+			std::vector<Node*> next;
+			for (size_t i = 0; i < subtrees->size(); i++) {
+				Node* node = (*subtrees)[i];
+				if (node != NULL) {
+					top->push_back(node);
+					next.push_back(node->getLeft());
+					next.push_back(node->getRight());
+				}
+			}
+			subtrees->swap(next);
+		}
+	}
+
+	//
+	//	Class		: VisitTask
+	//	Description : Visits the subtrees of a parallel ForEach, one per
+	//					index.
+	//
+	template<class Visitor>
+	class VisitTask: public ParallelTask {
+	private:
+		std::vector<Node*>& subtrees;
+		Visitor& visitor;
+
+	public:
+		VisitTask(std::vector<Node*>& subtrees, Visitor& visitor) :
+				subtrees(subtrees), visitor(visitor) {
+		}
+
+		void Run(int first, int last) {
+			for (int i = first; i < last; i++) {
+				visitSubtree(subtrees[i], visitor);
+			}
+		}
+	};
+
+	// Name			: visitSubtree
+	// Description	: Visits the nodes of a subtree in key order
+	// Parameters	:
+	//	@subtree	- the subtree root, may be NULL
+	//	@visitor	- callable, invoked as visitor(key, data)
+	// Return Value : None
+	template<class Visitor>
+	static void visitSubtree(Node* subtree, Visitor& visitor) {
+		if (subtree == NULL) {
 			return;
 		}
-		trimTreeInOrder(node->getRight(), current_size, requested_size);
 
-		node->updateLeftHeight();
-		node->updateRightHeight();
+		Node* stop = successor(rightmost(subtree));
+		for (Node* node = leftmost(subtree); node != stop;
+				node = successor(node)) {
+			visitor(node->getKey(), node->getData());
+		}
 	}
 
 public:
 	//
 	//	Class		: iterator
 	// 	Description	: An iterator. Used to iterate over the data in an AVLTree.
+	//					Besides moving along the tree links it's a standard
+	//					bidirectional iterator, in key order (see begin/end).
+	//					Insert and Delete invalidate the iterators of a tree.
 	//
 	class iterator {
 	private:
 		Node* current;
 		AVLTree * tree;
 	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T* pointer;
+		typedef T& reference;
+
 		// Constructs a new iterator that points to a given node in the given
 		// tree.
 		iterator(Node* node, AVLTree * tree) :
 				current(node), tree(tree) {
 		}
 
+		// Name			: operator++
+		// Description	: Moves the iterator to the next node in key order
+		// Parameters	: None
+		// Return Value : The moved iterator, which equals end() if the node
+		//					was the last one
+		iterator& operator++() {
+			if (current == NULL) {
+				throw AVLTreeIteratorReachedEnd();
+			}
+
+			current = successor(current);
+			return *this;
+		}
+
+		iterator operator++(int) {
+			iterator res = *this;
+			++(*this);
+			return res;
+		}
+
+		// Name			: operator--
+		// Description	: Moves the iterator to the previous node in key order.
+		//					Moving back from end() reaches the last node.
+		// Parameters	: None
+		// Return Value : The moved iterator
+		// If the iterator is on the first node (or the tree is empty),
+		// AVLTreeIteratorReachedEnd will be thrown.
+		iterator& operator--() {
+			Node* prev = (current == NULL) ?
+					rightmost(tree->root) : predecessor(current);
+			if (prev == NULL) {
+				throw AVLTreeIteratorReachedEnd();
+			}
+
+			current = prev;
+			return *this;
+		}
+
+		iterator operator--(int) {
+			iterator res = *this;
+			--(*this);
+			return res;
+		}
+
+		// Name			: getKey
+		// Description	: Returns the key of the iterator's node
+		// Parameters	: None
+		// Return Value : the key
+		const KeyType& getKey() const {
+			if (current == NULL) {
+				throw AVLTreeIteratorReachedEnd();
+			}
+
+			return current->getKey();
+		}
+
 		// Name			: MoveLeft
 		// Description	: Move the given iterator to left son
 		// Parameters	: None
@@ -828,6 +1896,11 @@ public:
 			return current->getData();
 		}
 
+		// Member access operator
+		T* operator->() const {
+			return &(**this);
+		}
+
 		// Equal operator
 		// Description	: Two iterators are equals if their keys are equals,
 		// and they are part of the same tree.
@@ -853,19 +1926,47 @@ public:
 	//
 	// Public interface
 	//
-	template<class F, typename KeyTypeF>
+	template<class F, typename KeyTypeF, class AllocatorF,
+			class AugmentationF, class StatsF, class CompareF>
 	friend std::ostream& operator<<(std::ostream& output,
-			const AVLTree<F, KeyTypeF>& tree);
+			const AVLTree<F, KeyTypeF, AllocatorF, AugmentationF, StatsF,
+					CompareF>& tree);
 
 	// AVLTree constructor
 	AVLTree() :
-			root(NULL), minimal(NULL), size(INITIAL_SIZE) {
+			root(NULL), minimal(NULL), maximal(NULL), size(INITIAL_SIZE) {
 	}
 	;
 
+	// AVLTree constructor, nodes are allocated by the given allocator
+	explicit AVLTree(const Allocator& alloc) :
+			root(NULL), minimal(NULL), maximal(NULL), size(INITIAL_SIZE), node_alloc(alloc) {
+	}
+
+	// AVLTree constructor, keys are ordered by the given comparator
+	explicit AVLTree(const Compare& compare, const Allocator& alloc =
+			Allocator()) :
+			Compare(compare), root(NULL), minimal(NULL), maximal(NULL), size(
+					INITIAL_SIZE), node_alloc(alloc) {
+	}
+
+	// AVLTree constructor, nodes are allocated by the given allocator, and
+	// the statistics go to the given policy object (see StatsLink)
+	AVLTree(const Allocator& alloc, const Stats& stats,
+			const Compare& compare = Compare()) :
+			Stats(stats), Compare(compare), root(NULL), minimal(NULL), maximal(
+					NULL), size(INITIAL_SIZE), node_alloc(alloc) {
+	}
+
 	//	AVLTree destructor
+	//	Nodes which need no destructor are left to the allocator, if it can
+	//	release all of them at once (see AllocatorBulkRelease).
 	~AVLTree() {
-		recursiveDestruct(root);
+		if (std::is_trivially_destructible<Node>::value
+				&& AllocatorBulkRelease<NodeAllocator>::Release(node_alloc, 1)) {
+			return;
+		}
+		destructTree(root);
 	}
 
 	// Name			: Insert
@@ -877,27 +1978,80 @@ public:
 	// 	If the key already exist, AVLTreeKeyAlreadyExistsException will be
 	// thrown.
 	void Insert(KeyType key, T const& data) {
-		bool already_exist = true;
-		if (Empty() == true) {
-			root = new Node(key, data);
-			size++;
-			updateMinimal(root);
-			return;
-		}
+		Emplace(std::move(key), data);
+	}
 
-		try {
-			Find(key);
-		} catch (AVLTreeKeyNotFoundException&) {
-			recursiveInsert(root, new Node(key, data));
-			already_exist = false;
-		}
-		if (already_exist == true) {
+	// Name			: Insert
+	// Description	: This function inserts a new node to the tree, and moves
+	//					the given data into it.
+	// Parameters	:
+	//	@key 	- the node's key
+	//	@data 	- the node's data
+	// Return Value : None
+	// 	If the key already exist, AVLTreeKeyAlreadyExistsException will be
+	// thrown.
+	void Insert(KeyType key, T&& data) {
+		Emplace(std::move(key), std::move(data));
+	}
+
+	// Name			: Emplace
+	// Description	: Inserts a new node to the tree, whose data is
+	//					constructed in place from the given arguments.
+	// Parameters	:
+	//	@key 	- the node's key
+	//	@args 	- the arguments of the data constructor
+	// Return Value : Reference to the data of the new node
+	// 	If the key already exist, AVLTreeKeyAlreadyExistsException will be
+	// thrown.
+	template<class ... Args>
+	T& Emplace(KeyType key, Args&&... args) {
+		bool inserted;
+
+		Node* node = insertKey(std::move(key), &inserted,
+				std::forward<Args>(args)...);
+		if (inserted == false) {
+			Stats::RecordException();
 			throw AVLTreeKeyAlreadyExistsException();
 		}
+		return node->getData();
+	}
 
-		size++;
-		// Finally, update the minimal node
-		updateMinimal(root);
+	// Name			: InsertOrAssign
+	// Description	: Inserts a new node to the tree, or replaces the data of
+	//					the node if the key already exists.
+	// Parameters	:
+	//	@key 	- the node's key
+	//	@data 	- the node's data, copied or moved
+	// Return Value : true if a new node was inserted, false if the data of
+	//					an existing node was assigned
+	template<class Data>
+	bool InsertOrAssign(KeyType key, Data&& data) {
+		bool inserted;
+
+		Node* node = insertKey(std::move(key), &inserted,
+				std::forward<Data>(data));
+		if (inserted == false) {
+			node->getData() = std::forward<Data>(data);
+		}
+		return inserted;
+	}
+
+	// Name			: TryEmplace
+	// Description	: Inserts a new node to the tree if the key doesn't exist.
+	//					Otherwise the tree isn't changed, and the arguments
+	//					aren't used.
+	// Parameters	:
+	//	@key 	- the node's key
+	//	@args 	- the arguments of the data constructor
+	// Return Value : A pair of a pointer to the data of the node which holds
+	//					the key, and whether it was inserted by this call
+	template<class ... Args>
+	std::pair<T*, bool> TryEmplace(KeyType key, Args&&... args) {
+		bool inserted;
+
+		Node* node = insertKey(std::move(key), &inserted,
+				std::forward<Args>(args)...);
+		return std::pair<T*, bool>(&node->getData(), inserted);
 	}
 
 	// Name			: Delete
@@ -908,16 +2062,107 @@ public:
 	// Return Value : None, if the key wasn't found a suitable exception will
 	// be thrown (AVLTreeKeyNotFoundException).
 	void Delete(const KeyType & key) {
-		Find(key);
+		if (eraseKey(key, NULL) == false) {
+			Stats::RecordException();
+			throw AVLTreeKeyNotFoundException();
+		}
+	}
 
-		recursiveDelete(root, key);
+	// Name			: Delete
+	// Description	: Delete, by a key-like object (see TransparentKeys)
+	// Parameters	:
+	//	@key - compares equal to the key of the node to delete
+	// Return Value : None, if the key wasn't found a suitable exception will
+	// be thrown (AVLTreeKeyNotFoundException).
+	template<class Key>
+	typename std::enable_if<IsKeyLike<Compare, KeyType, Key>::value>::type Delete(
+			const Key& key) {
+		if (eraseKey(key, NULL) == false) {
+			Stats::RecordException();
+			throw AVLTreeKeyNotFoundException();
+		}
+	}
 
-		size--;
-		if (size == 0) {
-			root = NULL;
+	// Name			: Erase
+	// Description	: This function deletes a node from the tree, by the given
+	// key, if it exists.
+	// Parameters	:
+	//	@key - the key represents the node to delete
+	//	@removed - if not NULL, receives the data of the deleted node
+	// Return Value : true if the node was deleted, false if the key wasn't
+	// found
+	bool Erase(const KeyType & key, T* removed = NULL) {
+		return eraseKey(key, removed);
+	}
+
+	// Name			: Erase
+	// Description	: Erase, by a key-like object (see TransparentKeys)
+	// Parameters	:
+	//	@key - compares equal to the key of the node to delete
+	//	@removed - if not NULL, receives the data of the deleted node
+	// Return Value : true if the node was deleted, false if the key wasn't
+	// found
+	template<class Key>
+	typename std::enable_if<IsKeyLike<Compare, KeyType, Key>::value, bool>::type Erase(
+			const Key& key, T* removed = NULL) {
+		return eraseKey(key, removed);
+	}
+
+	// Name			: EraseIf
+	// Description	: Deletes all the nodes which match a predicate, in one
+	//					pass. The tree is flattened into a list, the matching
+	//					nodes are deleted from the list, and the rest are
+	//					linked back into a balanced tree, so no node is
+	//					rebalanced per deletion. The data of the remaining
+	//					nodes doesn't move.
+	// Parameters	:
+	//	@predicate - callable, invoked as predicate(key, data) for each node
+	//				in key order, returns true for the nodes to delete
+	// Return Value : the number of deleted nodes
+	//	If the predicate throws, the nodes it wasn't called for stay in the
+	// tree, and the exception is rethrown.
+	template<class Predicate>
+	int EraseIf(Predicate predicate) {
+		if (root == NULL) {
+			return 0;
+		}
+
+		Node* current = flattenTree(root);
+		Node* head = NULL;
+		Node* last = NULL;
+		int count = size;
+		int removed = 0;
+
+		root = NULL;
+		try {
+			while (current != NULL) {
+				Node* next = current->getRight();
+				if (predicate(current->getKey(), current->getData()) == true) {
+					destroyNode(current);
+					removed++;
+					Stats::RecordErase(true);
+				} else {
+					if (last == NULL) {
+						head = current;
+					} else {
+						last->setRight(current);
+					}
+					last = current;
+				}
+				current = next;
+			}
+		} catch (...) {
+			if (last == NULL) {
+				head = current;
+			} else {
+				last->setRight(current);
+			}
+			relinkList(head, count - removed);
+			throw;
 		}
-		// Finally, update minimal node
-		updateMinimal(root);
+
+		relinkList(head, count - removed);
+		return removed;
 	}
 
 	// Name			: Find
@@ -927,12 +2172,110 @@ public:
 	// the suitable node will be returned. Otherwise, an exception will be
 	// thrown.
 	iterator Find(const KeyType & key) {
-		Node * searched_node = recursiveFind(root, key);
-		if (searched_node == NULL) {
-			throw AVLTreeKeyNotFoundException();
+		return iterator(lookupNodeOrThrow(key), this);
+	}
+
+	// Name			: Find
+	// Description	: Find, by a key-like object (see TransparentKeys)
+	// Parameters	: key - compares equal to the key to search
+	// Return Value : iterator for the suitable node, if the key wasn't
+	// found an exception will be thrown.
+	template<class Key>
+	typename std::enable_if<IsKeyLike<Compare, KeyType, Key>::value, iterator>::type Find(
+			const Key& key) {
+		return iterator(lookupNodeOrThrow(key), this);
+	}
+
+	// Name			: TryFind
+	// Description	: This function searches the tree for a given key,
+	//					without throwing on a miss.
+	// Parameters	: key - the key to search
+	// Return Value : Pointer to the data of the suitable node, or NULL if
+	// the key wasn't found.
+	T* TryFind(const KeyType & key) {
+		return lookupData(key);
+	}
+
+	// Name			: TryFind
+	// Description	: TryFind, by a key-like object (see TransparentKeys)
+	// Parameters	: key - compares equal to the key to search
+	// Return Value : Pointer to the data of the suitable node, or NULL if
+	// the key wasn't found.
+	template<class Key>
+	typename std::enable_if<IsKeyLike<Compare, KeyType, Key>::value, T*>::type TryFind(
+			const Key& key) {
+		return lookupData(key);
+	}
+
+	// Name			: PrefetchRoot
+	// Description	: Starts loading the root node into the cache, for a
+	//					search which follows soon (see HashMap::FindBatch).
+	// Parameters	: None
+	// Return Value : None
+	void PrefetchRoot() const {
+		if (root != NULL) {
+			PrefetchRead(root);
 		}
+	}
 
-		return iterator(searched_node, this);
+	// Name			: Clear
+	// Description	: This function deletes all the nodes of the tree. With
+	//					an executor the subtrees of a large tree are deleted
+	//					by it's threads, if the allocator is thread safe (see
+	//					AllocatorThreadSafety).
+	// Parameters	:
+	//	@executor - optional, the executor (see parallel_task.hpp)
+	// Return Value : None
+	void Clear(Executor* executor = NULL) {
+		if (AllocatorThreadSafety<NodeAllocator>::value
+				&& useExecutor(executor, size)) {
+			std::vector<Node*> top;
+			std::vector<Node*> subtrees;
+
+			splitTree(executor, &top, &subtrees);
+			DestructTask task(this, subtrees);
+			executor->ParallelFor(task, (int) subtrees.size(), 1);
+			for (size_t i = 0; i < top.size(); i++) {
+				destroyNode(top[i]);
+			}
+		} else {
+			destructTree(root);
+		}
+
+		root = NULL;
+		minimal = NULL;
+		maximal = NULL;
+		size = INITIAL_SIZE;
+	}
+
+	// Name			: ParallelForEach
+	// Description	: Visits every node of the tree. With an executor the
+	//					subtrees of a large tree are visited by it's threads
+	//					at once, in no particular order. The tree must not be
+	//					changed during the scan.
+	// Parameters	:
+	//	@visitor	- callable, invoked as visitor(key, data) for each node.
+	//					It's shared by the threads, and must be safe to call
+	//					concurrently.
+	//	@executor	- optional, the executor (see parallel_task.hpp). The nodes
+	//					are visited in key order without one.
+	// Return Value : None
+	template<class Visitor>
+	void ParallelForEach(Visitor visitor, Executor* executor = NULL) {
+		if (useExecutor(executor, size) == false) {
+			visitSubtree(root, visitor);
+			return;
+		}
+
+		std::vector<Node*> top;
+		std::vector<Node*> subtrees;
+
+		splitTree(executor, &top, &subtrees);
+		VisitTask<Visitor> task(subtrees, visitor);
+		executor->ParallelFor(task, (int) subtrees.size(), 1);
+		for (size_t i = 0; i < top.size(); i++) {
+			visitor(top[i]->getKey(), top[i]->getData());
+		}
 	}
 
 	// Name			: getSize
@@ -944,6 +2287,26 @@ public:
 		return size;
 	}
 
+	// Name			: getHeight
+	// Description	: Returns the height of the tree, which is kept in the
+	//					root, so no walk is needed.
+	// Parameters	: None
+	// Return Value : the height, 0 for an empty tree
+	int getHeight() const {
+		return (root == NULL) ? 0 : root->getHeight();
+	}
+
+	// Name			: GetStats
+	// Description	: Returns the counters of the statistics policy. With
+	//					NoStats all of them are zero.
+	// Parameters	: None
+	// Return Value : a copy of the counters, and the tree size
+	StatsSnapshot GetStats() const {
+		StatsSnapshot res = Stats::Snapshot();
+		res.size = size;
+		return res;
+	}
+
 	// Name			: Empty
 	// Description	: This function tests whether the tree is empty or not.
 	// Parameters	: None
@@ -985,51 +2348,202 @@ public:
 		return data_array;
 	}
 
+	//
+	//	Name		:	inOrderExtractKeys
+	//	Description	:	The function returns an ordered array which
+	//					contains the keys contained in the tree.
+	// Parameters	:	None
+	// Return Value	: 	Pointer to a keys array
+	KeyType* inOrderExtractKeys(void) {
+		KeyType* keys_array = new KeyType[getSize()];
+		int index = 0;
+
+		extractTreeKeysInOrderAux(root, keys_array, &index);
+
+		return keys_array;
+	}
+
 	//
 	//	Name		:	generateInOrder
 	//	Description	:	Based on the data in the given arrays, the
 	//					function constructs and fills the tree. The
 	//					new tree would be "almost-full", means it has
 	//					only few leafs missing in the last level.
+	//					The objects are copied (see BuildFromSorted).
 	// Parameters	:
 	//	@arr_data - the input data
-	//	@arr_keys - the input keys
+	//	@arr_keys - the input keys, strictly increasing
 	//	@count	- number of elements in the array
 	// Return Value	: None
 	void generateInOrder(T** arr_data, KeyType* arr_keys, int count) {
 		if (count < 0) {
 			throw AVLTreeInvalidArgException();
-		} else if (count == 0) {
-			return;
 		}
+		if (count > 0 && (arr_data == NULL || arr_keys == NULL)) {
+			throw AVLTreeNullArgException();
+		}
+
+		CopyingSource source = { arr_data };
+		buildTree(arr_keys, source, count, NULL);
+	}
 
-		if (arr_data == NULL || arr_keys == NULL) {
+	// Name			: BuildFromSorted
+	// Description	: Replaces the content of the tree with the given
+	//					mappings, in one linear pass. The values are moved
+	//					into the tree.
+	// Parameters	:
+	//	@keys		- the keys, strictly increasing
+	//	@values		- the values, in the order of the keys
+	//	@count		- number of elements
+	//	@executor	- optional, splits the build of a large tree between
+	//					it's threads (see parallel_task.hpp)
+	// Return Value : None
+	//	If the count is negative, or the keys aren't strictly increasing,
+	// AVLTreeInvalidArgException will be thrown and the tree isn't
+	// changed. If memory allocation failes the tree is left empty.
+	void BuildFromSorted(const KeyType* keys, T* values, int count,
+			Executor* executor = NULL) {
+		if (count < 0) {
+			throw AVLTreeInvalidArgException();
+		}
+		if (count > 0 && (keys == NULL || values == NULL)) {
 			throw AVLTreeNullArgException();
 		}
 
-		int i = 0;
+		MovingSource source = { values };
+		buildTree(keys, source, count, executor);
+	}
+
+	// Name			: LowerBound
+	// Description	: Searches the first node whose key isn't less than the
+	//					given key.
+	// Parameters	:
+	//	@key - the bound
+	// Return Value : iterator to the node, or end() if there's none
+	iterator LowerBound(const KeyType& key) {
+		return iterator(lowerBoundNode(key, false), this);
+	}
+
+	// Name			: UpperBound
+	// Description	: Searches the first node whose key is greater than the
+	//					given key.
+	// Parameters	:
+	//	@key - the bound
+	// Return Value : iterator to the node, or end() if there's none
+	iterator UpperBound(const KeyType& key) {
+		return iterator(lowerBoundNode(key, true), this);
+	}
+
+	// Name			: EqualRange
+	// Description	: Returns the range of nodes whose key equals the given
+	//					key. Since keys are unique the range is empty or
+	//					holds one node.
+	// Parameters	:
+	//	@key - the key
+	// Return Value : pair of LowerBound(key) and UpperBound(key)
+	std::pair<iterator, iterator> EqualRange(const KeyType& key) {
+		iterator first = LowerBound(key);
+		iterator last = first;
 
-		T* copied_data = new T[count];
-		for (int i = 0; i < count; i++) {
-			copied_data[i] = T(*(arr_data[i]));
+		if (first != end() && lessKeys(key, first.getKey()) == false) {
+			++last;
 		}
-		if (size != count) {
-			// must reset the tree
-			// Destruct the current tree
-			recursiveDestruct(root);
+		return std::pair<iterator, iterator>(first, last);
+	}
+
+	// Name			: RangeScan
+	// Description	: Visits, in key order, every node whose key is in the
+	//					range [lo, hi). It takes O(log n + k) for k visited
+	//					nodes.
+	// Parameters	:
+	//	@lo			- the lower bound (inclusive)
+	//	@hi			- the upper bound (exclusive)
+	//	@visitor	- callable, invoked as visitor(key, data) for each node
+	// Return Value : the number of visited nodes
+	template<class Visitor>
+	int RangeScan(const KeyType& lo, const KeyType& hi, Visitor visitor) {
+		int count = 0;
+
+		for (Node* node = lowerBoundNode(lo, false);
+				node != NULL && lessKeys(node->getKey(), hi);
+				node = successor(node)) {
+			visitor(node->getKey(), node->getData());
+			count++;
+		}
+		return count;
+	}
 
-			// Generate the new tree
-			int requested_height = getTreeHeightByNodesCount(count);
-			int current_size = std::pow(POWER_TWO, requested_height) - 1;
-			root = createBlankTree(requested_height);
-			trimTreeInOrder(root, &current_size, count);
+	// Name			: Distribute
+	// Description	: Moves every node of the tree to the tree chosen by the
+	//					selector. The nodes are relinked, so their keys and
+	//					data aren't copied and pointers to the data stay
+	//					valid. The trees must use equal allocators.
+	// Parameters	:
+	//	@select - callable, invoked as select(key) for each node, returns
+	//				a pointer to the destination tree (which may be this
+	//				tree)
+	// Return Value : None
+	//	Nodes whose key already exists in their destination stay in this
+	// tree, and AVLTreeKeyAlreadyExistsException is thrown once all the
+	// other nodes were moved. If the selector throws, the nodes which
+	// weren't moved yet are linked back into this tree, and the exception
+	// is rethrown.
+	template<class Selector>
+	void Distribute(Selector select) {
+		Node* current = root;
+		bool duplicate = false;
+
+		root = NULL;
+		minimal = NULL;
+		maximal = NULL;
+		size = INITIAL_SIZE;
+
+		// Flatten the tree into a right leaning list, as destructTree does
+		while (current != NULL) {
+			Node* left = current->getLeft();
+			if (left != NULL) {
+				current->setLeft(left->getRight());
+				left->setRight(current);
+				current = left;
+				continue;
+			}
+
+			Node* next = current->getRight();
+			AVLTree* destination;
+			current->resetLinks();
+			try {
+				destination = select(current->getKey());
+			} catch (...) {
+				attachNode(current);
+				attachAll(next);
+				throw;
+			}
+			if (destination->attachNode(current) == false) {
+				attachNode(current);
+				duplicate = true;
+			}
+			current = next;
 		}
 
-		fillTreeInOrder(root, copied_data, arr_keys, &i);
+		if (duplicate == true) {
+			throw AVLTreeKeyAlreadyExistsException();
+		}
+	}
 
-		updateMinimal(root);
+	// Name			: begin
+	// Description	: Returns an iterator to the node with the minimal key
+	// Parameters	: None
+	// Return Value : iterator to the first node, end() if the tree is empty
+	iterator begin(void) {
+		return iterator(minimal, this);
+	}
 
-		delete[] copied_data;
+	// Name			: end
+	// Description	: Returns the past-the-end iterator of the tree
+	// Parameters	: None
+	// Return Value : past-the-end iterator
+	iterator end(void) {
+		return iterator(NULL, this);
 	}
 
 	//
@@ -1046,17 +2560,136 @@ public:
 		return iterator(minimal, this);
 	}
 
+	//
+	//	Name		:	getMaximal
+	//	Description	:	The function returns the iterator to the maximal node
+	//					in the tree.
+	//	Parameters	: 	None
+	//	Return Value: 	returns an iterator to the maximal node in the tree.
+	iterator getMaximal(void) {
+		if (maximal == NULL) {
+			throw AVLTreeKeyNotFoundException();
+		}
+
+		return iterator(maximal, this);
+	}
+
+	// Name			: PopMin
+	// Description	: Deletes the node with the minimal key, so the tree can
+	//					serve as a priority queue. The node is unlinked
+	//					through it's parent, without a search from the root.
+	// Parameters	:
+	//	@key		- if not NULL, receives the key of the deleted node
+	//	@removed	- if not NULL, receives the data of the deleted node
+	// Return Value : true if a node was deleted, false if the tree is empty
+	bool PopMin(KeyType* key = NULL, T* removed = NULL) {
+		return popNode(minimal, key, removed);
+	}
+
+	// Name			: PopMax
+	// Description	: Deletes the node with the maximal key, as PopMin does
+	//					for the minimal one.
+	// Parameters	:
+	//	@key		- if not NULL, receives the key of the deleted node
+	//	@removed	- if not NULL, receives the data of the deleted node
+	// Return Value : true if a node was deleted, false if the tree is empty
+	bool PopMax(KeyType* key = NULL, T* removed = NULL) {
+		return popNode(maximal, key, removed);
+	}
+
+	//
+	// Order statistics, available when the tree is augmented with
+	// OrderStatisticAugmentation (see OrderStatisticTree)
+	//
+
+	// Name			: Select
+	// Description	: Returns the node with the k-th smallest key, in
+	//					O(log n).
+	// Parameters	:
+	//	@k - the rank of the node, starting from 0
+	// Return Value : iterator to the node
+	// If k isn't in the range [0, getSize()), an exception will be raised.
+	iterator Select(int k) {
+		static_assert(
+				std::is_base_of<OrderStatisticAugmentation, Augmentation>::value,
+				"Select requires OrderStatisticAugmentation");
+		if (k < 0 || k >= size) {
+			throw AVLTreeInvalidArgException();
+		}
+
+		Node* node = root;
+		while (node != NULL) {
+			int left_size = Augmentation::subtreeSize(node->getLeft());
+			if (k < left_size) {
+				node = node->getLeft();
+			} else if (k == left_size) {
+				break;
+			} else {
+				k -= left_size + 1;
+				node = node->getRight();
+			}
+		}
+		return iterator(node, this);
+	}
+
+	// Name			: Rank
+	// Description	: Returns the number of keys less than the given key, in
+	//					O(log n). The key doesn't have to be in the tree.
+	// Parameters	:
+	//	@key - the key
+	// Return Value : the rank of the key
+	int Rank(const KeyType& key) const {
+		static_assert(
+				std::is_base_of<OrderStatisticAugmentation, Augmentation>::value,
+				"Rank requires OrderStatisticAugmentation");
+		int rank = 0;
+
+		Node* node = root;
+		while (node != NULL) {
+			if (lessKeys(node->getKey(), key)) {
+				rank += Augmentation::subtreeSize(node->getLeft()) + 1;
+				node = node->getRight();
+			} else {
+				node = node->getLeft();
+			}
+		}
+		return rank;
+	}
+
+	// Name			: CountInRange
+	// Description	: Returns the number of keys in the range [lo, hi), in
+	//					O(log n).
+	// Parameters	:
+	//	@lo	- the lower bound (inclusive)
+	//	@hi	- the upper bound (exclusive)
+	// Return Value : the number of keys in the range
+	int CountInRange(const KeyType& lo, const KeyType& hi) const {
+		if (lessKeys(lo, hi) == false) {
+			return 0;
+		}
+		return Rank(hi) - Rank(lo);
+	}
+
 };
 
+//
+//	Class		: OrderStatisticTree
+//	Description : AVLTree augmented with subtree sizes
+//
+template<class T, typename KeyType, class Allocator = std::allocator<T> >
+using OrderStatisticTree = AVLTree<T, KeyType, Allocator,
+OrderStatisticAugmentation>;
+
 // Name			: operator<<
 // Description	: << Operator overload, used to print the tree (inorder).
 // Parameters	:
 //	@output - output stream
 //	@tree	- the tree to print
 // Return Value : the output stream is returned
-template<class T, typename KeyType>
+template<class T, typename KeyType, class Allocator, class Augmentation,
+		class Stats, class Compare>
 std::ostream& operator<<(std::ostream& output,
-		const AVLTree<T, KeyType>& tree) {
+		const AVLTree<T, KeyType, Allocator, Augmentation, Stats, Compare>& tree) {
 	tree.inorderOutput(output);
 
 	return output;
@@ -0,0 +1,281 @@
+//
+//	File		: container_benchmarks.cpp
+//	Description	: Google Benchmark suite of the containers, next to
+//					std::map and std::unordered_map. Every container runs
+//					the same workloads:
+//					Insert	- builds a container of n mappings
+//					Find	- lookups with a hit ratio of 100, 50 and 0
+//							  percent
+//					Erase	- removes all the mappings of a container
+//					Churn	- replaces one mapping per two operations, in a
+//							  container whose size sits on the grow
+//							  threshold of HashMap
+//					Resize	- grows a container of n mappings four times
+//							  (the containers which support Reserve)
+//					With sequential, uniform and Zipfian keys (see
+//					workloads.hpp), and sizes from 1K up to --max_size
+//					(default 1M, the suite goes up to 100M).
+//					Every benchmark reports it's rate in items_per_second
+//					(operations, or moved mappings for Resize), time_per_op,
+//					and bytes_per_entry for the memory the container holds.
+//
+
+#include "workloads.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+//
+// Constants
+//
+static const unsigned SEED = 20240601;
+static const long DEFAULT_MAX_SIZE = 1000000;
+static const long MIN_SIZE = 1000;
+static const long SIZE_FACTOR = 10;
+// Churn sizes are the grow thresholds of HashMap, 0.75 * 1024 * 16^k
+static const long MIN_CHURN_SIZE = 768;
+static const long CHURN_FACTOR = 16;
+// Length of the lookup streams, a power of two
+static const long STREAM_LENGTH = 1 << 20;
+static const int HIT_PERCENTS[] = { 100, 50, 0 };
+static const Distribution DISTRIBUTIONS[] = { SEQUENTIAL, UNIFORM, ZIPFIAN };
+
+// Name			: reportCounters
+// Description	: Sets the rate counters of a benchmark
+// Parameters	:
+//	@state			- the benchmark state
+//	@ops			- number of operations (or items) of all the iterations
+//	@bytes_per_entry - memory held by the container per mapping
+// Return Value : None
+static void reportCounters(benchmark::State& state, double ops,
+		double bytes_per_entry) {
+	state.SetItemsProcessed((int64_t) ops);
+	state.counters["time_per_op"] = benchmark::Counter(ops,
+			benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+	state.counters["bytes_per_entry"] = bytes_per_entry;
+}
+
+// Name			: build
+// Description	: Creates a container with the given keys, each mapped to
+//					itself.
+// Parameters	:
+//	@keys	- the keys
+//	@bytes	- receives the memory the container holds
+// Return Value : the new container
+template<class Map>
+static Map* build(const std::vector<BenchKey>& keys, long long* bytes) {
+	long long before = LiveBytes();
+	Map* map = new Map();
+
+	for (size_t i = 0; i < keys.size(); i++) {
+		MapAdapter<Map>::Insert(*map, keys[i], keys[i]);
+	}
+	*bytes = LiveBytes() - before;
+	return map;
+}
+
+template<class Map>
+static void BM_Insert(benchmark::State& state, Distribution distribution) {
+	long n = (long) state.range(0);
+	std::vector<BenchKey> keys = InsertOrder(distribution, n, SEED);
+	long long bytes = 0;
+
+	for (auto _ : state) {
+		long long before = LiveBytes();
+		Map* map = new Map();
+		for (long i = 0; i < n; i++) {
+			MapAdapter<Map>::Insert(*map, keys[i], keys[i]);
+		}
+
+		state.PauseTiming();
+		bytes = LiveBytes() - before;
+		delete map;
+		state.ResumeTiming();
+	}
+	reportCounters(state, (double) state.iterations() * n,
+			(double) bytes / n);
+}
+
+template<class Map>
+static void BM_Find(benchmark::State& state, Distribution distribution,
+		int hit_percent) {
+	long n = (long) state.range(0);
+	long long bytes;
+	Map* map = build<Map>(InsertOrder(distribution, n, SEED), &bytes);
+	std::vector<BenchKey> stream = LookupStream(distribution, n,
+			STREAM_LENGTH, hit_percent, SEED + 1);
+	size_t position = 0;
+
+	for (auto _ : state) {
+		BenchValue value = 0;
+		bool found = MapAdapter<Map>::Find(*map, stream[position], &value);
+		benchmark::DoNotOptimize(found);
+		benchmark::DoNotOptimize(value);
+		position = (position + 1) & (STREAM_LENGTH - 1);
+	}
+	reportCounters(state, (double) state.iterations(), (double) bytes / n);
+	delete map;
+}
+
+template<class Map>
+static void BM_Erase(benchmark::State& state, Distribution distribution) {
+	long n = (long) state.range(0);
+	std::vector<BenchKey> keys = InsertOrder(distribution, n, SEED);
+	long long bytes = 0;
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		Map* map = build<Map>(keys, &bytes);
+		state.ResumeTiming();
+
+		for (long i = 0; i < n; i++) {
+			MapAdapter<Map>::Erase(*map, keys[i]);
+		}
+
+		state.PauseTiming();
+		delete map;
+		state.ResumeTiming();
+	}
+	reportCounters(state, (double) state.iterations() * n,
+			(double) bytes / n);
+}
+
+template<class Map>
+static void BM_Churn(benchmark::State& state, Distribution distribution) {
+	long n = (long) state.range(0);
+	std::vector<BenchKey> present = InsertOrder(distribution, n, SEED);
+	long long bytes;
+	Map* map = build<Map>(present, &bytes);
+	// The victims are slots of the present keys, picked by the
+	// distribution
+	std::vector<BenchKey> victims = LookupStream(distribution, n,
+			STREAM_LENGTH, 100, SEED + 2);
+	BenchKey next_key = StoredKey(n);
+	size_t position = 0;
+
+	for (auto _ : state) {
+		// The victim's slot in the present keys, a stored key is 2 * slot
+		size_t slot = (size_t) (victims[position] / 2);
+		MapAdapter<Map>::Erase(*map, present[slot]);
+		MapAdapter<Map>::Insert(*map, next_key, next_key);
+		present[slot] = next_key;
+		next_key += 2;
+		position = (position + 1) & (STREAM_LENGTH - 1);
+	}
+	reportCounters(state, 2.0 * (double) state.iterations(),
+			(double) bytes / n);
+	delete map;
+}
+
+template<class Map>
+static void BM_Resize(benchmark::State& state, Distribution distribution) {
+	long n = (long) state.range(0);
+	std::vector<BenchKey> keys = InsertOrder(distribution, n, SEED);
+	long long bytes = 0;
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		Map* map = build<Map>(keys, &bytes);
+		state.ResumeTiming();
+
+		MapAdapter<Map>::Reserve(*map, 4 * n);
+
+		state.PauseTiming();
+		delete map;
+		state.ResumeTiming();
+	}
+	reportCounters(state, (double) state.iterations() * n,
+			(double) bytes / n);
+}
+
+// Name			: registerContainer
+// Description	: Registers all the workloads of a container
+// Parameters	:
+//	@name		- the name of the container in the benchmark names
+//	@max_size	- the largest container size
+// Return Value : None
+template<class Map>
+static void registerContainer(const std::string& name, long max_size) {
+	for (size_t d = 0; d < sizeof(DISTRIBUTIONS) / sizeof(*DISTRIBUTIONS);
+			d++) {
+		Distribution distribution = DISTRIBUTIONS[d];
+		std::string suffix = name + "/" + DistributionName(distribution);
+		std::vector<benchmark::internal::Benchmark*> sized;
+
+		sized.push_back(benchmark::RegisterBenchmark(
+				("Insert/" + suffix).c_str(), &BM_Insert<Map>, distribution));
+		for (size_t h = 0; h < sizeof(HIT_PERCENTS) / sizeof(*HIT_PERCENTS);
+				h++) {
+			std::string hits = "/hit" + std::to_string(HIT_PERCENTS[h]);
+			sized.push_back(benchmark::RegisterBenchmark(
+					("Find/" + suffix + hits).c_str(), &BM_Find<Map>,
+					distribution, HIT_PERCENTS[h]));
+		}
+		sized.push_back(benchmark::RegisterBenchmark(
+				("Erase/" + suffix).c_str(), &BM_Erase<Map>, distribution));
+		if (MapAdapter<Map>::RESERVE) {
+			sized.push_back(benchmark::RegisterBenchmark(
+					("Resize/" + suffix).c_str(), &BM_Resize<Map>,
+					distribution));
+		}
+
+		for (size_t i = 0; i < sized.size(); i++) {
+			for (long size = MIN_SIZE; size <= max_size; size *= SIZE_FACTOR) {
+				sized[i]->Arg(size);
+			}
+			sized[i]->Unit(benchmark::kNanosecond);
+		}
+
+		benchmark::internal::Benchmark* churn = benchmark::RegisterBenchmark(
+				("Churn/" + suffix).c_str(), &BM_Churn<Map>, distribution);
+		for (long size = MIN_CHURN_SIZE; size <= max_size; size *=
+				CHURN_FACTOR) {
+			churn->Arg(size);
+		}
+		churn->Unit(benchmark::kNanosecond);
+	}
+}
+
+// Name			: takeMaxSize
+// Description	: Removes the --max_size=N flag from the arguments, which
+//					Google Benchmark doesn't know.
+// Parameters	:
+//	@argc	- number of arguments
+//	@argv	- the arguments
+// Return Value : the flag value, or DEFAULT_MAX_SIZE
+static long takeMaxSize(int* argc, char** argv) {
+	static const char FLAG[] = "--max_size=";
+	long max_size = DEFAULT_MAX_SIZE;
+	int kept = 1;
+
+	for (int i = 1; i < *argc; i++) {
+		if (std::strncmp(argv[i], FLAG, sizeof(FLAG) - 1) == 0) {
+			max_size = std::atol(argv[i] + sizeof(FLAG) - 1);
+		} else {
+			argv[kept++] = argv[i];
+		}
+	}
+	*argc = kept;
+	return max_size;
+}
+
+int main(int argc, char** argv) {
+	long max_size = takeMaxSize(&argc, argv);
+
+	registerContainer<BenchAVLTree>("AVLTree", max_size);
+	registerContainer<BenchBPlusTree>("BPlusTree", max_size);
+	registerContainer<BenchChainedHashMap>("HashMap<Chained>", max_size);
+	registerContainer<BenchFlatHashMap>("HashMap<Flat>", max_size);
+	registerContainer<BenchConcurrentHashMap>("ConcurrentHashMap", max_size);
+	registerContainer<BenchStdMap>("std::map", max_size);
+	registerContainer<BenchStdUnorderedMap>("std::unordered_map", max_size);
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+		return 1;
+	}
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
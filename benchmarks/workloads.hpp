@@ -0,0 +1,354 @@
+#ifndef BENCHMARKS_WORKLOADS_HPP_
+#define BENCHMARKS_WORKLOADS_HPP_
+
+//
+//	File		: workloads.hpp
+//	Description	: Key streams, memory accounting and container adapters
+//					of the benchmarks (container_benchmarks.cpp).
+//					The keys stored in a container are the even numbers
+//					2 * i, for i in [0, n), so any odd key is a miss.
+//
+
+#include <exception>
+#include "avltree.hpp"
+#include "bplus_tree.hpp"
+#include "concurrent_hash_map.hpp"
+#include "flat_hash_map.hpp"
+#include "hash_map.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+typedef long BenchKey;
+typedef long BenchValue;
+
+// Name			: LiveBytes
+// Description	: Returns the number of bytes held by all the copies and
+//					rebinds of CountingAllocator
+inline long long& LiveBytes() {
+	static long long bytes = 0;
+	return bytes;
+}
+
+//
+//	Class		: CountingAllocator
+//	Description : std::allocator which adds the blocks it holds to
+//					LiveBytes. The benchmarks are single threaded, so the
+//					counter is a plain global.
+//
+template<class T> class CountingAllocator {
+public:
+	typedef T value_type;
+
+	CountingAllocator() {
+	}
+
+	template<class U>
+	CountingAllocator(const CountingAllocator<U>&) {
+	}
+
+	T* allocate(size_t count) {
+		LiveBytes() += (long long) (count * sizeof(T));
+		return std::allocator<T>().allocate(count);
+	}
+
+	void deallocate(T* block, size_t count) {
+		LiveBytes() -= (long long) (count * sizeof(T));
+		std::allocator<T>().deallocate(block, count);
+	}
+
+	template<class U>
+	bool operator==(const CountingAllocator<U>&) const {
+		return true;
+	}
+
+	template<class U>
+	bool operator!=(const CountingAllocator<U>&) const {
+		return false;
+	}
+};
+
+//
+//	Enum		: Distribution
+//	Description : Order of the keys which are inserted and looked up.
+//	SEQUENTIAL	- increasing keys, lookups cycle over them
+//	UNIFORM		- keys in random order, lookups pick any key alike
+//	ZIPFIAN		- keys in random order, lookups follow a Zipf law
+//					(skew 0.99, as in YCSB), scattered over the key space
+//
+enum Distribution {
+	SEQUENTIAL, UNIFORM, ZIPFIAN
+};
+
+inline const char* DistributionName(Distribution distribution) {
+	switch (distribution) {
+	case SEQUENTIAL:
+		return "sequential";
+	case UNIFORM:
+		return "uniform";
+	default:
+		return "zipfian";
+	}
+}
+
+//
+//	Class		: ZipfianGenerator
+//	Description : Draws ranks in [0, n) with P(rank) proportional to
+//					1 / (rank + 1) ^ theta, in O(1) per draw (Gray et al.,
+//					"Quickly generating billion-record synthetic
+//					databases"). The setup is O(n).
+//
+class ZipfianGenerator {
+private:
+	long n;
+	double theta;
+	double alpha;
+	double zetan;
+	double eta;
+	std::uniform_real_distribution<double> uniform;
+
+	static double zeta(long count, double theta) {
+		double sum = 0;
+		for (long i = 1; i <= count; i++) {
+			sum += 1.0 / std::pow((double) i, theta);
+		}
+		return sum;
+	}
+
+public:
+	static constexpr double DEFAULT_THETA = 0.99;
+
+	explicit ZipfianGenerator(long n, double theta = DEFAULT_THETA) :
+			n(n), theta(theta), alpha(1.0 / (1.0 - theta)), zetan(
+					zeta(n, theta)), uniform(0.0, 1.0) {
+		eta = (1.0 - std::pow(2.0 / (double) n, 1.0 - theta))
+				/ (1.0 - zeta(2, theta) / zetan);
+	}
+
+	template<class Engine>
+	long operator()(Engine& engine) {
+		double u = uniform(engine);
+		double uz = u * zetan;
+
+		if (uz < 1.0) {
+			return 0;
+		}
+		if (uz < 1.0 + std::pow(0.5, theta)) {
+			return 1;
+		}
+		long rank = (long) ((double) n
+				* std::pow(eta * u - eta + 1.0, alpha));
+		return (rank < n) ? rank : n - 1;
+	}
+};
+
+// Name			: StoredKey
+// Description	: Returns the i-th key stored in a container
+inline BenchKey StoredKey(long index) {
+	return 2 * (BenchKey) index;
+}
+
+// Name			: InsertOrder
+// Description	: Returns the stored keys of a container of n mappings, in
+//					the order they're inserted.
+// Parameters	:
+//	@distribution	- SEQUENTIAL inserts in increasing order, the others in
+//						random order
+//	@n				- number of keys
+//	@seed			- seed of the random order
+// Return Value : the keys
+inline std::vector<BenchKey> InsertOrder(Distribution distribution, long n,
+		unsigned seed) {
+	std::vector<BenchKey> keys((size_t) n);
+
+	for (long i = 0; i < n; i++) {
+		keys[(size_t) i] = StoredKey(i);
+	}
+	if (distribution != SEQUENTIAL) {
+		std::mt19937_64 engine(seed);
+		std::shuffle(keys.begin(), keys.end(), engine);
+	}
+	return keys;
+}
+
+// Name			: LookupStream
+// Description	: Returns a stream of lookup keys into a container of n
+//					mappings.
+// Parameters	:
+//	@distribution	- which stored keys are looked up
+//	@n				- number of stored keys
+//	@count			- length of the stream
+//	@hit_percent	- the percent of the keys which are stored, the others
+//						are misses next to a stored key
+//	@seed			- seed of the stream
+// Return Value : the keys
+inline std::vector<BenchKey> LookupStream(Distribution distribution, long n,
+		long count, int hit_percent, unsigned seed) {
+	std::vector<BenchKey> keys((size_t) count);
+	std::mt19937_64 engine(seed);
+	std::uniform_int_distribution<long> any(0, n - 1);
+	std::uniform_int_distribution<int> percent(0, 99);
+	ZipfianGenerator* zipf = NULL;
+
+	if (distribution == ZIPFIAN) {
+		zipf = new ZipfianGenerator(n);
+	}
+	for (long i = 0; i < count; i++) {
+		long index;
+		if (distribution == SEQUENTIAL) {
+			index = i % n;
+		} else if (distribution == UNIFORM) {
+			index = any(engine);
+		} else {
+			// Scatter the ranks, so the hot keys aren't neighbours
+			index = (long) (((uint64_t) (*zipf)(engine)
+					* 0x9E3779B97F4A7C15ull) % (uint64_t) n);
+		}
+
+		keys[(size_t) i] = StoredKey(index);
+		if (percent(engine) >= hit_percent) {
+			keys[(size_t) i] += 1;
+		}
+	}
+	delete zipf;
+	return keys;
+}
+
+//
+//	Class		: MapAdapter
+//	Description : The operations the benchmarks run on a container.
+//					RESERVE tells whether the container can be resized on
+//					demand (the Resize benchmark). The containers of this
+//					repository share the interface of LibraryAdapter, the
+//					standard ones that of StdAdapter.
+//
+template<class Map> struct LibraryAdapter {
+	static bool Insert(Map& map, BenchKey key, BenchValue value) {
+		return map.TryEmplace(key, value).second;
+	}
+
+	static bool Find(Map& map, BenchKey key, BenchValue* value) {
+		BenchValue* found = map.TryFind(key);
+		if (found == NULL) {
+			return false;
+		}
+		*value = *found;
+		return true;
+	}
+
+	static bool Erase(Map& map, BenchKey key) {
+		return map.Erase(key);
+	}
+};
+
+template<class Map> struct StdAdapter {
+	static bool Insert(Map& map, BenchKey key, BenchValue value) {
+		return map.emplace(key, value).second;
+	}
+
+	static bool Find(Map& map, BenchKey key, BenchValue* value) {
+		typename Map::const_iterator it = map.find(key);
+		if (it == map.end()) {
+			return false;
+		}
+		*value = it->second;
+		return true;
+	}
+
+	static bool Erase(Map& map, BenchKey key) {
+		return (map.erase(key) != 0);
+	}
+};
+
+template<class Map> struct MapAdapter: LibraryAdapter<Map> {
+	static const bool RESERVE = false;
+
+	static void Reserve(Map&, long) {
+	}
+};
+
+template<class Storage, class Hash, class Allocator>
+struct MapAdapter<HashMap<BenchValue, BenchKey, Storage, Hash, Allocator> > : LibraryAdapter<
+		HashMap<BenchValue, BenchKey, Storage, Hash, Allocator> > {
+	static const bool RESERVE = true;
+
+	static void Reserve(
+			HashMap<BenchValue, BenchKey, Storage, Hash, Allocator>& map,
+			long count) {
+		map.Reserve((int) count);
+	}
+};
+
+// Values are returned by copy, see concurrent_hash_map.hpp
+template<class Storage, class Hash, class Allocator>
+struct MapAdapter<
+		ConcurrentHashMap<BenchValue, BenchKey, Storage, Hash, Allocator> > {
+	typedef ConcurrentHashMap<BenchValue, BenchKey, Storage, Hash, Allocator> Map;
+	static const bool RESERVE = true;
+
+	static bool Insert(Map& map, BenchKey key, BenchValue value) {
+		return map.TryEmplace(key, value);
+	}
+
+	static bool Find(Map& map, BenchKey key, BenchValue* value) {
+		return map.TryFind(key, value);
+	}
+
+	static bool Erase(Map& map, BenchKey key) {
+		return map.Erase(key);
+	}
+
+	static void Reserve(Map& map, long count) {
+		map.Reserve((int) count);
+	}
+};
+
+template<class Compare, class Allocator>
+struct MapAdapter<std::map<BenchKey, BenchValue, Compare, Allocator> > : StdAdapter<
+		std::map<BenchKey, BenchValue, Compare, Allocator> > {
+	static const bool RESERVE = false;
+
+	static void Reserve(std::map<BenchKey, BenchValue, Compare, Allocator>&,
+			long) {
+	}
+};
+
+template<class Hash, class Equal, class Allocator>
+struct MapAdapter<
+		std::unordered_map<BenchKey, BenchValue, Hash, Equal, Allocator> > : StdAdapter<
+		std::unordered_map<BenchKey, BenchValue, Hash, Equal, Allocator> > {
+	static const bool RESERVE = true;
+
+	static void Reserve(
+			std::unordered_map<BenchKey, BenchValue, Hash, Equal, Allocator>& map,
+			long count) {
+		map.reserve((size_t) count);
+	}
+};
+
+//
+// The benchmarked containers, all allocating through CountingAllocator
+//
+typedef CountingAllocator<BenchValue> BenchAllocator;
+typedef CountingAllocator<std::pair<const BenchKey, BenchValue> > StdAllocator;
+
+typedef AVLTree<BenchValue, BenchKey, BenchAllocator> BenchAVLTree;
+typedef BPlusTree<BenchValue, BenchKey, BenchAllocator> BenchBPlusTree;
+typedef HashMap<BenchValue, BenchKey, ChainedStorage, DefaultHash<BenchKey>,
+		BenchAllocator> BenchChainedHashMap;
+typedef HashMap<BenchValue, BenchKey, FlatStorage, DefaultHash<BenchKey>,
+		BenchAllocator> BenchFlatHashMap;
+typedef ConcurrentHashMap<BenchValue, BenchKey, ChainedStorage,
+		DefaultHash<BenchKey>, BenchAllocator> BenchConcurrentHashMap;
+typedef std::map<BenchKey, BenchValue, std::less<BenchKey>, StdAllocator> BenchStdMap;
+typedef std::unordered_map<BenchKey, BenchValue, std::hash<BenchKey>,
+		std::equal_to<BenchKey>, StdAllocator> BenchStdUnorderedMap;
+
+#endif /* BENCHMARKS_WORKLOADS_HPP_ */
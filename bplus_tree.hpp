@@ -0,0 +1,1194 @@
+#ifndef BPLUS_TREE_HPP_
+#define BPLUS_TREE_HPP_
+
+//
+//	File		: bplus_tree.hpp
+//	Description	: Generic implementation of a B+ tree, with the interface
+//					of AVLTree. Every node holds many keys in a few cache
+//					lines, so a lookup touches about log_B(n) nodes instead
+//					of log2(n). The data lives in the leaves, which are
+//					linked in key order, so iteration and range scans walk
+//					contiguous arrays.
+//					Unlike AVLTree, the data moves when leaves are split or
+//					merged: pointers to the data and iterators are
+//					invalidated by Insert and Delete. The keys and data
+//					must be movable without throwing.
+//
+
+#include <exception>
+#include "exceptions.hpp"
+#include "simd.hpp"
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template<class T, typename KeyType, class Allocator = std::allocator<T> >
+class BPlusTree {
+
+protected:
+	//
+	// Constants
+	//
+	static const size_t CACHE_LINE = 64;
+	// The keys (and data) of a node take about this many bytes
+	static const size_t NODE_BYTES = 4 * CACHE_LINE;
+	static const int MIN_CAPACITY = 3;
+	static const int LEAF_CAPACITY =
+			(NODE_BYTES / (sizeof(KeyType) + sizeof(T)) > MIN_CAPACITY) ?
+					(int) (NODE_BYTES / (sizeof(KeyType) + sizeof(T))) :
+					MIN_CAPACITY;
+	static const int INTERNAL_CAPACITY =
+			(NODE_BYTES / (sizeof(KeyType) + sizeof(void*)) > MIN_CAPACITY) ?
+					(int) (NODE_BYTES / (sizeof(KeyType) + sizeof(void*))) :
+					MIN_CAPACITY;
+	// A node (other than the root) never holds less than this
+	static const int LEAF_MIN = LEAF_CAPACITY / 2;
+	static const int INTERNAL_MIN = INTERNAL_CAPACITY / 2;
+	static const int MAX_DEPTH = 64;
+	static const int INITIAL_SIZE = 0;
+
+	//
+	//	Class		: Slots
+	//	Description : Fixed array of uninitialized slots, whose objects are
+	//					constructed and destroyed one by one.
+	//
+	template<class U, int N> class Slots {
+	private:
+		typename std::aligned_storage<sizeof(U), alignof(U)>::type storage[N];
+
+	public:
+		U& operator[](int index) {
+			return *reinterpret_cast<U*>(&storage[index]);
+		}
+
+		const U& operator[](int index) const {
+			return *reinterpret_cast<const U*>(&storage[index]);
+		}
+
+		const U* data() const {
+			return reinterpret_cast<const U*>(storage);
+		}
+
+		template<class ... Args>
+		void construct(int index, Args&&... args) {
+			new (&storage[index]) U(std::forward<Args>(args)...);
+		}
+
+		void destroy(int index) {
+			(*this)[index].~U();
+		}
+
+		// Name			: openGap
+		// Description	: Moves the objects [pos, count) one slot right,
+		//					leaving the slot pos empty.
+		void openGap(int pos, int count) {
+			for (int i = count; i > pos; i--) {
+				construct(i, std::move((*this)[i - 1]));
+				destroy(i - 1);
+			}
+		}
+
+		// Name			: closeGap
+		// Description	: Moves the objects [pos + 1, count) one slot left,
+		//					into the empty slot pos.
+		void closeGap(int pos, int count) {
+			for (int i = pos; i < count - 1; i++) {
+				construct(i, std::move((*this)[i + 1]));
+				destroy(i + 1);
+			}
+		}
+	};
+
+	//
+	//	Class		: NodeBase
+	//	Description : The common part of the tree nodes
+	//
+	struct NodeBase {
+		bool leaf;
+		int count;
+
+		explicit NodeBase(bool leaf) :
+				leaf(leaf), count(0) {
+		}
+	};
+
+	//
+	//	Class		: Leaf
+	//	Description : Leaf node, which holds the keys and their data in
+	//					separate arrays. Every array has one spare slot, so
+	//					a full leaf can take a key before it's split.
+	//
+	struct Leaf: public NodeBase {
+		Leaf* prev;
+		Leaf* next;
+		Slots<KeyType, LEAF_CAPACITY + 1> keys;
+		Slots<T, LEAF_CAPACITY + 1> values;
+
+		Leaf() :
+				NodeBase(true), prev(NULL), next(NULL) {
+		}
+	};
+
+	//
+	//	Class		: Internal
+	//	Description : Internal node. The subtree of children[i] holds the
+	//					keys in [keys[i - 1], keys[i]).
+	//
+	struct Internal: public NodeBase {
+		Slots<KeyType, INTERNAL_CAPACITY + 1> keys;
+		NodeBase* children[INTERNAL_CAPACITY + 2];
+
+		Internal() :
+				NodeBase(false) {
+		}
+	};
+
+private:
+	typedef std::allocator_traits<Allocator> AllocatorTraits;
+	typedef typename AllocatorTraits::template rebind_alloc<Leaf> LeafAllocator;
+	typedef std::allocator_traits<LeafAllocator> LeafAllocatorTraits;
+	typedef typename AllocatorTraits::template rebind_alloc<Internal> InternalAllocator;
+	typedef std::allocator_traits<InternalAllocator> InternalAllocatorTraits;
+
+	NodeBase* root;
+	Leaf* first_leaf;
+	Leaf* last_leaf;
+	int size;
+	Allocator alloc;
+
+	BPlusTree(const BPlusTree&);
+	BPlusTree& operator=(const BPlusTree&);
+
+	// Name			: createLeaf / createInternal
+	// Description	: Allocates an empty node with the tree's allocator.
+	// Parameters	: None
+	// Return Value : pointer to the new node
+	// If memory allocation failes, a matching exception would be thrown by
+	//	the system.
+	Leaf* createLeaf(void) {
+		LeafAllocator leaf_alloc(alloc);
+		Leaf* leaf = LeafAllocatorTraits::allocate(leaf_alloc, 1);
+		LeafAllocatorTraits::construct(leaf_alloc, leaf);
+		return leaf;
+	}
+
+	Internal* createInternal(void) {
+		InternalAllocator internal_alloc(alloc);
+		Internal* node = InternalAllocatorTraits::allocate(internal_alloc, 1);
+		InternalAllocatorTraits::construct(internal_alloc, node);
+		return node;
+	}
+
+	// Name			: destroyNode
+	// Description	: Frees a node. The objects in it must be destroyed
+	//					already.
+	// Parameters	:
+	//	@node - the node to free
+	// Return Value : None
+	void destroyNode(NodeBase* node) {
+		if (node->leaf == true) {
+			LeafAllocator leaf_alloc(alloc);
+			Leaf* leaf = static_cast<Leaf*>(node);
+			LeafAllocatorTraits::destroy(leaf_alloc, leaf);
+			LeafAllocatorTraits::deallocate(leaf_alloc, leaf, 1);
+		} else {
+			InternalAllocator internal_alloc(alloc);
+			Internal* internal = static_cast<Internal*>(node);
+			InternalAllocatorTraits::destroy(internal_alloc, internal);
+			InternalAllocatorTraits::deallocate(internal_alloc, internal, 1);
+		}
+	}
+
+	// Name			: destructTree
+	// Description	: Destroys all the objects and nodes of a subtree.
+	//					The recursion depth is the height of the tree.
+	// Parameters	:
+	//	@node - the subtree root
+	// Return Value : None
+	void destructTree(NodeBase* node) {
+		if (node == NULL) {
+			return;
+		}
+
+		if (node->leaf == true) {
+			Leaf* leaf = static_cast<Leaf*>(node);
+			for (int i = 0; i < leaf->count; i++) {
+				leaf->keys.destroy(i);
+				leaf->values.destroy(i);
+			}
+		} else {
+			Internal* internal = static_cast<Internal*>(node);
+			for (int i = 0; i < internal->count; i++) {
+				internal->keys.destroy(i);
+			}
+			for (int i = 0; i <= internal->count; i++) {
+				destructTree(internal->children[i]);
+			}
+		}
+		destroyNode(node);
+	}
+
+	// Name			: lowerBoundIndex
+	// Description	: Searches the first key of a node which isn't less
+	//					than (or, for an upper bound, is greater than) the
+	//					given key. Integer keys are ranked with the vector
+	//					kernels of simd.hpp, other keys by binary search.
+	// Parameters	:
+	//	@keys	- the keys of the node
+	//	@count	- number of keys
+	//	@key	- the bound
+	//	@upper	- true for an upper bound
+	// Return Value : the index of the key, count if there's none
+	template<class KeySlots>
+	static int lowerBoundIndex(const KeySlots& keys, int count,
+			const KeyType& key, bool upper) {
+		return lowerBoundIndex(keys, count, key, upper,
+				SimdKeys::Supported<KeyType>());
+	}
+
+	template<class KeySlots>
+	static int lowerBoundIndex(const KeySlots& keys, int count,
+			const KeyType& key, bool upper, std::true_type) {
+		return upper ?
+				SimdKeys::CountLessEqual(keys.data(), count, key) :
+				SimdKeys::CountLess(keys.data(), count, key);
+	}
+
+	template<class KeySlots>
+	static int lowerBoundIndex(const KeySlots& keys, int count,
+			const KeyType& key, bool upper, std::false_type) {
+		int first = 0;
+
+		while (count > 0) {
+			int half = count / 2;
+			bool before =
+					upper ? !(key < keys[first + half]) :
+							(keys[first + half] < key);
+			if (before == true) {
+				first += half + 1;
+				count -= half + 1;
+			} else {
+				count = half;
+			}
+		}
+		return first;
+	}
+
+	// Name			: findLeaf
+	// Description	: Descends to the leaf which may hold the given key
+	// Parameters	:
+	//	@key	- the key
+	//	@path	- if not NULL, receives the internal nodes on the way
+	//	@indexes- if not NULL, receives the child index taken in each one
+	//	@depth	- if not NULL, receives the number of internal nodes
+	// Return Value : the leaf, NULL if the tree is empty
+	Leaf* findLeaf(const KeyType& key, Internal** path, int* indexes,
+			int* depth) const {
+		NodeBase* node = root;
+		int level = 0;
+
+		while (node != NULL && node->leaf == false) {
+			Internal* internal = static_cast<Internal*>(node);
+			int index = lowerBoundIndex(internal->keys, internal->count, key,
+					true);
+			if (path != NULL) {
+				path[level] = internal;
+				indexes[level] = index;
+			}
+			level++;
+			node = internal->children[index];
+		}
+
+		if (depth != NULL) {
+			*depth = level;
+		}
+		return static_cast<Leaf*>(node);
+	}
+
+	// Name			: findEntry
+	// Description	: Searches the given key
+	// Parameters	:
+	//	@key	- the key
+	//	@index	- receives the index of the key in the returned leaf
+	// Return Value : the leaf which holds the key, NULL if it wasn't found
+	Leaf* findEntry(const KeyType& key, int* index) const {
+		Leaf* leaf = findLeaf(key, NULL, NULL, NULL);
+		if (leaf == NULL) {
+			return NULL;
+		}
+
+		int pos = lowerBoundIndex(leaf->keys, leaf->count, key, false);
+		if (pos == leaf->count || key < leaf->keys[pos]) {
+			return NULL;
+		}
+		*index = pos;
+		return leaf;
+	}
+
+	// Name			: boundEntry
+	// Description	: Searches the first entry whose key isn't less than (or,
+	//					for an upper bound, is greater than) the given key.
+	// Parameters	:
+	//	@key	- the bound
+	//	@upper	- true for an upper bound
+	//	@index	- receives the index of the entry in the returned leaf
+	// Return Value : the leaf of the entry, NULL if there's none
+	Leaf* boundEntry(const KeyType& key, bool upper, int* index) const {
+		Leaf* leaf = findLeaf(key, NULL, NULL, NULL);
+		if (leaf == NULL) {
+			return NULL;
+		}
+
+		int pos = lowerBoundIndex(leaf->keys, leaf->count, key, upper);
+		if (pos == leaf->count) {
+			// The entry is the first one of the next leaf
+			leaf = leaf->next;
+			pos = 0;
+		}
+		*index = pos;
+		return leaf;
+	}
+
+	// Name			: splitLeaf
+	// Description	: Moves the upper half of an overfull leaf to a new leaf,
+	//					which is linked after it.
+	// Parameters	:
+	//	@leaf	- the overfull leaf
+	//	@right	- the new (empty) leaf
+	// Return Value : None
+	void splitLeaf(Leaf* leaf, Leaf* right) {
+		int half = leaf->count / 2;
+
+		for (int i = half; i < leaf->count; i++) {
+			right->keys.construct(i - half, std::move(leaf->keys[i]));
+			right->values.construct(i - half, std::move(leaf->values[i]));
+			leaf->keys.destroy(i);
+			leaf->values.destroy(i);
+		}
+		right->count = leaf->count - half;
+		leaf->count = half;
+
+		right->next = leaf->next;
+		right->prev = leaf;
+		if (leaf->next != NULL) {
+			leaf->next->prev = right;
+		}
+		leaf->next = right;
+		if (last_leaf == leaf) {
+			last_leaf = right;
+		}
+	}
+
+	// Name			: splitInternal
+	// Description	: Moves the upper half of an overfull internal node to a
+	//					new node. The middle key is moved up.
+	// Parameters	:
+	//	@node	- the overfull node
+	//	@right	- the new (empty) node
+	//	@middle	- receives the middle key, an uninitialized slot
+	// Return Value : None
+	void splitInternal(Internal* node, Internal* right, KeyType* middle) {
+		int half = node->count / 2;
+
+		new (middle) KeyType(std::move(node->keys[half]));
+		node->keys.destroy(half);
+		for (int i = half + 1; i < node->count; i++) {
+			right->keys.construct(i - half - 1, std::move(node->keys[i]));
+			node->keys.destroy(i);
+		}
+		for (int i = half + 1; i <= node->count; i++) {
+			right->children[i - half - 1] = node->children[i];
+		}
+		right->count = node->count - half - 1;
+		node->count = half;
+	}
+
+	// Name			: insertChild
+	// Description	: Inserts a separator key and the child after it to an
+	//					internal node (which has a spare slot).
+	// Parameters	:
+	//	@node	- the node
+	//	@index	- the index of the key
+	//	@key	- the separator key
+	//	@child	- the new child, which holds the keys from the separator on
+	// Return Value : None
+	static void insertChild(Internal* node, int index, KeyType&& key,
+			NodeBase* child) {
+		node->keys.openGap(index, node->count);
+		node->keys.construct(index, std::move(key));
+		for (int i = node->count + 1; i > index + 1; i--) {
+			node->children[i] = node->children[i - 1];
+		}
+		node->children[index + 1] = child;
+		node->count++;
+	}
+
+	// Name			: removeChild
+	// Description	: Removes a separator key and the child after it from an
+	//					internal node.
+	// Parameters	:
+	//	@node	- the node
+	//	@index	- the index of the key
+	// Return Value : None
+	static void removeChild(Internal* node, int index) {
+		node->keys.destroy(index);
+		node->keys.closeGap(index, node->count);
+		for (int i = index + 1; i < node->count; i++) {
+			node->children[i] = node->children[i + 1];
+		}
+		node->count--;
+	}
+
+	// Name			: insertKey
+	// Description	: Inserts a new entry with the given key, unless the key
+	//					already exists. The nodes which full nodes on the path
+	//					split into are allocated first, so a failed
+	//					allocation, or a key or data constructor which
+	//					throws, leaves the tree unchanged.
+	// Parameters	:
+	//	@key		- the key of the new entry
+	//	@inserted	- set to true if a new entry was created, false if the
+	//					key already existed
+	//	@args		- the arguments of the data constructor
+	// Return Value : Pointer to the data of the key
+	template<class Key, class ... Args>
+	T* insertKey(Key&& key, bool* inserted, Args&&... args) {
+		Internal* path[MAX_DEPTH];
+		int indexes[MAX_DEPTH];
+		int depth;
+
+		*inserted = false;
+		if (root == NULL) {
+			root = first_leaf = last_leaf = createLeaf();
+		}
+
+		Leaf* leaf = findLeaf(key, path, indexes, &depth);
+		int pos = lowerBoundIndex(leaf->keys, leaf->count, key, false);
+		if (pos < leaf->count && !(key < leaf->keys[pos])) {
+			return &leaf->values[pos];
+		}
+
+		// Allocate the nodes of the splits
+		NodeBase* spare[MAX_DEPTH + 1];
+		int splits = 0;
+		try {
+			if (leaf->count == LEAF_CAPACITY) {
+				spare[splits++] = createLeaf();
+				for (int level = depth - 1;
+						level >= 0 && path[level]->count == INTERNAL_CAPACITY;
+						level--) {
+					spare[splits++] = createInternal();
+				}
+				if (splits == depth + 1) {
+					spare[splits++] = createInternal();
+				}
+			}
+		} catch (...) {
+			while (splits > 0) {
+				destroyNode(spare[--splits]);
+			}
+			throw;
+		}
+
+		leaf->keys.openGap(pos, leaf->count);
+		leaf->values.openGap(pos, leaf->count);
+		try {
+			leaf->keys.construct(pos, std::forward<Key>(key));
+			try {
+				leaf->values.construct(pos, std::forward<Args>(args)...);
+			} catch (...) {
+				leaf->keys.destroy(pos);
+				throw;
+			}
+		} catch (...) {
+			leaf->keys.closeGap(pos, leaf->count + 1);
+			leaf->values.closeGap(pos, leaf->count + 1);
+			while (splits > 0) {
+				destroyNode(spare[--splits]);
+			}
+			// The root leaf of an empty tree was created for this entry
+			if (leaf->count == 0 && root == leaf) {
+				destroyNode(leaf);
+				root = first_leaf = last_leaf = NULL;
+			}
+			throw;
+		}
+		leaf->count++;
+		size++;
+		*inserted = true;
+
+		T* res = &leaf->values[pos];
+		if (splits == 0) {
+			return res;
+		}
+
+		// Split the leaf, and the full nodes above it
+		int next_spare = 0;
+		Leaf* right_leaf = static_cast<Leaf*>(spare[next_spare++]);
+		splitLeaf(leaf, right_leaf);
+		if (pos >= leaf->count) {
+			res = &right_leaf->values[pos - leaf->count];
+		}
+
+		KeyType separator(right_leaf->keys[0]);
+		NodeBase* right = right_leaf;
+		for (int level = depth - 1; level >= 0; level--) {
+			Internal* node = path[level];
+			insertChild(node, indexes[level], std::move(separator), right);
+			if (node->count <= INTERNAL_CAPACITY) {
+				return res;
+			}
+
+			Internal* right_node = static_cast<Internal*>(spare[next_spare++]);
+			typename std::aligned_storage<sizeof(KeyType), alignof(KeyType)>::type middle;
+			splitInternal(node, right_node,
+					reinterpret_cast<KeyType*>(&middle));
+			separator = std::move(*reinterpret_cast<KeyType*>(&middle));
+			reinterpret_cast<KeyType*>(&middle)->~KeyType();
+			right = right_node;
+		}
+
+		// The root was split
+		Internal* new_root = static_cast<Internal*>(spare[next_spare++]);
+		new_root->keys.construct(0, std::move(separator));
+		new_root->children[0] = root;
+		new_root->children[1] = right;
+		new_root->count = 1;
+		root = new_root;
+
+		return res;
+	}
+
+	// Name			: mergeLeaves
+	// Description	: Moves the entries of a leaf to the leaf before it, and
+	//					removes it from the parent.
+	// Parameters	:
+	//	@parent	- the parent of the leaves
+	//	@index	- the index of the left leaf in the parent
+	// Return Value : None
+	void mergeLeaves(Internal* parent, int index) {
+		Leaf* left = static_cast<Leaf*>(parent->children[index]);
+		Leaf* right = static_cast<Leaf*>(parent->children[index + 1]);
+
+		for (int i = 0; i < right->count; i++) {
+			left->keys.construct(left->count + i, std::move(right->keys[i]));
+			left->values.construct(left->count + i,
+					std::move(right->values[i]));
+			right->keys.destroy(i);
+			right->values.destroy(i);
+		}
+		left->count += right->count;
+
+		left->next = right->next;
+		if (right->next != NULL) {
+			right->next->prev = left;
+		}
+		if (last_leaf == right) {
+			last_leaf = left;
+		}
+
+		removeChild(parent, index);
+		destroyNode(right);
+	}
+
+	// Name			: mergeInternals
+	// Description	: Moves the separator and the content of an internal node
+	//					to the node before it, and removes it from the parent.
+	// Parameters	:
+	//	@parent	- the parent of the nodes
+	//	@index	- the index of the left node in the parent
+	// Return Value : None
+	void mergeInternals(Internal* parent, int index) {
+		Internal* left = static_cast<Internal*>(parent->children[index]);
+		Internal* right = static_cast<Internal*>(parent->children[index + 1]);
+
+		left->keys.construct(left->count, std::move(parent->keys[index]));
+		for (int i = 0; i < right->count; i++) {
+			left->keys.construct(left->count + 1 + i,
+					std::move(right->keys[i]));
+			right->keys.destroy(i);
+		}
+		for (int i = 0; i <= right->count; i++) {
+			left->children[left->count + 1 + i] = right->children[i];
+		}
+		left->count += right->count + 1;
+
+		removeChild(parent, index);
+		destroyNode(right);
+	}
+
+	// Name			: fixUnderflow
+	// Description	: Refills a child which holds too few keys, by borrowing
+	//					one from a sibling, or by merging it with a sibling.
+	// Parameters	:
+	//	@parent	- the parent of the child
+	//	@index	- the index of the child in the parent
+	// Return Value : None
+	void fixUnderflow(Internal* parent, int index) {
+		NodeBase* left = (index > 0) ? parent->children[index - 1] : NULL;
+		NodeBase* right =
+				(index < parent->count) ? parent->children[index + 1] : NULL;
+
+		if (parent->children[index]->leaf == true) {
+			Leaf* child = static_cast<Leaf*>(parent->children[index]);
+			Leaf* left_leaf = static_cast<Leaf*>(left);
+			Leaf* right_leaf = static_cast<Leaf*>(right);
+
+			if (left_leaf != NULL && left_leaf->count > LEAF_MIN) {
+				int last = left_leaf->count - 1;
+				child->keys.openGap(0, child->count);
+				child->values.openGap(0, child->count);
+				child->keys.construct(0, std::move(left_leaf->keys[last]));
+				child->values.construct(0, std::move(left_leaf->values[last]));
+				left_leaf->keys.destroy(last);
+				left_leaf->values.destroy(last);
+				left_leaf->count--;
+				child->count++;
+				parent->keys[index - 1] = child->keys[0];
+			} else if (right_leaf != NULL && right_leaf->count > LEAF_MIN) {
+				child->keys.construct(child->count,
+						std::move(right_leaf->keys[0]));
+				child->values.construct(child->count,
+						std::move(right_leaf->values[0]));
+				right_leaf->keys.destroy(0);
+				right_leaf->values.destroy(0);
+				right_leaf->keys.closeGap(0, right_leaf->count);
+				right_leaf->values.closeGap(0, right_leaf->count);
+				right_leaf->count--;
+				child->count++;
+				parent->keys[index] = right_leaf->keys[0];
+			} else if (left_leaf != NULL) {
+				mergeLeaves(parent, index - 1);
+			} else {
+				mergeLeaves(parent, index);
+			}
+			return;
+		}
+
+		Internal* child = static_cast<Internal*>(parent->children[index]);
+		Internal* left_node = static_cast<Internal*>(left);
+		Internal* right_node = static_cast<Internal*>(right);
+
+		if (left_node != NULL && left_node->count > INTERNAL_MIN) {
+			int last = left_node->count - 1;
+			child->keys.openGap(0, child->count);
+			child->keys.construct(0, std::move(parent->keys[index - 1]));
+			parent->keys[index - 1] = std::move(left_node->keys[last]);
+			left_node->keys.destroy(last);
+			for (int i = child->count + 1; i > 0; i--) {
+				child->children[i] = child->children[i - 1];
+			}
+			child->children[0] = left_node->children[last + 1];
+			left_node->count--;
+			child->count++;
+		} else if (right_node != NULL && right_node->count > INTERNAL_MIN) {
+			child->keys.construct(child->count,
+					std::move(parent->keys[index]));
+			parent->keys[index] = std::move(right_node->keys[0]);
+			right_node->keys.destroy(0);
+			right_node->keys.closeGap(0, right_node->count);
+			child->children[child->count + 1] = right_node->children[0];
+			for (int i = 0; i < right_node->count; i++) {
+				right_node->children[i] = right_node->children[i + 1];
+			}
+			right_node->count--;
+			child->count++;
+		} else if (left_node != NULL) {
+			mergeInternals(parent, index - 1);
+		} else {
+			mergeInternals(parent, index);
+		}
+	}
+
+	// Name			: eraseKey
+	// Description	: Removes the entry of the given key. Nodes which hold
+	//					too few keys are refilled on the way up.
+	// Parameters	:
+	//	@key		- the key
+	//	@removed	- if not NULL, receives the data of the entry
+	// Return Value : true if the entry was removed, false if the key wasn't
+	//					found
+	bool eraseKey(const KeyType& key, T* removed) {
+		Internal* path[MAX_DEPTH];
+		int indexes[MAX_DEPTH];
+		int depth;
+
+		Leaf* leaf = findLeaf(key, path, indexes, &depth);
+		if (leaf == NULL) {
+			return false;
+		}
+		int pos = lowerBoundIndex(leaf->keys, leaf->count, key, false);
+		if (pos == leaf->count || key < leaf->keys[pos]) {
+			return false;
+		}
+
+		if (removed != NULL) {
+			*removed = std::move(leaf->values[pos]);
+		}
+		leaf->keys.destroy(pos);
+		leaf->values.destroy(pos);
+		leaf->keys.closeGap(pos, leaf->count);
+		leaf->values.closeGap(pos, leaf->count);
+		leaf->count--;
+		size--;
+
+		NodeBase* node = leaf;
+		for (int level = depth - 1; level >= 0; level--) {
+			int min = (node->leaf == true) ? LEAF_MIN : INTERNAL_MIN;
+			if (node->count >= min) {
+				break;
+			}
+			fixUnderflow(path[level], indexes[level]);
+			node = path[level];
+		}
+
+		// Shrink the root
+		if (root->leaf == false && root->count == 0) {
+			NodeBase* old_root = root;
+			root = static_cast<Internal*>(root)->children[0];
+			destroyNode(old_root);
+		} else if (root->leaf == true && root->count == 0) {
+			destroyNode(root);
+			root = first_leaf = last_leaf = NULL;
+		}
+
+		return true;
+	}
+
+public:
+	//
+	//	Class		: iterator
+	// 	Description	: A bidirectional iterator, in key order. It's
+	//					invalidated by Insert and Delete.
+	//
+	class iterator {
+	private:
+		Leaf* leaf;
+		int index;
+		BPlusTree* tree;
+
+		friend class BPlusTree;
+
+		iterator(Leaf* leaf, int index, BPlusTree* tree) :
+				leaf(leaf), index(index), tree(tree) {
+		}
+
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T* pointer;
+		typedef T& reference;
+
+		// Name			: operator++
+		// Description	: Moves the iterator to the next entry in key order
+		// Parameters	: None
+		// Return Value : The moved iterator, which equals end() if the entry
+		//					was the last one
+		iterator& operator++() {
+			if (leaf == NULL) {
+				throw AVLTreeIteratorReachedEnd();
+			}
+
+			if (++index == leaf->count) {
+				leaf = leaf->next;
+				index = 0;
+			}
+			return *this;
+		}
+
+		iterator operator++(int) {
+			iterator res = *this;
+			++(*this);
+			return res;
+		}
+
+		// Name			: operator--
+		// Description	: Moves the iterator to the previous entry in key
+		//					order. Moving back from end() reaches the last
+		//					entry.
+		// Parameters	: None
+		// Return Value : The moved iterator
+		// If the iterator is on the first entry (or the tree is empty),
+		// AVLTreeIteratorReachedEnd will be thrown.
+		iterator& operator--() {
+			if (leaf == NULL) {
+				if (tree->last_leaf == NULL) {
+					throw AVLTreeIteratorReachedEnd();
+				}
+				leaf = tree->last_leaf;
+				index = leaf->count - 1;
+			} else if (index > 0) {
+				index--;
+			} else {
+				if (leaf->prev == NULL) {
+					throw AVLTreeIteratorReachedEnd();
+				}
+				leaf = leaf->prev;
+				index = leaf->count - 1;
+			}
+			return *this;
+		}
+
+		iterator operator--(int) {
+			iterator res = *this;
+			--(*this);
+			return res;
+		}
+
+		// Name			: getKey
+		// Description	: Returns the key of the iterator's entry
+		// Parameters	: None
+		// Return Value : the key
+		const KeyType& getKey() const {
+			if (leaf == NULL) {
+				throw AVLTreeIteratorReachedEnd();
+			}
+
+			return leaf->keys[index];
+		}
+
+		// Dereference operator
+		// Description	: Returns the iterator's data
+		// Return Value : the iterator's saved data
+		T& operator*() const {
+			if (leaf == NULL) {
+				throw AVLTreeIteratorReachedEnd();
+			}
+
+			return leaf->values[index];
+		}
+
+		// Member access operator
+		T* operator->() const {
+			return &(**this);
+		}
+
+		bool operator==(const iterator& rhs) const {
+			return ((tree == rhs.tree) && (leaf == rhs.leaf)
+					&& (index == rhs.index));
+		}
+
+		bool operator!=(const iterator& rhs) const {
+			return (!(*this == rhs));
+		}
+	};
+
+	//
+	// Public interface
+	//
+
+	// BPlusTree constructor
+	BPlusTree() :
+			root(NULL), first_leaf(NULL), last_leaf(NULL), size(INITIAL_SIZE) {
+	}
+
+	// BPlusTree constructor, nodes are allocated by the given allocator
+	explicit BPlusTree(const Allocator& allocator) :
+			root(NULL), first_leaf(NULL), last_leaf(NULL), size(INITIAL_SIZE), alloc(
+					allocator) {
+	}
+
+	// BPlusTree destructor
+	~BPlusTree() {
+		destructTree(root);
+	}
+
+	// Name			: Insert
+	// Description	: This function inserts a new entry to the tree.
+	// Parameters	:
+	//	@key 	- the entry's key
+	//	@data 	- the entry's data
+	// Return Value : None
+	// 	If the key already exist, AVLTreeKeyAlreadyExistsException will be
+	// thrown.
+	void Insert(KeyType key, T const& data) {
+		Emplace(std::move(key), data);
+	}
+
+	// Name			: Insert
+	// Description	: This function inserts a new entry to the tree, and
+	//					moves the given data into it.
+	// Parameters	:
+	//	@key 	- the entry's key
+	//	@data 	- the entry's data
+	// Return Value : None
+	// 	If the key already exist, AVLTreeKeyAlreadyExistsException will be
+	// thrown.
+	void Insert(KeyType key, T&& data) {
+		Emplace(std::move(key), std::move(data));
+	}
+
+	// Name			: Emplace
+	// Description	: Inserts a new entry to the tree, whose data is
+	//					constructed in place from the given arguments.
+	// Parameters	:
+	//	@key 	- the entry's key
+	//	@args 	- the arguments of the data constructor
+	// Return Value : Reference to the data of the new entry
+	// 	If the key already exist, AVLTreeKeyAlreadyExistsException will be
+	// thrown.
+	template<class ... Args>
+	T& Emplace(KeyType key, Args&&... args) {
+		bool inserted;
+
+		T* data = insertKey(std::move(key), &inserted,
+				std::forward<Args>(args)...);
+		if (inserted == false) {
+			throw AVLTreeKeyAlreadyExistsException();
+		}
+		return *data;
+	}
+
+	// Name			: InsertOrAssign
+	// Description	: Inserts a new entry to the tree, or replaces the data of
+	//					the entry if the key already exists.
+	// Parameters	:
+	//	@key 	- the entry's key
+	//	@data 	- the entry's data, copied or moved
+	// Return Value : true if a new entry was inserted, false if the data of
+	//					an existing entry was assigned
+	template<class Data>
+	bool InsertOrAssign(KeyType key, Data&& data) {
+		bool inserted;
+
+		T* res = insertKey(std::move(key), &inserted, std::forward<Data>(data));
+		if (inserted == false) {
+			*res = std::forward<Data>(data);
+		}
+		return inserted;
+	}
+
+	// Name			: TryEmplace
+	// Description	: Inserts a new entry to the tree if the key doesn't
+	//					exist. Otherwise the tree isn't changed, and the
+	//					arguments aren't used.
+	// Parameters	:
+	//	@key 	- the entry's key
+	//	@args 	- the arguments of the data constructor
+	// Return Value : A pair of a pointer to the data of the key, and whether
+	//					it was inserted by this call
+	template<class ... Args>
+	std::pair<T*, bool> TryEmplace(KeyType key, Args&&... args) {
+		bool inserted;
+
+		T* data = insertKey(std::move(key), &inserted,
+				std::forward<Args>(args)...);
+		return std::pair<T*, bool>(data, inserted);
+	}
+
+	// Name			: Delete
+	// Description	: This function deletes an entry from the tree, by the
+	// given key.
+	// Parameters	:
+	//	@key - the key represents the entry to delete
+	// Return Value : None, if the key wasn't found a suitable exception will
+	// be thrown (AVLTreeKeyNotFoundException).
+	void Delete(const KeyType& key) {
+		if (eraseKey(key, NULL) == false) {
+			throw AVLTreeKeyNotFoundException();
+		}
+	}
+
+	// Name			: Erase
+	// Description	: Deletes the entry of the given key, if it exists.
+	// Parameters	:
+	//	@key		- the key represents the entry to delete
+	//	@removed	- if not NULL, receives the data of the deleted entry
+	// Return Value : true if the entry was deleted, false if the key wasn't
+	//					found
+	bool Erase(const KeyType& key, T* removed = NULL) {
+		return eraseKey(key, removed);
+	}
+
+	// Name			: Find
+	// Description	: Returns an iterator to the entry of the given key
+	// Parameters	:
+	//	@key - the key to find
+	// Return Value : iterator to the entry
+	// If the key wasn't found, AVLTreeKeyNotFoundException will be thrown.
+	iterator Find(const KeyType& key) {
+		int index;
+		Leaf* leaf = findEntry(key, &index);
+		if (leaf == NULL) {
+			throw AVLTreeKeyNotFoundException();
+		}
+
+		return iterator(leaf, index, this);
+	}
+
+	// Name			: TryFind
+	// Description	: Searches the data of the given key, without throwing on
+	//					a miss.
+	// Parameters	:
+	//	@key - the key to find
+	// Return Value : pointer to the data, or NULL if the key wasn't found
+	T* TryFind(const KeyType& key) {
+		int index;
+		Leaf* leaf = findEntry(key, &index);
+		return (leaf == NULL) ? NULL : &leaf->values[index];
+	}
+
+	// Name			: Clear
+	// Description	: Deletes all the entries of the tree
+	// Parameters	: None
+	// Return Value : None
+	void Clear(void) {
+		destructTree(root);
+		root = first_leaf = last_leaf = NULL;
+		size = INITIAL_SIZE;
+	}
+
+	// Name			: getSize
+	// Description	: Returns the number of entries in the tree
+	// Parameters	: None
+	// Return Value : the number of entries
+	int getSize() const {
+		return size;
+	}
+
+	// Name			: Empty
+	// Description	: Tests whether the tree is empty
+	// Parameters	: None
+	// Return Value : true if the tree has no entries
+	bool Empty(void) const {
+		return (size == INITIAL_SIZE);
+	}
+
+	//
+	//	Name		:	inOrderExtract
+	//	Description	:	The function returns an ordered array which
+	//					contains pointers to the data contained in the tree.
+	// Parameters	:	None
+	// Return Value	: 	Pointer to the data array, to be freed with delete[]
+	T** inOrderExtract(void) {
+		T** data_array = new T*[getSize()];
+		int index = 0;
+
+		for (Leaf* leaf = first_leaf; leaf != NULL; leaf = leaf->next) {
+			for (int i = 0; i < leaf->count; i++) {
+				data_array[index++] = &leaf->values[i];
+			}
+		}
+		return data_array;
+	}
+
+	//
+	//	Name		:	inOrderExtractKeys
+	//	Description	:	The function returns an ordered array which
+	//					contains the keys contained in the tree.
+	// Parameters	:	None
+	// Return Value	: 	Pointer to a keys array, to be freed with delete[]
+	KeyType* inOrderExtractKeys(void) {
+		KeyType* keys_array = new KeyType[getSize()];
+		int index = 0;
+
+		for (Leaf* leaf = first_leaf; leaf != NULL; leaf = leaf->next) {
+			for (int i = 0; i < leaf->count; i++) {
+				keys_array[index++] = leaf->keys[i];
+			}
+		}
+		return keys_array;
+	}
+
+	// Name			: LowerBound
+	// Description	: Searches the first entry whose key isn't less than the
+	//					given key.
+	// Parameters	:
+	//	@key - the bound
+	// Return Value : iterator to the entry, or end() if there's none
+	iterator LowerBound(const KeyType& key) {
+		int index = 0;
+		Leaf* leaf = boundEntry(key, false, &index);
+		return iterator(leaf, index, this);
+	}
+
+	// Name			: UpperBound
+	// Description	: Searches the first entry whose key is greater than the
+	//					given key.
+	// Parameters	:
+	//	@key - the bound
+	// Return Value : iterator to the entry, or end() if there's none
+	iterator UpperBound(const KeyType& key) {
+		int index = 0;
+		Leaf* leaf = boundEntry(key, true, &index);
+		return iterator(leaf, index, this);
+	}
+
+	// Name			: RangeScan
+	// Description	: Visits, in key order, every entry whose key is in the
+	//					range [lo, hi). After the first leaf is found, the
+	//					scan walks the leaves in order.
+	// Parameters	:
+	//	@lo			- the lower bound (inclusive)
+	//	@hi			- the upper bound (exclusive)
+	//	@visitor	- callable, invoked as visitor(key, data) for each entry
+	// Return Value : the number of visited entries
+	template<class Visitor>
+	int RangeScan(const KeyType& lo, const KeyType& hi, Visitor visitor) {
+		int count = 0;
+		int index = 0;
+
+		for (Leaf* leaf = boundEntry(lo, false, &index); leaf != NULL;
+				leaf = leaf->next, index = 0) {
+			for (; index < leaf->count; index++) {
+				if (!(leaf->keys[index] < hi)) {
+					return count;
+				}
+				visitor(leaf->keys[index], leaf->values[index]);
+				count++;
+			}
+		}
+		return count;
+	}
+
+	// Name			: begin
+	// Description	: Returns an iterator to the entry with the minimal key
+	// Parameters	: None
+	// Return Value : iterator to the first entry, end() if the tree is
+	//					empty
+	iterator begin(void) {
+		return iterator(first_leaf, 0, this);
+	}
+
+	// Name			: end
+	// Description	: Returns the past-the-end iterator of the tree
+	// Parameters	: None
+	// Return Value : past-the-end iterator
+	iterator end(void) {
+		return iterator(NULL, 0, this);
+	}
+
+	//
+	//	Name		:	getMinimal
+	//	Description	:	The function returns the iterator to the minimal entry
+	//					in the tree.
+	//	Parameters	: 	None
+	//	Return Value: 	returns an iterator to the minimal entry in the tree.
+	iterator getMinimal(void) {
+		if (first_leaf == NULL) {
+			throw AVLTreeKeyNotFoundException();
+		}
+
+		return begin();
+	}
+
+	//
+	//	Name		:	getMaximal
+	//	Description	:	The function returns the iterator to the maximal entry
+	//					in the tree.
+	//	Parameters	: 	None
+	//	Return Value: 	returns an iterator to the maximal entry in the tree.
+	iterator getMaximal(void) {
+		if (last_leaf == NULL) {
+			throw AVLTreeKeyNotFoundException();
+		}
+
+		return iterator(last_leaf, last_leaf->count - 1, this);
+	}
+};
+
+#endif /* BPLUS_TREE_HPP_ */
@@ -0,0 +1,994 @@
+#ifndef COMPACT_AVLTREE_HPP_
+#define COMPACT_AVLTREE_HPP_
+
+//
+//	File		: compact_avltree.hpp
+//	Description	: AVL tree with compact nodes, for very large trees. A node
+//					keeps a one byte balance factor instead of the two
+//					subtree heights of AVLTree, and the parent link is
+//					optional: without it the tree is updated through an
+//					explicit path stack, and iterators carry the path to
+//					their node. Nodes are carved from cache line aligned
+//					chunks, so there's no per node allocation overhead,
+//					and nodes whose size divides the cache line never
+//					straddle two lines.
+//					For int keys and pointer data a node takes 32 bytes
+//					without parent links, and 40 bytes with them.
+//
+
+#include <exception>
+#include "exceptions.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+//
+//	Class		: CompactParentLink
+//	Description : The optional parent link of a CompactAVLTree node. The
+//					disabled link takes no space in the node.
+//
+template<class NodeType, bool Enabled> class CompactParentLink {
+private:
+	NodeType* _parent;
+
+public:
+	CompactParentLink() :
+			_parent(NULL) {
+	}
+
+	NodeType* getParent(void) const {
+		return _parent;
+	}
+
+	void setParent(NodeType* parent) {
+		_parent = parent;
+	}
+};
+
+template<class NodeType> class CompactParentLink<NodeType, false> {
+public:
+	NodeType* getParent(void) const {
+		return NULL;
+	}
+
+	void setParent(NodeType*) {
+	}
+};
+
+template<class T, typename KeyType, class Allocator = std::allocator<T>,
+		bool ParentLinks = true>
+class CompactAVLTree {
+
+protected:
+	//
+	// Constants
+	//
+	static const int LEFT = 0;
+	static const int RIGHT = 1;
+	static const signed char BALANCED = 0;
+	// An AVL tree of height 64 holds more than 2^44 nodes
+	static const int MAX_HEIGHT = 64;
+	static const size_t CACHE_LINE = 64;
+	static const size_t CHUNK_SIZE = 64 * 1024;
+	static const int INITIAL_SIZE = 0;
+
+	//
+	//	Class		: Node
+	//	Description : Compact tree node. The balance factor is the height of
+	//					the right subtree minus the height of the left one.
+	//					The node is only used by the tree, so it's fields
+	//					are accessed directly.
+	//
+	class Node: public CompactParentLink<Node, ParentLinks> {
+	public:
+		Node* _child[2];
+		KeyType _key;
+		signed char _balance;
+		T _data;
+
+		// Node contstructor, the data is constructed in place from the
+		// given arguments
+		template<class Key, class ... Args>
+		explicit Node(Key&& key, Args&&... args) :
+				_key(std::forward<Key>(key)), _balance(BALANCED), _data(
+						std::forward<Args>(args)...) {
+			_child[LEFT] = _child[RIGHT] = NULL;
+		}
+	};
+
+	//
+	//	Class		: LinkedPath / StackPath
+	//	Description : The ancestors of an iterator's node. With parent links
+	//					they're found through the nodes, otherwise they're
+	//					kept in a stack.
+	//
+	struct LinkedPath {
+		void Clear(void) {
+		}
+
+		void Push(Node*) {
+		}
+
+		Node* Pop(Node* node) {
+			return node->getParent();
+		}
+	};
+
+	struct StackPath {
+		Node* nodes[MAX_HEIGHT];
+		int depth;
+
+		StackPath() :
+				depth(0) {
+		}
+
+		void Clear(void) {
+			depth = 0;
+		}
+
+		void Push(Node* node) {
+			nodes[depth++] = node;
+		}
+
+		Node* Pop(Node*) {
+			return (depth == 0) ? NULL : nodes[--depth];
+		}
+	};
+
+	typedef typename std::conditional<ParentLinks, LinkedPath, StackPath>::type Path;
+
+private:
+	//
+	//	Class		: Chunk
+	//	Description : Header of a memory chunk, which takes the first cache
+	//					line of the chunk. The nodes follow it.
+	//
+	struct Chunk {
+		Chunk* next;
+		char* raw;
+	};
+
+	struct FreeNode {
+		FreeNode* next;
+	};
+
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<
+			char> ChunkAllocator;
+	typedef std::allocator_traits<ChunkAllocator> ChunkAllocatorTraits;
+
+	static_assert(alignof(Node) <= CACHE_LINE,
+			"CompactAVLTree doesn't support over-aligned nodes");
+
+	Node* root;
+	int size;
+	Chunk* chunks;
+	char* cursor;
+	char* limit;
+	FreeNode* free_nodes;
+	ChunkAllocator chunk_alloc;
+
+	CompactAVLTree(const CompactAVLTree&);
+	CompactAVLTree& operator=(const CompactAVLTree&);
+
+	// Name			: nodesPerChunk
+	// Description	: Returns the number of nodes in a chunk
+	// Parameters	: None
+	// Return Value : the number of nodes, at least one
+	static size_t nodesPerChunk(void) {
+		size_t count = (CHUNK_SIZE - CACHE_LINE) / sizeof(Node);
+		return (count == 0) ? 1 : count;
+	}
+
+	// Name			: chunkBytes
+	// Description	: Returns the allocated size of a chunk, which leaves
+	//					room to align it to a cache line.
+	// Parameters	: None
+	// Return Value : the size in bytes
+	static size_t chunkBytes(void) {
+		return 2 * CACHE_LINE + nodesPerChunk() * sizeof(Node);
+	}
+
+	// Name			: newChunk
+	// Description	: Allocates a new chunk, and moves the cursor to it's
+	//					first node.
+	// Parameters	: None
+	// Return Value : None
+	// If memory allocation failes, a matching exception would be thrown by
+	//	the system.
+	void newChunk(void) {
+		char* raw = ChunkAllocatorTraits::allocate(chunk_alloc, chunkBytes());
+		size_t offset = (CACHE_LINE
+				- reinterpret_cast<uintptr_t>(raw) % CACHE_LINE) % CACHE_LINE;
+
+		Chunk* chunk = new (raw + offset) Chunk();
+		chunk->next = chunks;
+		chunk->raw = raw;
+		chunks = chunk;
+
+		cursor = raw + offset + CACHE_LINE;
+		limit = cursor + nodesPerChunk() * sizeof(Node);
+	}
+
+	// Name			: freeChunks
+	// Description	: Frees all the chunks. Every node becomes invalid.
+	// Parameters	: None
+	// Return Value : None
+	void freeChunks(void) {
+		while (chunks != NULL) {
+			Chunk* next = chunks->next;
+			ChunkAllocatorTraits::deallocate(chunk_alloc, chunks->raw,
+					chunkBytes());
+			chunks = next;
+		}
+		cursor = limit = NULL;
+		free_nodes = NULL;
+	}
+
+	// Name			: createNode
+	// Description	: Takes memory for a node, from the free nodes or from
+	//					the current chunk, and constructs the node in it.
+	// Parameters	:
+	//	@args - the arguments of the Node constructor
+	// Return Value : pointer to the new node
+	template<class ... Args>
+	Node* createNode(Args&&... args) {
+		void* memory;
+
+		if (free_nodes != NULL) {
+			memory = free_nodes;
+			free_nodes = free_nodes->next;
+		} else {
+			if (cursor == limit) {
+				newChunk();
+			}
+			memory = cursor;
+			cursor += sizeof(Node);
+		}
+
+		try {
+			return new (memory) Node(std::forward<Args>(args)...);
+		} catch (...) {
+			FreeNode* free_node = static_cast<FreeNode*>(memory);
+			free_node->next = free_nodes;
+			free_nodes = free_node;
+			throw;
+		}
+	}
+
+	// Name			: destroyNode
+	// Description	: Destructs a node and keeps it's memory for the next
+	//					node.
+	// Parameters	:
+	//	@node - the node to destroy
+	// Return Value : None
+	void destroyNode(Node* node) {
+		node->~Node();
+
+		FreeNode* free_node = reinterpret_cast<FreeNode*>(node);
+		free_node->next = free_nodes;
+		free_nodes = free_node;
+	}
+
+	// Name			: destroyAll
+	// Description	: Destructs all the nodes. The left sons are rotated into
+	//					a right leaning list on the way, so no stack is
+	//					needed. The memory stays in the chunks.
+	// Parameters	: None
+	// Return Value : None
+	void destroyAll(void) {
+		Node* current = root;
+
+		while (current != NULL) {
+			Node* left = current->_child[LEFT];
+			if (left != NULL) {
+				current->_child[LEFT] = left->_child[RIGHT];
+				left->_child[RIGHT] = current;
+				current = left;
+			} else {
+				Node* right = current->_child[RIGHT];
+				current->~Node();
+				current = right;
+			}
+		}
+		root = NULL;
+		size = INITIAL_SIZE;
+	}
+
+	// Name			: link
+	// Description	: Sets a son of a node, and the son's parent link.
+	// Parameters	:
+	//	@parent	- the node
+	//	@dir	- LEFT or RIGHT
+	//	@son	- the new son, may be NULL
+	// Return Value : None
+	static void link(Node* parent, int dir, Node* son) {
+		parent->_child[dir] = son;
+		if (son != NULL) {
+			son->setParent(parent);
+		}
+	}
+
+	// Name			: replaceChild
+	// Description	: Puts a subtree at the place of the i-th node of a path
+	// Parameters	:
+	//	@path	- the nodes of the path from the root
+	//	@dirs	- the direction taken from each node of the path
+	//	@i		- the index of the replaced node
+	//	@son	- the new subtree root, may be NULL
+	// Return Value : None
+	void replaceChild(Node** path, int* dirs, int i, Node* son) {
+		if (i == 0) {
+			root = son;
+			if (son != NULL) {
+				son->setParent(NULL);
+			}
+		} else {
+			link(path[i - 1], dirs[i - 1], son);
+		}
+	}
+
+	// Name			: rebalance
+	// Description	: Rotates a node whose balance factor became +2 or -2.
+	// Parameters	:
+	//	@node			- the node
+	//	@heavy			- the side of the taller subtree
+	//	@height_changed	- receives whether the rotated subtree got shorter
+	//						than it was before the rotation
+	// Return Value : the new root of the subtree
+	static Node* rebalance(Node* node, int heavy, bool* height_changed) {
+		signed char delta = (heavy == RIGHT) ? 1 : -1;
+		Node* son = node->_child[heavy];
+
+		if (son->_balance == -delta) {
+			// Double rotation - the grandson becomes the subtree root
+			Node* grandson = son->_child[1 - heavy];
+			link(son, 1 - heavy, grandson->_child[heavy]);
+			link(node, heavy, grandson->_child[1 - heavy]);
+			link(grandson, heavy, son);
+			link(grandson, 1 - heavy, node);
+
+			node->_balance = (grandson->_balance == delta) ? -delta : BALANCED;
+			son->_balance = (grandson->_balance == -delta) ? delta : BALANCED;
+			grandson->_balance = BALANCED;
+			*height_changed = true;
+			return grandson;
+		}
+
+		link(node, heavy, son->_child[1 - heavy]);
+		link(son, 1 - heavy, node);
+		if (son->_balance == BALANCED) {
+			// Only after a removal
+			node->_balance = delta;
+			son->_balance = -delta;
+			*height_changed = false;
+		} else {
+			node->_balance = son->_balance = BALANCED;
+			*height_changed = true;
+		}
+		return son;
+	}
+
+	// Name			: insertKey
+	// Description	: Inserts a new node with the given key, unless the key
+	//					already exists. The path from the root is kept in a
+	//					stack, and rebalanced on the way up.
+	// Parameters	:
+	//	@key		- the key of the new node
+	//	@inserted	- set to true if a new node was created, false if the
+	//					key already existed
+	//	@args		- the arguments of the data constructor
+	// Return Value : The node which holds the key
+	template<class Key, class ... Args>
+	Node* insertKey(Key&& key, bool* inserted, Args&&... args) {
+		Node* path[MAX_HEIGHT];
+		int dirs[MAX_HEIGHT];
+		int depth = 0;
+
+		*inserted = false;
+		for (Node* current = root; current != NULL;
+				current = current->_child[dirs[depth++]]) {
+			if (key < current->_key) {
+				dirs[depth] = LEFT;
+			} else if (current->_key < key) {
+				dirs[depth] = RIGHT;
+			} else {
+				return current;
+			}
+			path[depth] = current;
+		}
+
+		Node* node = createNode(std::forward<Key>(key),
+				std::forward<Args>(args)...);
+		*inserted = true;
+		size++;
+
+		replaceChild(path, dirs, depth, node);
+		for (int i = depth - 1; i >= 0; i--) {
+			Node* current = path[i];
+			signed char delta = (dirs[i] == RIGHT) ? 1 : -1;
+
+			if (current->_balance == BALANCED) {
+				// The subtree got taller
+				current->_balance = delta;
+				continue;
+			}
+			if (current->_balance == -delta) {
+				current->_balance = BALANCED;
+				break;
+			}
+
+			// After an insertion the rotation restores the old height
+			bool height_changed;
+			replaceChild(path, dirs, i,
+					rebalance(current, dirs[i], &height_changed));
+			break;
+		}
+
+		return node;
+	}
+
+	// Name			: eraseKey
+	// Description	: Removes the node of the given key. A node with two sons
+	//					is replaced by it's successor, which is relinked (the
+	//					data of other nodes never moves).
+	// Parameters	:
+	//	@key		- the key
+	//	@removed	- if not NULL, receives the data of the removed node
+	// Return Value : true if the node was removed, false if the key wasn't
+	//					found
+	bool eraseKey(const KeyType& key, T* removed) {
+		Node* path[MAX_HEIGHT];
+		int dirs[MAX_HEIGHT];
+		int depth = 0;
+		Node* node = root;
+
+		while (node != NULL) {
+			if (key < node->_key) {
+				dirs[depth] = LEFT;
+			} else if (node->_key < key) {
+				dirs[depth] = RIGHT;
+			} else {
+				break;
+			}
+			path[depth++] = node;
+			node = node->_child[dirs[depth - 1]];
+		}
+		if (node == NULL) {
+			return false;
+		}
+
+		if (node->_child[LEFT] != NULL && node->_child[RIGHT] != NULL) {
+			int index = depth;
+			path[depth] = node;
+			dirs[depth++] = RIGHT;
+
+			Node* next = node->_child[RIGHT];
+			while (next->_child[LEFT] != NULL) {
+				path[depth] = next;
+				dirs[depth++] = LEFT;
+				next = next->_child[LEFT];
+			}
+
+			// Unlink the successor, and put it at the node's place
+			link(path[depth - 1], dirs[depth - 1], next->_child[RIGHT]);
+			link(next, LEFT, node->_child[LEFT]);
+			link(next, RIGHT, node->_child[RIGHT]);
+			next->_balance = node->_balance;
+			replaceChild(path, dirs, index, next);
+			path[index] = next;
+		} else {
+			Node* son =
+					(node->_child[LEFT] != NULL) ?
+							node->_child[LEFT] : node->_child[RIGHT];
+			replaceChild(path, dirs, depth, son);
+		}
+
+		if (removed != NULL) {
+			*removed = std::move(node->_data);
+		}
+		destroyNode(node);
+		size--;
+
+		for (int i = depth - 1; i >= 0; i--) {
+			Node* current = path[i];
+			signed char delta = (dirs[i] == RIGHT) ? 1 : -1;
+
+			if (current->_balance == delta) {
+				// The subtree got shorter
+				current->_balance = BALANCED;
+				continue;
+			}
+			if (current->_balance == BALANCED) {
+				current->_balance = -delta;
+				break;
+			}
+
+			bool height_changed;
+			replaceChild(path, dirs, i,
+					rebalance(current, 1 - dirs[i], &height_changed));
+			if (height_changed == false) {
+				break;
+			}
+		}
+
+		return true;
+	}
+
+	// Name			: findNode
+	// Description	: Searches a given key from the root of the tree
+	// Parameters	:
+	//	@key - the key to find
+	// Return Value : the node of the key, NULL if it wasn't found
+	Node* findNode(const KeyType& key) const {
+		Node* current = root;
+
+		while (current != NULL) {
+			if (key < current->_key) {
+				current = current->_child[LEFT];
+			} else if (current->_key < key) {
+				current = current->_child[RIGHT];
+			} else {
+				return current;
+			}
+		}
+		return NULL;
+	}
+
+	// Name			: lowerBoundNode
+	// Description	: Searches the first node whose key isn't less than (or,
+	//					for an upper bound, is greater than) the given key.
+	// Parameters	:
+	//	@key	- the bound
+	//	@upper	- true for an upper bound
+	// Return Value : the node, NULL if there's none
+	Node* lowerBoundNode(const KeyType& key, bool upper) const {
+		Node* current = root;
+		Node* res = NULL;
+
+		while (current != NULL) {
+			bool go_left =
+					upper ? (key < current->_key) : !(current->_key < key);
+			if (go_left == true) {
+				res = current;
+				current = current->_child[LEFT];
+			} else {
+				current = current->_child[RIGHT];
+			}
+		}
+		return res;
+	}
+
+	// Name			: checkHeight
+	// Description	: Computes the height of a subtree, and tests it's balance
+	//					factors.
+	// Parameters	:
+	//	@node		- the subtree root
+	//	@balanced	- set to false if a balance factor is wrong
+	// Return Value : the height of the subtree
+	static int checkHeight(Node* node, bool* balanced) {
+		if (node == NULL) {
+			return 0;
+		}
+
+		int left = checkHeight(node->_child[LEFT], balanced);
+		int right = checkHeight(node->_child[RIGHT], balanced);
+		if (right - left != node->_balance || right - left > 1
+				|| left - right > 1) {
+			*balanced = false;
+		}
+		return ((left > right) ? left : right) + 1;
+	}
+
+public:
+	//
+	//	Class		: iterator
+	// 	Description	: A bidirectional iterator, in key order. Without parent
+	//					links it keeps the path to it's node, and is
+	//					invalidated by any change of the tree. With them,
+	//					only the removal of it's node invalidates it.
+	//
+	class iterator {
+	private:
+		Node* current;
+		Path ancestors;
+		CompactAVLTree* tree;
+
+		friend class CompactAVLTree;
+
+		void moveDown(int dir) {
+			ancestors.Push(current);
+			current = current->_child[dir];
+		}
+
+		void moveToEdge(int dir) {
+			while (current->_child[dir] != NULL) {
+				moveDown(dir);
+			}
+		}
+
+		// Name			: step
+		// Description	: Moves to the next node in the given direction
+		// Parameters	:
+		//	@dir - RIGHT for the successor, LEFT for the predecessor
+		// Return Value : None
+		void step(int dir) {
+			if (current->_child[dir] != NULL) {
+				moveDown(dir);
+				moveToEdge(1 - dir);
+				return;
+			}
+
+			Node* son;
+			do {
+				son = current;
+				current = ancestors.Pop(current);
+			} while (current != NULL && current->_child[dir] == son);
+		}
+
+		iterator(CompactAVLTree* tree) :
+				current(tree->root), tree(tree) {
+		}
+
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef T* pointer;
+		typedef T& reference;
+
+		// Name			: operator++
+		// Description	: Moves the iterator to the next node in key order
+		// Parameters	: None
+		// Return Value : The moved iterator, which equals end() if the node
+		//					was the last one
+		iterator& operator++() {
+			if (current == NULL) {
+				throw AVLTreeIteratorReachedEnd();
+			}
+
+			step(RIGHT);
+			return *this;
+		}
+
+		iterator operator++(int) {
+			iterator res = *this;
+			++(*this);
+			return res;
+		}
+
+		// Name			: operator--
+		// Description	: Moves the iterator to the previous node in key order.
+		//					Moving back from end() reaches the last node.
+		// Parameters	: None
+		// Return Value : The moved iterator
+		// If the iterator is on the first node (or the tree is empty),
+		// AVLTreeIteratorReachedEnd will be thrown.
+		iterator& operator--() {
+			iterator prev(tree);
+
+			if (current == NULL) {
+				if (prev.current != NULL) {
+					prev.moveToEdge(RIGHT);
+				}
+			} else {
+				prev = *this;
+				prev.step(LEFT);
+			}
+			if (prev.current == NULL) {
+				throw AVLTreeIteratorReachedEnd();
+			}
+
+			*this = prev;
+			return *this;
+		}
+
+		iterator operator--(int) {
+			iterator res = *this;
+			--(*this);
+			return res;
+		}
+
+		// Name			: getKey
+		// Description	: Returns the key of the iterator's node
+		// Parameters	: None
+		// Return Value : the key
+		const KeyType& getKey() const {
+			if (current == NULL) {
+				throw AVLTreeIteratorReachedEnd();
+			}
+
+			return current->_key;
+		}
+
+		// Dereference operator
+		// Description	: Returns the iterator's data
+		// Return Value : the iterator's saved data
+		T& operator*() const {
+			if (current == NULL) {
+				throw AVLTreeIteratorReachedEnd();
+			}
+
+			return current->_data;
+		}
+
+		// Member access operator
+		T* operator->() const {
+			return &(**this);
+		}
+
+		bool operator==(const iterator& rhs) const {
+			return ((tree == rhs.tree) && (current == rhs.current));
+		}
+
+		bool operator!=(const iterator& rhs) const {
+			return (!(*this == rhs));
+		}
+	};
+
+private:
+	// Name			: iteratorTo
+	// Description	: Returns an iterator to the given node. Without parent
+	//					links the path to the node is searched from the root.
+	// Parameters	:
+	//	@node - the node, NULL for end()
+	// Return Value : iterator to the node
+	iterator iteratorTo(Node* node) {
+		iterator res(this);
+
+		if (node == NULL || ParentLinks == true) {
+			res.current = node;
+			return res;
+		}
+		while (res.current != node) {
+			res.moveDown((node->_key < res.current->_key) ? LEFT : RIGHT);
+		}
+		return res;
+	}
+
+public:
+	//
+	// Public interface
+	//
+
+	// CompactAVLTree constructor
+	CompactAVLTree() :
+			root(NULL), size(INITIAL_SIZE), chunks(NULL), cursor(NULL), limit(
+					NULL), free_nodes(NULL) {
+	}
+
+	// CompactAVLTree constructor, chunks are allocated by the given
+	// allocator
+	explicit CompactAVLTree(const Allocator& alloc) :
+			root(NULL), size(INITIAL_SIZE), chunks(NULL), cursor(NULL), limit(
+					NULL), free_nodes(NULL), chunk_alloc(alloc) {
+	}
+
+	//	CompactAVLTree destructor
+	//	Nodes which need no destructor are freed with their chunks, without
+	//	walking the tree.
+	~CompactAVLTree() {
+		if (std::is_trivially_destructible<Node>::value == false) {
+			destroyAll();
+		}
+		freeChunks();
+	}
+
+	// Name			: Insert
+	// Description	: This function inserts a new node to the tree.
+	// Parameters	:
+	//	@key 	- the node's key
+	//	@data 	- the node's data
+	// Return Value : None
+	// 	If the key already exist, AVLTreeKeyAlreadyExistsException will be
+	// thrown.
+	void Insert(KeyType key, T const& data) {
+		Emplace(std::move(key), data);
+	}
+
+	// Name			: Insert
+	// Description	: This function inserts a new node to the tree, and moves
+	//					the given data into it.
+	// Parameters	:
+	//	@key 	- the node's key
+	//	@data 	- the node's data
+	// Return Value : None
+	// 	If the key already exist, AVLTreeKeyAlreadyExistsException will be
+	// thrown.
+	void Insert(KeyType key, T&& data) {
+		Emplace(std::move(key), std::move(data));
+	}
+
+	// Name			: Emplace
+	// Description	: Inserts a new node to the tree, whose data is
+	//					constructed in place from the given arguments.
+	// Parameters	:
+	//	@key 	- the node's key
+	//	@args 	- the arguments of the data constructor
+	// Return Value : Reference to the data of the new node
+	// 	If the key already exist, AVLTreeKeyAlreadyExistsException will be
+	// thrown.
+	template<class ... Args>
+	T& Emplace(KeyType key, Args&&... args) {
+		bool inserted;
+
+		Node* node = insertKey(std::move(key), &inserted,
+				std::forward<Args>(args)...);
+		if (inserted == false) {
+			throw AVLTreeKeyAlreadyExistsException();
+		}
+		return node->_data;
+	}
+
+	// Name			: InsertOrAssign
+	// Description	: Inserts a new node to the tree, or replaces the data of
+	//					the node if the key already exists.
+	// Parameters	:
+	//	@key 	- the node's key
+	//	@data 	- the node's data, copied or moved
+	// Return Value : true if a new node was inserted, false if the data of
+	//					an existing node was assigned
+	template<class Data>
+	bool InsertOrAssign(KeyType key, Data&& data) {
+		bool inserted;
+
+		Node* node = insertKey(std::move(key), &inserted,
+				std::forward<Data>(data));
+		if (inserted == false) {
+			node->_data = std::forward<Data>(data);
+		}
+		return inserted;
+	}
+
+	// Name			: TryEmplace
+	// Description	: Inserts a new node to the tree if the key doesn't exist.
+	//					Otherwise the tree isn't changed, and the arguments
+	//					aren't used.
+	// Parameters	:
+	//	@key 	- the node's key
+	//	@args 	- the arguments of the data constructor
+	// Return Value : A pair of a pointer to the data of the node which holds
+	//					the key, and whether it was inserted by this call
+	template<class ... Args>
+	std::pair<T*, bool> TryEmplace(KeyType key, Args&&... args) {
+		bool inserted;
+
+		Node* node = insertKey(std::move(key), &inserted,
+				std::forward<Args>(args)...);
+		return std::pair<T*, bool>(&node->_data, inserted);
+	}
+
+	// Name			: Delete
+	// Description	: This function deletes a node from the tree, by the given
+	// key.
+	// Parameters	:
+	//	@key - the key represents the node to delete
+	// Return Value : None, if the key wasn't found a suitable exception will
+	// be thrown (AVLTreeKeyNotFoundException).
+	void Delete(const KeyType& key) {
+		if (eraseKey(key, NULL) == false) {
+			throw AVLTreeKeyNotFoundException();
+		}
+	}
+
+	// Name			: Erase
+	// Description	: Deletes the node of the given key, if it exists.
+	// Parameters	:
+	//	@key		- the key represents the node to delete
+	//	@removed	- if not NULL, receives the data of the deleted node
+	// Return Value : true if the node was deleted, false if the key wasn't
+	//					found
+	bool Erase(const KeyType& key, T* removed = NULL) {
+		return eraseKey(key, removed);
+	}
+
+	// Name			: Find
+	// Description	: Returns an iterator to the node of the given key
+	// Parameters	:
+	//	@key - the key to find
+	// Return Value : iterator to the node
+	// If the key wasn't found, AVLTreeKeyNotFoundException will be thrown.
+	iterator Find(const KeyType& key) {
+		Node* node = findNode(key);
+		if (node == NULL) {
+			throw AVLTreeKeyNotFoundException();
+		}
+
+		return iteratorTo(node);
+	}
+
+	// Name			: TryFind
+	// Description	: Searches the data of the given key, without throwing on
+	//					a miss.
+	// Parameters	:
+	//	@key - the key to find
+	// Return Value : pointer to the data, or NULL if the key wasn't found
+	T* TryFind(const KeyType& key) {
+		Node* node = findNode(key);
+		return (node == NULL) ? NULL : &node->_data;
+	}
+
+	// Name			: Clear
+	// Description	: Deletes all the nodes, and frees their memory.
+	// Parameters	: None
+	// Return Value : None
+	void Clear(void) {
+		destroyAll();
+		freeChunks();
+	}
+
+	// Name			: getSize
+	// Description	: Returns the number of nodes in the tree
+	// Parameters	: None
+	// Return Value : the number of nodes
+	int getSize() const {
+		return size;
+	}
+
+	// Name			: Empty
+	// Description	: Tests whether the tree is empty
+	// Parameters	: None
+	// Return Value : true if the tree has no nodes
+	bool Empty(void) const {
+		return (size == INITIAL_SIZE);
+	}
+
+	// Name			: isBalanced
+	// Description	: This function tests if the tree is balanced, and that
+	//					the balance factors match the subtree heights. It
+	//					should always return true.
+	// Parameters	: None
+	// Return Value : true if balanced, false otherwise
+	bool isBalanced(void) const {
+		bool balanced = true;
+
+		checkHeight(root, &balanced);
+		return balanced;
+	}
+
+	// Name			: LowerBound
+	// Description	: Searches the first node whose key isn't less than the
+	//					given key.
+	// Parameters	:
+	//	@key - the bound
+	// Return Value : iterator to the node, or end() if there's none
+	iterator LowerBound(const KeyType& key) {
+		return iteratorTo(lowerBoundNode(key, false));
+	}
+
+	// Name			: UpperBound
+	// Description	: Searches the first node whose key is greater than the
+	//					given key.
+	// Parameters	:
+	//	@key - the bound
+	// Return Value : iterator to the node, or end() if there's none
+	iterator UpperBound(const KeyType& key) {
+		return iteratorTo(lowerBoundNode(key, true));
+	}
+
+	// Name			: begin
+	// Description	: Returns an iterator to the node with the minimal key
+	// Parameters	: None
+	// Return Value : iterator to the first node, end() if the tree is empty
+	iterator begin(void) {
+		iterator res(this);
+
+		if (res.current != NULL) {
+			res.moveToEdge(LEFT);
+		}
+		return res;
+	}
+
+	// Name			: end
+	// Description	: Returns the past-the-end iterator of the tree
+	// Parameters	: None
+	// Return Value : past-the-end iterator
+	iterator end(void) {
+		return iteratorTo(NULL);
+	}
+};
+
+#endif /* COMPACT_AVLTREE_HPP_ */
@@ -0,0 +1,448 @@
+#ifndef CONCURRENT_HASH_MAP_HPP_
+#define CONCURRENT_HASH_MAP_HPP_
+
+//
+//	File		: concurrent_hash_map.hpp
+//	Description	: Thread safe hash map, split into independently locked
+//					shards. Every shard is a HashMap with it's own
+//					readers-writer lock, so operations on different shards
+//					never wait for each other, lookups of one shard run
+//					together, and a shard resizes under it's own lock
+//					without stopping the others.
+//					Values are returned by copy, or visited under the
+//					shard's lock, since another thread may remove a mapping
+//					as soon as the lock is released.
+//
+
+#include <exception>
+#include "exceptions.hpp"
+#include "hash_map.hpp"
+#include "rw_lock.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+
+template<typename V, class K, class Storage = ChainedStorage,
+		class Hash = DefaultHash<K>, class Allocator = std::allocator<V> >
+class ConcurrentHashMap {
+	//
+	//	Class		: ConcurrentHashMap
+	//	Description : The shard of a key is selected by the high bits of
+	//					it's (remixed) hash, while the shard's HashMap uses
+	//					the low bits, so the keys of a shard still spread
+	//					over all of it's buckets.
+	//					Every shard gets it's own default constructed
+	//					allocator, so a PoolAllocator pool is only used under
+	//					the lock of it's shard. The shards array comes from
+	//					one more default constructed allocator. The hash
+	//					functor is called by many threads at once.
+
+public:
+	typedef HashMap<V, K, Storage, Hash, Allocator> Map;
+
+	//
+	// Constants
+	//
+	static const int DEFAULT_SHARDS = 64;
+	static const int MAX_SHARDS = 1 << 16;
+
+private:
+	static const size_t CACHE_LINE = 64;
+	static const uint64_t SHARD_MIX = 0x9E3779B97F4A7C15ULL;
+
+	// Every shard starts on it's own cache line, so the locks of different
+	// shards don't share lines
+	struct alignas(CACHE_LINE) Shard {
+		mutable ReaderWriterLock lock;
+		Map map;
+
+		explicit Shard(const Hash& hash) :
+				map(hash) {
+		}
+	};
+
+	typedef std::lock_guard<ReaderWriterLock> WriteGuard;
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<
+			char> BufferAllocator;
+	typedef std::allocator_traits<BufferAllocator> BufferAllocatorTraits;
+
+	Shard* shards;
+	char* shards_buffer;
+	// The shards are allocated with the map's allocator, so they're counted
+	// with the memory of their maps
+	BufferAllocator buffer_alloc;
+	int shard_count;
+	int shard_bits;
+	Hash hasher;
+
+	ConcurrentHashMap(const ConcurrentHashMap&);
+	ConcurrentHashMap& operator=(const ConcurrentHashMap&);
+
+	// Name			: bufferSize
+	// Description	: Returns the size of the shards buffer, with room to
+	//					align the first shard
+	// Parameters	: None
+	// Return Value : the size in bytes
+	size_t bufferSize(void) const {
+		return shard_count * sizeof(Shard) + CACHE_LINE;
+	}
+
+	// Name			: allocateShards
+	// Description	: Allocates the shards, aligned to cache lines
+	// Parameters	: None
+	// Return Value : None
+	// If memory allocation failes, a matching exception would be thrown by
+	//	the allocator.
+	void allocateShards(void) {
+		shards_buffer = BufferAllocatorTraits::allocate(buffer_alloc,
+				bufferSize());
+		size_t address = reinterpret_cast<size_t>(shards_buffer);
+		address = (address + CACHE_LINE - 1) & ~(CACHE_LINE - 1);
+		shards = reinterpret_cast<Shard*>(address);
+
+		int constructed = 0;
+		try {
+			for (; constructed < shard_count; constructed++) {
+				new (&shards[constructed]) Shard(hasher);
+			}
+		} catch (...) {
+			while (constructed > 0) {
+				shards[--constructed].~Shard();
+			}
+			BufferAllocatorTraits::deallocate(buffer_alloc, shards_buffer,
+					bufferSize());
+			throw;
+		}
+	}
+
+	// Name			: shardOf
+	// Description	: Selects the shard of the given key
+	// Parameters	:
+	//	@key - the key
+	// Return Value : the shard
+	Shard& shardOf(const K& key) const {
+		if (shard_bits == 0) {
+			return shards[0];
+		}
+
+		uint64_t mixed = (uint64_t) hasher(key) * SHARD_MIX;
+		return shards[(size_t) (mixed >> (64 - shard_bits))];
+	}
+
+public:
+	// ConcurrentHashMap constructor
+	//	@count	- number of shards, rounded up to a power of two
+	//	@hash	- the hash functor
+	// 	If the number of shards isn't in [1, MAX_SHARDS],
+	// HashMapInvalidArgException will be thrown.
+	explicit ConcurrentHashMap(int count = DEFAULT_SHARDS, const Hash& hash =
+			Hash()) :
+			shards(NULL), shards_buffer(NULL), shard_count(1), shard_bits(0), hasher(
+					hash) {
+		if (count <= 0 || count > MAX_SHARDS) {
+			throw HashMapInvalidArgException();
+		}
+
+		while (shard_count < count) {
+			shard_count *= 2;
+			shard_bits++;
+		}
+		allocateShards();
+	}
+
+	// ConcurrentHashMap destructor, no other thread may use the map
+	~ConcurrentHashMap() {
+		for (int i = 0; i < shard_count; i++) {
+			shards[i].~Shard();
+		}
+		BufferAllocatorTraits::deallocate(buffer_alloc, shards_buffer,
+				bufferSize());
+	}
+
+	// Name			: getShardCount
+	// Description	: Returns the number of shards
+	// Parameters	: None
+	// Return Value : the number of shards
+	int getShardCount() const {
+		return shard_count;
+	}
+
+	// Name			: SetIncrementalResize
+	// Description	: Selects how the shards are resized
+	//					(see HashMap::SetIncrementalResize).
+	// Parameters	:
+	//	@step - number of old entries to move per operation
+	// Return Value : None
+	// 	If the step is negative, HashMapInvalidArgException will be thrown.
+	void SetIncrementalResize(int step) {
+		if (step < 0) {
+			throw HashMapInvalidArgException();
+		}
+
+		for (int i = 0; i < shard_count; i++) {
+			WriteGuard guard(shards[i].lock);
+			shards[i].map.SetIncrementalResize(step);
+		}
+	}
+
+	// Name			: SetLoadFactorPolicy
+	// Description	: Replaces the resize thresholds of all the shards
+	//					(see HashMap::SetLoadFactorPolicy).
+	// Parameters	:
+	//	@new_policy - the new policy
+	// Return Value : None
+	// 	If the policy is invalid, HashMapInvalidArgException will be thrown.
+	void SetLoadFactorPolicy(const LoadFactorPolicy& new_policy) {
+		for (int i = 0; i < shard_count; i++) {
+			WriteGuard guard(shards[i].lock);
+			shards[i].map.SetLoadFactorPolicy(new_policy);
+		}
+	}
+
+	// Name			: Reserve
+	// Description	: Resizes every shard to hold it's share of the given
+	//					number of mappings (see HashMap::Reserve).
+	// Parameters	:
+	//	@count - the expected number of mappings
+	// Return Value : None
+	// 	If the count is negative, HashMapInvalidArgException will be thrown.
+	void Reserve(int count) {
+		if (count < 0) {
+			throw HashMapInvalidArgException();
+		}
+
+		int share = count / shard_count + ((count % shard_count) != 0);
+		for (int i = 0; i < shard_count; i++) {
+			WriteGuard guard(shards[i].lock);
+			shards[i].map.Reserve(share);
+		}
+	}
+
+	// Name			: Insert
+	// Description	: This function inserts an element to the map
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@data 	-  value to be associated with the specified key
+	// Return Value : None
+	// 	If the key already exist, HashMapKeyAlreadyExistsException will be
+	// thrown.
+	void Insert(K key, const V& obj) {
+		Emplace(std::move(key), obj);
+	}
+
+	// Name			: Insert
+	// Description	: This function inserts an element to the map, and moves
+	//					the given object into it
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@data 	-  value to be associated with the specified key
+	// Return Value : None
+	// 	If the key already exist, HashMapKeyAlreadyExistsException will be
+	// thrown.
+	void Insert(K key, V&& obj) {
+		Emplace(std::move(key), std::move(obj));
+	}
+
+	// Name			: Emplace
+	// Description	: Inserts an element to the map, which is constructed in
+	//					place from the given arguments.
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@args 	- the arguments of the value constructor
+	// Return Value : None
+	// 	If the key already exist, HashMapKeyAlreadyExistsException will be
+	// thrown.
+	template<class ... Args>
+	void Emplace(K key, Args&&... args) {
+		Shard& shard = shardOf(key);
+		WriteGuard guard(shard.lock);
+		shard.map.Emplace(std::move(key), std::forward<Args>(args)...);
+	}
+
+	// Name			: InsertOrAssign
+	// Description	: Inserts an element to the map, or assigns the given
+	//					object to the existing element with the same key.
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@obj 	- value to be associated with the specified key, copied or
+	//				moved
+	// Return Value : true if the element was inserted, false if assigned
+	template<class Value>
+	bool InsertOrAssign(K key, Value&& obj) {
+		Shard& shard = shardOf(key);
+		WriteGuard guard(shard.lock);
+		return shard.map.InsertOrAssign(std::move(key),
+				std::forward<Value>(obj));
+	}
+
+	// Name			: TryEmplace
+	// Description	: Inserts an element to the map if the key doesn't exist.
+	//					Otherwise the map isn't changed, and the arguments
+	//					aren't used.
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@args 	- the arguments of the value constructor
+	// Return Value : true if the element was inserted by this call
+	template<class ... Args>
+	bool TryEmplace(K key, Args&&... args) {
+		Shard& shard = shardOf(key);
+		WriteGuard guard(shard.lock);
+		return shard.map.TryEmplace(std::move(key),
+				std::forward<Args>(args)...).second;
+	}
+
+	// Name			: Delete
+	// Description	: Removes the mapping for the specified key from this map.
+	// Parameters	:
+	//	@key - key whose mapping is to be removed from the map
+	// Return Value : None, if the key wasn't found a suitable exception will
+	// be thrown (HashMapKeyNotFoundException).
+	void Delete(const K& key) {
+		if (Erase(key) == false) {
+			throw HashMapKeyNotFoundException();
+		}
+	}
+
+	// Name			: Erase
+	// Description	: Removes the mapping for the specified key from this map
+	//					if present.
+	// Parameters	:
+	//	@key		- key whose mapping is to be removed from the map
+	//	@removed	- if not NULL, receives the removed value
+	// Return Value : true if the mapping was removed, false if the key
+	//					wasn't found
+	bool Erase(const K& key, V* removed = NULL) {
+		Shard& shard = shardOf(key);
+		WriteGuard guard(shard.lock);
+
+		if (removed != NULL) {
+			V* value = shard.map.TryFind(key);
+			if (value == NULL) {
+				return false;
+			}
+			*removed = std::move(*value);
+		}
+		return shard.map.Erase(key);
+	}
+
+	// Name			: Find
+	// Description	: Finds an element with key equivalent to key.
+	// Parameters	:
+	//	key - key value of the element to search for
+	// Return Value : Copy of the element with key equivalent to key.
+	//					If no such element is found, an exception would be
+	// 					thrown.
+	V Find(const K& key) const {
+		Shard& shard = shardOf(key);
+		SharedLockGuard guard(shard.lock);
+		return shard.map.Find(key);
+	}
+
+	// Name			: TryFind
+	// Description	: Copies the element with key equivalent to key, without
+	//					throwing on a miss.
+	// Parameters	:
+	//	key		- key value of the element to search for
+	//	value	- receives a copy of the element
+	// Return Value : true if the element was found
+	bool TryFind(const K& key, V* value) const {
+		Shard& shard = shardOf(key);
+		SharedLockGuard guard(shard.lock);
+
+		V* found = shard.map.TryFind(key);
+		if (found == NULL) {
+			return false;
+		}
+		*value = *found;
+		return true;
+	}
+
+	// Name			: Contains
+	// Description	: Tests if this map contains a mapping for the specified key.
+	// Parameters	:
+	//	key - The key whose presence in this map is to be tested
+	// Return Value : true if this map contains a mapping for the specified key
+	bool Contains(const K& key) const {
+		Shard& shard = shardOf(key);
+		SharedLockGuard guard(shard.lock);
+		return shard.map.Contains(key);
+	}
+
+	// Name			: Visit
+	// Description	: Calls the visitor on the element of the given key,
+	//					while it's shard is locked shared. The visitor must
+	//					not use the map.
+	// Parameters	:
+	//	@key		- key value of the element to visit
+	//	@visitor	- callable, invoked as visitor(const V&)
+	// Return Value : true if the element was found
+	template<class Visitor>
+	bool Visit(const K& key, Visitor visitor) const {
+		Shard& shard = shardOf(key);
+		SharedLockGuard guard(shard.lock);
+
+		const V* value = shard.map.TryFind(key);
+		if (value == NULL) {
+			return false;
+		}
+		visitor(*value);
+		return true;
+	}
+
+	// Name			: Update
+	// Description	: Calls the updater on the element of the given key,
+	//					while it's shard is locked exclusively, so a
+	//					read-modify-write of the element is atomic. The
+	//					updater must not use the map.
+	// Parameters	:
+	//	@key		- key value of the element to update
+	//	@updater	- callable, invoked as updater(V&)
+	// Return Value : true if the element was found
+	template<class Updater>
+	bool Update(const K& key, Updater updater) {
+		Shard& shard = shardOf(key);
+		WriteGuard guard(shard.lock);
+
+		V* value = shard.map.TryFind(key);
+		if (value == NULL) {
+			return false;
+		}
+		updater(*value);
+		return true;
+	}
+
+	// Name			: getSize
+	// Description	: Returns the number of key-value mappings in this map.
+	//					The shards are counted one by one, so while other
+	//					threads change the map the result is approximate.
+	// Parameters	: None
+	// Return Value : the number of key-value mappings in this map
+	int getSize() const {
+		int size = 0;
+
+		for (int i = 0; i < shard_count; i++) {
+			SharedLockGuard guard(shards[i].lock);
+			size += shards[i].map.getSize();
+		}
+		return size;
+	}
+
+	// Name			: Empty
+	// Description	: This function tests whether the map is empty or not.
+	// Parameters	: None
+	// Return Value : true if this map contains no key-value mappings
+	bool Empty() const {
+		for (int i = 0; i < shard_count; i++) {
+			SharedLockGuard guard(shards[i].lock);
+			if (shards[i].map.Empty() == false) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+#endif /* CONCURRENT_HASH_MAP_HPP_ */
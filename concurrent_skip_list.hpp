@@ -0,0 +1,714 @@
+#ifndef CONCURRENT_SKIP_LIST_HPP_
+#define CONCURRENT_SKIP_LIST_HPP_
+
+//
+//	File		: concurrent_skip_list.hpp
+//	Description	: Thread safe ordered map, implemented as a lazy skip list
+//					(Herlihy, Lev, Luchangco and Shavit). Lookups and range
+//					scans take no lock and never wait. Insert and Delete
+//					lock only the predecessors of the node they link or
+//					unlink, so writers of different key ranges run
+//					together.
+//					A node is first marked (logically deleted) and then
+//					unlinked. Readers skip marked nodes and nodes which
+//					aren't fully linked yet. Unlinked nodes, and the values
+//					replaced by InsertOrAssign, are freed only when no
+//					reader can still be on them (epoch.hpp).
+//
+
+#include <exception>
+#include "exceptions.hpp"
+#include "epoch.hpp"
+#include "rw_lock.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+template<class T, typename KeyType>
+class ConcurrentSkipList {
+	//
+	//	Class		: ConcurrentSkipList
+	//	Description : The values are returned by copy, or visited inside
+	//					the reader's epoch, since another thread may remove
+	//					them meanwhile. A value is never changed in place:
+	//					InsertOrAssign publishes a new one.
+	//					Nodes are allocated by the global operator new,
+	//					which, unlike the pools of pool_allocator.hpp, may be
+	//					called by many writers at once.
+
+private:
+	//
+	// Constants
+	//
+	static const int MAX_LEVEL = 24;
+	// A node reaches every next level with a probability of 1/4
+	static const uint32_t LEVEL_MASK = 3;
+	static const size_t RECLAIM_THRESHOLD = 64;
+
+	struct Value {
+		T data;
+
+		template<class ... Args>
+		explicit Value(Args&&... args) :
+				data(std::forward<Args>(args)...) {
+		}
+	};
+
+	struct Node {
+		// The head node has no key
+		typename std::aligned_storage<sizeof(KeyType), alignof(KeyType)>::type key_storage;
+		std::atomic<Value*> value;
+		ReaderWriterLock lock;
+		std::atomic<bool> marked;
+		std::atomic<bool> fully_linked;
+		int top_level;
+		// top_level links, allocated with the node
+		std::atomic<Node*> next[1];
+
+		explicit Node(int top_level) :
+				value(NULL), marked(false), fully_linked(false), top_level(
+						top_level) {
+			for (int i = 0; i < top_level; i++) {
+				new (&next[i]) std::atomic<Node*>(NULL);
+			}
+		}
+
+		const KeyType& key() const {
+			return *reinterpret_cast<const KeyType*>(&key_storage);
+		}
+	};
+
+	struct Retired {
+		Node* node;
+		Value* value;
+		uint64_t epoch;
+	};
+
+	Node* head;
+	// The highest level any node had, lookups start there
+	std::atomic<int> level;
+	std::atomic<int> size;
+	std::mutex retire_lock;
+	std::vector<Retired> retired;
+
+	ConcurrentSkipList(const ConcurrentSkipList&);
+	ConcurrentSkipList& operator=(const ConcurrentSkipList&);
+
+	// Name			: allocateNode
+	// Description	: Allocates a node with the given number of links, whose
+	//					key isn't constructed
+	// If memory allocation failes, a matching exception would be thrown by
+	//	the system.
+	static Node* allocateNode(int top_level) {
+		void* memory = ::operator new(
+				sizeof(Node) + (top_level - 1) * sizeof(std::atomic<Node*>));
+		return new (memory) Node(top_level);
+	}
+
+	static void freeNode(Node* node) {
+		node->~Node();
+		::operator delete(node);
+	}
+
+	// Name			: createNode
+	// Description	: Creates a node of the given key and value
+	// Parameters	:
+	//	@top_level	- number of links
+	//	@key		- the key
+	//	@value		- the value, owned by the node once it's created
+	// Return Value : the new node
+	static Node* createNode(int top_level, KeyType&& key, Value* value) {
+		Node* node = allocateNode(top_level);
+		try {
+			new (&node->key_storage) KeyType(std::move(key));
+		} catch (...) {
+			freeNode(node);
+			throw;
+		}
+		node->value.store(value, std::memory_order_relaxed);
+		return node;
+	}
+
+	static void destroyNode(Node* node) {
+		delete node->value.load(std::memory_order_relaxed);
+		node->key().~KeyType();
+		freeNode(node);
+	}
+
+	// Name			: randomLevel
+	// Description	: Draws the number of links of a new node, from a per
+	//					thread xorshift generator
+	// Parameters	: None
+	// Return Value : the number of links, in [1, MAX_LEVEL]
+	static int randomLevel() {
+		static thread_local uint32_t state = 0;
+		if (state == 0) {
+			state = (uint32_t) reinterpret_cast<size_t>(&state) | 1;
+		}
+
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+
+		int res = 1;
+		uint32_t bits = state;
+		while (res < MAX_LEVEL && (bits & LEVEL_MASK) == 0) {
+			res++;
+			bits >>= 2;
+		}
+		return res;
+	}
+
+	// Name			: findNode
+	// Description	: Searches the given key, and records on every level the
+	//					last node before it and the first node from it on.
+	//					Must be called inside an EpochGuard.
+	// Parameters	:
+	//	@key	- the key
+	//	@preds	- if not NULL, receives the predecessors of every level
+	//	@succs	- if not NULL, receives the successors of every level
+	// Return Value : the highest level in which the key was found, -1 if it
+	//					wasn't found
+	int findNode(const KeyType& key, Node** preds, Node** succs) const {
+		int found = -1;
+		Node* pred = head;
+		int top = (preds != NULL) ?
+				MAX_LEVEL - 1 : level.load(std::memory_order_relaxed) - 1;
+
+		for (int i = top; i >= 0; i--) {
+			Node* curr = pred->next[i].load(std::memory_order_acquire);
+			while (curr != NULL && curr->key() < key) {
+				pred = curr;
+				curr = pred->next[i].load(std::memory_order_acquire);
+			}
+
+			if (found == -1 && curr != NULL && !(key < curr->key())) {
+				found = i;
+				if (preds == NULL) {
+					return found;
+				}
+			}
+			if (preds != NULL) {
+				preds[i] = pred;
+				succs[i] = curr;
+			}
+		}
+		return found;
+	}
+
+	// Name			: findLive
+	// Description	: Searches the node of the given key, if it's fully
+	//					linked and not deleted. Must be called inside an
+	//					EpochGuard.
+	// Parameters	:
+	//	@key - the key
+	// Return Value : the node, NULL if the key isn't in the map
+	Node* findLive(const KeyType& key) const {
+		Node* pred = head;
+
+		for (int i = level.load(std::memory_order_relaxed) - 1; i >= 0; i--) {
+			Node* curr = pred->next[i].load(std::memory_order_acquire);
+			while (curr != NULL && curr->key() < key) {
+				pred = curr;
+				curr = pred->next[i].load(std::memory_order_acquire);
+			}
+
+			if (curr != NULL && !(key < curr->key())) {
+				if (curr->fully_linked.load(std::memory_order_acquire)
+						&& !curr->marked.load(std::memory_order_acquire)) {
+					return curr;
+				}
+				return NULL;
+			}
+		}
+		return NULL;
+	}
+
+	// Name			: unlockPreds
+	// Description	: Unlocks the predecessors locked by a writer, each one
+	//					once
+	// Parameters	:
+	//	@preds			- the predecessors
+	//	@highest_locked	- the highest level whose predecessor was locked
+	// Return Value : None
+	static void unlockPreds(Node** preds, int highest_locked) {
+		Node* prev = NULL;
+		for (int i = 0; i <= highest_locked; i++) {
+			if (preds[i] != prev) {
+				preds[i]->lock.unlock();
+				prev = preds[i];
+			}
+		}
+	}
+
+	// Name			: lockPreds
+	// Description	: Locks the predecessors of the levels [0, top_level),
+	//					and checks that they still link to the successors.
+	// Parameters	:
+	//	@preds			- the predecessors
+	//	@succs			- the expected successors
+	//	@top_level		- number of levels
+	//	@inserting		- true if a node is linked between the predecessors
+	//						and the successors, which mustn't be deleted.
+	//						Otherwise the (marked) successors are unlinked.
+	//	@highest_locked	- receives the highest locked level
+	// Return Value : true if the links are still valid
+	static bool lockPreds(Node** preds, Node** succs, int top_level,
+			bool inserting, int* highest_locked) {
+		Node* prev = NULL;
+
+		*highest_locked = -1;
+		for (int i = 0; i < top_level; i++) {
+			Node* pred = preds[i];
+			Node* succ = succs[i];
+			if (pred != prev) {
+				pred->lock.lock();
+				*highest_locked = i;
+				prev = pred;
+			}
+
+			if (pred->marked.load(std::memory_order_relaxed)
+					|| (inserting == true && succ != NULL
+							&& succ->marked.load(std::memory_order_relaxed))
+					|| pred->next[i].load(std::memory_order_relaxed) != succ) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Name			: retire
+	// Description	: Queues an unlinked node or a replaced value until no
+	//					reader can be on it, and reclaims the queue now and
+	//					then.
+	// Parameters	:
+	//	@node	- an unlinked node, or NULL
+	//	@value	- a replaced value, or NULL
+	// Return Value : None
+	void retire(Node* node, Value* value) {
+		Retired item;
+		item.node = node;
+		item.value = value;
+		item.epoch = EpochDomain::Retire();
+
+		std::lock_guard<std::mutex> guard(retire_lock);
+		retired.push_back(item);
+		if (retired.size() < RECLAIM_THRESHOLD) {
+			return;
+		}
+
+		uint64_t min_active = EpochDomain::MinActive();
+		size_t kept = 0;
+		for (size_t i = 0; i < retired.size(); i++) {
+			if (retired[i].epoch < min_active) {
+				freeRetired(retired[i]);
+			} else {
+				retired[kept++] = retired[i];
+			}
+		}
+		retired.resize(kept);
+	}
+
+	static void freeRetired(const Retired& item) {
+		if (item.node != NULL) {
+			destroyNode(item.node);
+		} else {
+			delete item.value;
+		}
+	}
+
+	// Name			: insertKey
+	// Description	: Links a new node of the given key, unless the key
+	//					exists. If assign is set, the value of an existing
+	//					key is replaced instead.
+	// Parameters	:
+	//	@assign	- true to replace the value of an existing key
+	//	@key	- the key
+	//	@args	- the arguments of the value constructor
+	// Return Value : true if a new node was linked
+	template<class ... Args>
+	bool insertKey(bool assign, KeyType&& key, Args&&... args) {
+		Node* preds[MAX_LEVEL];
+		Node* succs[MAX_LEVEL];
+		int top_level = randomLevel();
+		// The arguments are used once, the value survives the retries
+		Value* value = NULL;
+		EpochGuard epoch;
+
+		for (;;) {
+			int found = findNode(key, preds, succs);
+			if (found != -1) {
+				Node* node = succs[found];
+				if (node->marked.load(std::memory_order_acquire)) {
+					// Being deleted, retry once it's unlinked
+					continue;
+				}
+				while (!node->fully_linked.load(std::memory_order_acquire)) {
+					std::this_thread::yield();
+				}
+				if (assign == false) {
+					return false;
+				}
+
+				if (value == NULL) {
+					value = new Value(std::forward<Args>(args)...);
+				}
+				node->lock.lock();
+				if (node->marked.load(std::memory_order_relaxed)) {
+					node->lock.unlock();
+					continue;
+				}
+				Value* old_value = node->value.exchange(value,
+						std::memory_order_acq_rel);
+				node->lock.unlock();
+				retire(NULL, old_value);
+				return false;
+			}
+
+			int highest_locked;
+			if (!lockPreds(preds, succs, top_level, true, &highest_locked)) {
+				unlockPreds(preds, highest_locked);
+				continue;
+			}
+
+			Node* node;
+			try {
+				if (value == NULL) {
+					value = new Value(std::forward<Args>(args)...);
+				}
+				node = createNode(top_level, std::move(key), value);
+			} catch (...) {
+				unlockPreds(preds, highest_locked);
+				delete value;
+				throw;
+			}
+
+			for (int i = 0; i < top_level; i++) {
+				node->next[i].store(succs[i], std::memory_order_relaxed);
+			}
+			for (int i = 0; i < top_level; i++) {
+				preds[i]->next[i].store(node, std::memory_order_release);
+			}
+			node->fully_linked.store(true, std::memory_order_release);
+			unlockPreds(preds, highest_locked);
+
+			int current = level.load(std::memory_order_relaxed);
+			while (current < top_level
+					&& !level.compare_exchange_weak(current, top_level,
+							std::memory_order_relaxed)) {
+			}
+			size.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	// Name			: eraseKey
+	// Description	: Marks the node of the given key and unlinks it.
+	// Parameters	:
+	//	@key		- the key
+	//	@removed	- if not NULL, receives a copy of the removed value
+	// Return Value : true if this call removed the key
+	bool eraseKey(const KeyType& key, T* removed) {
+		Node* preds[MAX_LEVEL];
+		Node* succs[MAX_LEVEL];
+		Node* victim = NULL;
+		bool is_marked = false;
+		int top_level = -1;
+		EpochGuard epoch;
+
+		for (;;) {
+			int found = findNode(key, preds, succs);
+			if (is_marked == false) {
+				if (found == -1) {
+					return false;
+				}
+
+				// A node which isn't fully linked yet is inserted after
+				// this call, a marked one is deleted by another thread
+				victim = succs[found];
+				if (!victim->fully_linked.load(std::memory_order_acquire)
+						|| victim->top_level - 1 != found
+						|| victim->marked.load(std::memory_order_acquire)) {
+					return false;
+				}
+
+				top_level = victim->top_level;
+				victim->lock.lock();
+				if (victim->marked.load(std::memory_order_relaxed)) {
+					victim->lock.unlock();
+					return false;
+				}
+				victim->marked.store(true, std::memory_order_release);
+				is_marked = true;
+			}
+
+			int highest_locked;
+			if (!lockPreds(preds, succs, top_level, false, &highest_locked)) {
+				unlockPreds(preds, highest_locked);
+				continue;
+			}
+
+			if (removed != NULL) {
+				*removed = victim->value.load(std::memory_order_acquire)->data;
+			}
+			for (int i = top_level - 1; i >= 0; i--) {
+				preds[i]->next[i].store(
+						victim->next[i].load(std::memory_order_relaxed),
+						std::memory_order_release);
+			}
+			victim->lock.unlock();
+			unlockPreds(preds, highest_locked);
+			size.fetch_sub(1, std::memory_order_relaxed);
+			retire(victim, NULL);
+			return true;
+		}
+	}
+
+public:
+	// ConcurrentSkipList constructor
+	ConcurrentSkipList() :
+			head(allocateNode(MAX_LEVEL)), level(1), size(0) {
+	}
+
+	// ConcurrentSkipList destructor, no other thread may use the list
+	~ConcurrentSkipList() {
+		Node* node = head->next[0].load(std::memory_order_relaxed);
+		while (node != NULL) {
+			Node* next = node->next[0].load(std::memory_order_relaxed);
+			destroyNode(node);
+			node = next;
+		}
+		freeNode(head);
+
+		for (size_t i = 0; i < retired.size(); i++) {
+			freeRetired(retired[i]);
+		}
+	}
+
+	// Name			: Insert
+	// Description	: This function inserts a new node to the list.
+	// Parameters	:
+	//	@key 	- the node's key
+	//	@data 	- the node's data
+	// Return Value : None
+	// 	If the key already exist, AVLTreeKeyAlreadyExistsException will be
+	// thrown.
+	void Insert(KeyType key, T const& data) {
+		if (insertKey(false, std::move(key), data) == false) {
+			throw AVLTreeKeyAlreadyExistsException();
+		}
+	}
+
+	// Name			: Insert
+	// Description	: This function inserts a new node to the list, and moves
+	//					the given data into it.
+	// Parameters	:
+	//	@key 	- the node's key
+	//	@data 	- the node's data
+	// Return Value : None
+	// 	If the key already exist, AVLTreeKeyAlreadyExistsException will be
+	// thrown.
+	void Insert(KeyType key, T&& data) {
+		if (insertKey(false, std::move(key), std::move(data)) == false) {
+			throw AVLTreeKeyAlreadyExistsException();
+		}
+	}
+
+	// Name			: TryEmplace
+	// Description	: Inserts a new node to the list if the key doesn't
+	//					exist. Otherwise the list isn't changed, and the
+	//					arguments aren't used.
+	// Parameters	:
+	//	@key 	- the node's key
+	//	@args 	- the arguments of the data constructor
+	// Return Value : true if the node was inserted by this call
+	template<class ... Args>
+	bool TryEmplace(KeyType key, Args&&... args) {
+		return insertKey(false, std::move(key), std::forward<Args>(args)...);
+	}
+
+	// Name			: InsertOrAssign
+	// Description	: Inserts a new node to the list, or replaces the data of
+	//					the node if the key already exists. Readers see either
+	//					the old or the new data.
+	// Parameters	:
+	//	@key 	- the node's key
+	//	@data 	- the node's data, copied or moved
+	// Return Value : true if a new node was inserted, false if the data of
+	//					an existing node was replaced
+	template<class Data>
+	bool InsertOrAssign(KeyType key, Data&& data) {
+		return insertKey(true, std::move(key), std::forward<Data>(data));
+	}
+
+	// Name			: Delete
+	// Description	: This function deletes a node from the list, by the
+	// given key.
+	// Parameters	:
+	//	@key - the key represents the node to delete
+	// Return Value : None, if the key wasn't found a suitable exception will
+	// be thrown (AVLTreeKeyNotFoundException).
+	void Delete(const KeyType& key) {
+		if (eraseKey(key, NULL) == false) {
+			throw AVLTreeKeyNotFoundException();
+		}
+	}
+
+	// Name			: Erase
+	// Description	: Deletes the node of the given key, if it exists.
+	// Parameters	:
+	//	@key		- the key represents the node to delete
+	//	@removed	- if not NULL, receives a copy of the deleted data
+	// Return Value : true if the node was deleted by this call
+	bool Erase(const KeyType& key, T* removed = NULL) {
+		return eraseKey(key, removed);
+	}
+
+	// Name			: Find
+	// Description	: Finds the data of the given key, without locking.
+	// Parameters	:
+	//	@key - the key to find
+	// Return Value : copy of the data
+	// If the key wasn't found, AVLTreeKeyNotFoundException will be thrown.
+	T Find(const KeyType& key) const {
+		EpochGuard epoch;
+		Node* node = findLive(key);
+		if (node == NULL) {
+			throw AVLTreeKeyNotFoundException();
+		}
+
+		return node->value.load(std::memory_order_acquire)->data;
+	}
+
+	// Name			: TryFind
+	// Description	: Copies the data of the given key, without locking or
+	//					throwing on a miss.
+	// Parameters	:
+	//	@key	- the key to find
+	//	@data	- receives a copy of the data
+	// Return Value : true if the key was found
+	bool TryFind(const KeyType& key, T* data) const {
+		EpochGuard epoch;
+		Node* node = findLive(key);
+		if (node == NULL) {
+			return false;
+		}
+
+		*data = node->value.load(std::memory_order_acquire)->data;
+		return true;
+	}
+
+	// Name			: Contains
+	// Description	: Tests whether the list holds the given key, without
+	//					locking.
+	// Parameters	:
+	//	@key - the key
+	// Return Value : true if the key was found
+	bool Contains(const KeyType& key) const {
+		EpochGuard epoch;
+		return (findLive(key) != NULL);
+	}
+
+	// Name			: Visit
+	// Description	: Calls the visitor on the data of the given key, without
+	//					locking. The data stays valid during the call, even if
+	//					a writer removes or replaces it meanwhile.
+	// Parameters	:
+	//	@key		- the key
+	//	@visitor	- callable, invoked as visitor(const T&)
+	// Return Value : true if the key was found
+	template<class Visitor>
+	bool Visit(const KeyType& key, Visitor visitor) const {
+		EpochGuard epoch;
+		Node* node = findLive(key);
+		if (node == NULL) {
+			return false;
+		}
+
+		visitor(node->value.load(std::memory_order_acquire)->data);
+		return true;
+	}
+
+	// Name			: RangeScan
+	// Description	: Visits, in key order and without locking, every node
+	//					whose key is in the range [lo, hi). The scan isn't a
+	//					snapshot: nodes inserted or deleted meanwhile may or
+	//					may not be visited, every other node is.
+	// Parameters	:
+	//	@lo			- the lower bound (inclusive)
+	//	@hi			- the upper bound (exclusive)
+	//	@visitor	- callable, invoked as visitor(key, data)
+	// Return Value : the number of visited nodes
+	template<class Visitor>
+	int RangeScan(const KeyType& lo, const KeyType& hi, Visitor visitor) const {
+		EpochGuard epoch;
+		Node* pred = head;
+		int count = 0;
+
+		for (int i = level.load(std::memory_order_relaxed) - 1; i >= 0; i--) {
+			Node* curr = pred->next[i].load(std::memory_order_acquire);
+			while (curr != NULL && curr->key() < lo) {
+				pred = curr;
+				curr = pred->next[i].load(std::memory_order_acquire);
+			}
+		}
+
+		for (Node* curr = pred->next[0].load(std::memory_order_acquire);
+				curr != NULL && curr->key() < hi;
+				curr = curr->next[0].load(std::memory_order_acquire)) {
+			if (curr->fully_linked.load(std::memory_order_acquire)
+					&& !curr->marked.load(std::memory_order_acquire)) {
+				visitor(curr->key(),
+						curr->value.load(std::memory_order_acquire)->data);
+				count++;
+			}
+		}
+		return count;
+	}
+
+	// Name			: TryGetMinimal
+	// Description	: Copies the node with the minimal key, without locking.
+	// Parameters	:
+	//	@key	- receives a copy of the key
+	//	@data	- receives a copy of the data
+	// Return Value : true if the list had a node
+	bool TryGetMinimal(KeyType* key, T* data) const {
+		EpochGuard epoch;
+
+		for (Node* curr = head->next[0].load(std::memory_order_acquire);
+				curr != NULL;
+				curr = curr->next[0].load(std::memory_order_acquire)) {
+			if (curr->fully_linked.load(std::memory_order_acquire)
+					&& !curr->marked.load(std::memory_order_acquire)) {
+				*key = curr->key();
+				*data = curr->value.load(std::memory_order_acquire)->data;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Name			: getSize
+	// Description	: Returns the number of nodes in the list
+	// Parameters	: None
+	// Return Value : the number of nodes
+	int getSize() const {
+		return size.load(std::memory_order_relaxed);
+	}
+
+	// Name			: Empty
+	// Description	: Tests whether the list is empty
+	// Parameters	: None
+	// Return Value : true if the list has no nodes
+	bool Empty(void) const {
+		return (getSize() == 0);
+	}
+};
+
+#endif /* CONCURRENT_SKIP_LIST_HPP_ */
@@ -0,0 +1,177 @@
+#ifndef EPOCH_HPP_
+#define EPOCH_HPP_
+
+//
+//	File		: epoch.hpp
+//	Description	: Epoch based memory reclamation, for containers whose
+//					readers traverse nodes without locks.
+//					A reader holds an EpochGuard while it touches the
+//					container. Entering announces the current epoch in the
+//					reader's own record (a cache line no other thread
+//					writes). A writer unlinks a node, then tags it with
+//					EpochDomain::Retire(); the node may be freed once
+//					every active reader announced a later epoch
+//					(EpochDomain::MinActive()).
+//					The records are process wide and are reused by new
+//					threads after their thread exits.
+//
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+class EpochDomain {
+public:
+	//
+	// Constants
+	//
+	static const uint64_t INACTIVE = 0;
+	static const uint64_t NO_READERS = UINT64_MAX;
+
+private:
+	static const size_t CACHE_LINE = 64;
+
+	struct alignas(CACHE_LINE) Record {
+		// The epoch the thread entered at, INACTIVE outside of a guard
+		std::atomic<uint64_t> epoch;
+		std::atomic<bool> in_use;
+		Record* next;
+		int nesting;
+
+		Record() :
+				epoch(INACTIVE), in_use(true), next(NULL), nesting(0) {
+		}
+	};
+
+	// Releases the record of a thread when it exits
+	struct ThreadSlot {
+		Record* record;
+
+		ThreadSlot() :
+				record(NULL) {
+		}
+
+		~ThreadSlot() {
+			if (record != NULL) {
+				record->in_use.store(false, std::memory_order_release);
+			}
+		}
+	};
+
+	static std::atomic<uint64_t>& globalEpoch() {
+		static std::atomic<uint64_t> epoch(INACTIVE + 1);
+		return epoch;
+	}
+
+	static std::atomic<Record*>& records() {
+		static std::atomic<Record*> head(NULL);
+		return head;
+	}
+
+	// Name			: acquireRecord
+	// Description	: Takes a record no thread uses, or adds a new one to the
+	//					list. Records are never freed.
+	// Parameters	: None
+	// Return Value : the record of the calling thread
+	static Record* acquireRecord() {
+		for (Record* record = records().load(std::memory_order_acquire);
+				record != NULL; record = record->next) {
+			bool used = false;
+			if (record->in_use.load(std::memory_order_relaxed) == false
+					&& record->in_use.compare_exchange_strong(used, true,
+							std::memory_order_acquire)) {
+				return record;
+			}
+		}
+
+		// Records are never freed, so the unaligned block isn't kept
+		size_t address = reinterpret_cast<size_t>(::operator new(
+				sizeof(Record) + CACHE_LINE));
+		address = (address + CACHE_LINE - 1) & ~(CACHE_LINE - 1);
+		Record* record = new (reinterpret_cast<void*>(address)) Record();
+		Record* head = records().load(std::memory_order_relaxed);
+		do {
+			record->next = head;
+		} while (!records().compare_exchange_weak(head, record,
+				std::memory_order_release, std::memory_order_relaxed));
+		return record;
+	}
+
+	static Record* threadRecord() {
+		static thread_local ThreadSlot slot;
+		if (slot.record == NULL) {
+			slot.record = acquireRecord();
+		}
+		return slot.record;
+	}
+
+	friend class EpochGuard;
+
+public:
+	// Name			: Retire
+	// Description	: Tags memory which was just unlinked. It must be called
+	//					after the unlinking stores.
+	// Parameters	: None
+	// Return Value : the retire epoch of the memory, it may be freed when
+	//					MinActive() is greater than it
+	static uint64_t Retire() {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		return globalEpoch().fetch_add(1, std::memory_order_seq_cst);
+	}
+
+	// Name			: MinActive
+	// Description	: Returns the smallest epoch announced by an active
+	//					reader
+	// Parameters	: None
+	// Return Value : the smallest epoch, NO_READERS if no reader is active
+	static uint64_t MinActive() {
+		uint64_t min = NO_READERS;
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		for (Record* record = records().load(std::memory_order_acquire);
+				record != NULL; record = record->next) {
+			uint64_t epoch = record->epoch.load(std::memory_order_seq_cst);
+			if (epoch != INACTIVE && epoch < min) {
+				min = epoch;
+			}
+		}
+		return min;
+	}
+};
+
+//
+//	Class		: EpochGuard
+//	Description : Marks the calling thread as a reader for the lifetime of
+//					the guard. Memory retired while the guard is held isn't
+//					freed until it's destroyed. Guards may be nested.
+//
+class EpochGuard {
+private:
+	EpochDomain::Record* record;
+
+	EpochGuard(const EpochGuard&);
+	EpochGuard& operator=(const EpochGuard&);
+
+public:
+	EpochGuard() :
+			record(EpochDomain::threadRecord()) {
+		if (record->nesting++ == 0) {
+			record->epoch.store(
+					EpochDomain::globalEpoch().load(std::memory_order_relaxed),
+					std::memory_order_seq_cst);
+			// The announcement must be visible before the reader loads any
+			// node pointer
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+	}
+
+	~EpochGuard() {
+		if (--record->nesting == 0) {
+			record->epoch.store(EpochDomain::INACTIVE,
+					std::memory_order_release);
+		}
+	}
+};
+
+#endif /* EPOCH_HPP_ */
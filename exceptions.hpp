@@ -24,5 +24,17 @@ class HashMapKeyNotFoundException: public HashMapException {
 };
 class HashMapKeyAlreadyExistsException: public HashMapException {
 };
+class HashMapInvalidArgException: public HashMapException {
+};
+
+//-------------------------------------- SNAPSHOT EXCEPTIONS
+class SnapshotException: public std::exception {
+};
+class SnapshotIOException: public SnapshotException {
+};
+class SnapshotFormatException: public SnapshotException {
+};
+class SnapshotKeyNotFoundException: public SnapshotException {
+};
 
 #endif /* EXCEPTIONS_HPP_ */
@@ -0,0 +1,233 @@
+#ifndef EXECUTOR_HPP_
+#define EXECUTOR_HPP_
+
+//
+//	File		: executor.hpp
+//	Description	: ThreadPool, the built-in Executor of the containers
+//					(see parallel_task.hpp). Only the code which creates a
+//					pool includes this header, the containers include the
+//					interface alone.
+//
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "parallel_task.hpp"
+
+//
+//	Class		: ThreadPool
+//	Description : Executor with a fixed set of worker threads. The calling
+//					thread runs chunks too, so a pool of one thread never
+//					starts a worker. ParallelFor calls from different
+//					threads run one after the other, and a ParallelFor
+//					called from a chunk of the same pool runs serially.
+//
+class ThreadPool: public Executor {
+private:
+	//
+	//	Struct		: Job
+	//	Description : The task being run. Workers take chunks by advancing
+	//					next, and active counts the workers which haven't
+	//					left the job yet.
+	//
+	struct Job {
+		ParallelTask* task;
+		int count;
+		int grain;
+		std::atomic<int> next;
+		std::atomic<bool> failed;
+		std::exception_ptr error;
+		int active;
+	};
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	// ParallelFor callers wait here for the pool
+	std::mutex caller_mutex;
+	Job* job;
+	unsigned long generation;
+	bool stopping;
+
+	ThreadPool(const ThreadPool&);
+	ThreadPool& operator=(const ThreadPool&);
+
+	static const ThreadPool*& currentPool() {
+		static thread_local const ThreadPool* pool = NULL;
+		return pool;
+	}
+
+	//
+	//	Struct		: PoolScope
+	//	Description : Marks the calling thread as running chunks of a pool
+	//					while it's alive, so a ParallelFor called from one of
+	//					those chunks runs serially instead of waiting for the
+	//					pool. The previous pool is restored on exit.
+	//
+	struct PoolScope {
+		const ThreadPool* previous;
+
+		explicit PoolScope(const ThreadPool* pool) :
+				previous(currentPool()) {
+			currentPool() = pool;
+		}
+
+		~PoolScope() {
+			currentPool() = previous;
+		}
+	};
+
+	// Name			: runChunks
+	// Description	: Takes chunks of the job and runs them, until the range
+	//					is exhausted or a chunk failed.
+	// Parameters	:
+	//	@current - the job
+	// Return Value : None
+	void runChunks(Job* current) {
+		while (current->failed.load(std::memory_order_relaxed) == false) {
+			int first = current->next.fetch_add(current->grain,
+					std::memory_order_relaxed);
+			if (first >= current->count) {
+				return;
+			}
+
+			int last = (current->count - first > current->grain) ?
+					first + current->grain : current->count;
+			try {
+				current->task->Run(first, last);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (current->failed.load(std::memory_order_relaxed) == false) {
+					current->error = std::current_exception();
+					current->failed.store(true, std::memory_order_relaxed);
+				}
+			}
+		}
+	}
+
+	void workerLoop() {
+		unsigned long seen = 0;
+
+		currentPool() = this;
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;) {
+			while (stopping == false && generation == seen) {
+				wake.wait(lock);
+			}
+			if (stopping == true) {
+				return;
+			}
+
+			seen = generation;
+			Job* current = job;
+			lock.unlock();
+			runChunks(current);
+			lock.lock();
+			if (--current->active == 0) {
+				done.notify_all();
+			}
+		}
+	}
+
+	void shutdown() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+
+		for (size_t i = 0; i < workers.size(); i++) {
+			workers[i].join();
+		}
+		workers.clear();
+	}
+
+public:
+	// ThreadPool constructor
+	//	@threads - the number of threads which run the chunks, the caller
+	//				included. Zero uses the number of hardware threads.
+	explicit ThreadPool(int threads = 0) :
+			job(NULL), generation(0), stopping(false) {
+		if (threads <= 0) {
+			threads = (int) std::thread::hardware_concurrency();
+		}
+
+		try {
+			for (int i = 1; i < threads; i++) {
+				workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+			}
+		} catch (...) {
+			shutdown();
+			throw;
+		}
+	}
+
+	// ThreadPool destructor, waits for the workers to exit
+	~ThreadPool() {
+		shutdown();
+	}
+
+	int getConcurrency() const {
+		return (int) workers.size() + 1;
+	}
+
+	// Name			: ParallelFor
+	// Description	: Runs the task over [0, count), in chunks of at most
+	//					@grain indices, on the workers and the calling thread.
+	// Parameters	:
+	//	@task	- the task
+	//	@count	- the size of the range
+	//	@grain	- the maximal chunk size, at least 1
+	// Return Value : None
+	void ParallelFor(ParallelTask& task, int count, int grain) {
+		if (count <= 0) {
+			return;
+		}
+		if (grain < 1) {
+			grain = 1;
+		}
+
+		if (workers.empty() || count <= grain || currentPool() == this) {
+			task.Run(0, count);
+			return;
+		}
+
+		std::lock_guard<std::mutex> caller_lock(caller_mutex);
+		Job current;
+		current.task = &task;
+		current.count = count;
+		current.grain = grain;
+		current.next.store(0, std::memory_order_relaxed);
+		current.failed.store(false, std::memory_order_relaxed);
+		current.active = (int) workers.size();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = &current;
+			generation++;
+		}
+		wake.notify_all();
+
+		{
+			PoolScope scope(this);
+			runChunks(&current);
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		while (current.active != 0) {
+			done.wait(lock);
+		}
+		job = NULL;
+		lock.unlock();
+
+		if (current.failed.load(std::memory_order_relaxed) == true) {
+			std::rethrow_exception(current.error);
+		}
+	}
+};
+
+#endif /* EXECUTOR_HPP_ */
@@ -0,0 +1,1448 @@
+#ifndef FLAT_HASH_MAP_HPP_
+#define FLAT_HASH_MAP_HPP_
+
+//
+//	File		: flat_hash_map.hpp
+//	Description	: Open-addressing storage engine for HashMap
+//					(HashMap<V, K, FlatStorage>). Keys and values are kept
+//					inline in a single slot array, and every slot owns one
+//					control byte in a separate metadata array, so a lookup
+//					touches the metadata group and then the slot itself.
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#include "hash_map.hpp"
+#include "exceptions.hpp"
+#include "parallel_task.hpp"
+#include "simd.hpp"
+
+//
+//	Class		: FlatGroup
+//	Description : A group of consecutive control bytes which is probed as
+//					a whole. A control byte is either EMPTY, DELETED or
+//					holds the 7 low bits of the hash of the slot's key.
+//
+class FlatGroup {
+private:
+	const signed char* ctrl;
+
+public:
+	//
+	// Constants
+	//
+	static const int WIDTH = SimdBytes::WIDTH;
+	static const signed char EMPTY = -128;
+	static const signed char DELETED = -2;
+
+	explicit FlatGroup(const signed char* ctrl) :
+			ctrl(ctrl) {
+	}
+
+	// Name			: Match
+	// Description	: Finds the slots of the group which might hold a key
+	//					with the given hash tag. The whole group is compared
+	//					at once (see simd.hpp).
+	// Parameters	:
+	//	@h2 - the 7 bit hash tag to look for
+	// Return Value : bit mask, bit i is set if slot i matches
+	uint32_t Match(signed char h2) const {
+		return SimdBytes::MatchEqual(ctrl, h2);
+	}
+
+	// Name			: MatchEmpty
+	// Description	: Finds the empty slots of the group.
+	// Parameters	: None
+	// Return Value : bit mask, bit i is set if slot i is empty
+	uint32_t MatchEmpty() const {
+		return SimdBytes::MatchEqual(ctrl, EMPTY);
+	}
+
+	// Name			: MatchEmptyOrDeleted
+	// Description	: Finds the slots of the group which can take a new key.
+	// Parameters	: None
+	// Return Value : bit mask, bit i is set if slot i is empty or deleted
+	uint32_t MatchEmptyOrDeleted() const {
+		return SimdBytes::MatchNegative(ctrl);
+	}
+
+	// Name			: LowestBit
+	// Description	: Returns the index of the lowest set bit of a match mask
+	// Parameters	:
+	//	@mask - non zero match mask
+	// Return Value : index of the lowest set bit
+	static int LowestBit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_ctz(mask);
+#else
+		int index = 0;
+		while ((mask & 1u) == 0) {
+			mask >>= 1;
+			index++;
+		}
+		return index;
+#endif
+	}
+};
+
+template<typename V, class K, class Hash, class Allocator, class Stats> class HashMap<
+		V, K, FlatStorage, Hash, Allocator, Stats> : private Stats {
+	//
+	//	Class		: HashMap (FlatStorage)
+	//	Description : Implementation of hash map, which uses open
+	//					addressing. The table is split into groups of
+	//					FlatGroup::WIDTH slots, and the groups are probed
+	//					quadratically. References returned by Insert/Find
+	//					stay valid until the table is resized.
+	//					With an executor (SetExecutor) the destructor and
+	//					ParallelForEach split the slots between threads.
+	//					The search histogram of the statistics policy
+	//					counts the groups read by every probe.
+	//
+
+private:
+	//
+	//	Struct		: Slot
+	//	Description : Inline storage of one key-value mapping
+	//
+	struct Slot {
+		K key;
+		V value;
+
+		template<class KeyArg, class ... Args>
+		Slot(KeyArg&& key, Args&&... args) :
+				key(std::forward<KeyArg>(key)), value(
+						std::forward<Args>(args)...) {
+		}
+	};
+
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<
+			Slot> SlotAllocator;
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<
+			signed char> CtrlAllocator;
+	typedef std::allocator_traits<SlotAllocator> SlotAllocatorTraits;
+	typedef std::allocator_traits<CtrlAllocator> CtrlAllocatorTraits;
+
+	//
+	// Constants
+	//
+	static const int EMPTY_TABLE = 0;
+	static const size_t INITIAL_CAPACITY = 16;
+	static const int INCREASE_FACTOR = 2;
+	static const int DECREASE_FACTOR = 2;
+	static constexpr double DEFAULT_MAX_LOAD = 0.875;
+	static constexpr double DEFAULT_MIN_LOAD = 0.21875;
+	static const size_t HASH_TAG_BITS = 7;
+	static const size_t HASH_TAG_MASK = 0x7F;
+	static const size_t NOT_FOUND = (size_t) -1;
+	// Number of keys whose memory is prefetched together by the batched
+	// operations
+	static const int BATCH_GROUP = 16;
+	// Tables smaller than this aren't split between threads
+	static const size_t PARALLEL_MIN_SLOTS = 1 << 14;
+	// Number of slots per executor chunk
+	static const int PARALLEL_GRAIN = 1 << 12;
+	// Number of hottest groups reported by Diagnostics
+	static const int DEFAULT_TOP_BUCKETS = 8;
+
+	signed char* ctrl;
+	Slot* slots;
+	size_t _capacity;
+	size_t growth_left;
+	int _count;
+	Hash hasher;
+	Allocator alloc;
+	LoadFactorPolicy policy;
+	// The table doesn't shrink under this capacity (see Reserve)
+	size_t min_capacity;
+	// Runs the whole-table operations, serially when NULL
+	Executor* executor;
+
+	// Name			: hashFunction
+	// Description	: This function converts a given key to it's matching
+	//					hashing value. The low bits are used as the slot tag
+	//					and the high bits select the first group to probe.
+	// Parameters	:
+	//	@key 	- key with which result should be associated, or a key-like
+	//				object
+	// Return Value : The hash value associated with the given key
+	template<class Key>
+	size_t hashFunction(const Key& key) const {
+		return (size_t) hasher(key);
+	}
+
+	static signed char hashTag(size_t hash) {
+		return (signed char) (hash & HASH_TAG_MASK);
+	}
+
+	// Name			: maxGrowth
+	// Description	: Returns the number of slots of a table which may be
+	//					used before it must grow. At least one slot stays
+	//					empty, so every probe sequence ends.
+	// Parameters	:
+	//	@capacity - the table capacity
+	// Return Value : the number of usable slots
+	size_t maxGrowth(size_t capacity) const {
+		size_t growth = (size_t) (capacity * policy.getMaxLoad());
+		return (growth < capacity) ? growth : capacity - 1;
+	}
+
+	// Name			: capacityFor
+	// Description	: Computes the smallest capacity which holds the given
+	//					number of mappings without growing.
+	// Parameters	:
+	//	@count - number of mappings
+	// Return Value : the capacity
+	size_t capacityFor(size_t count) const {
+		size_t capacity = INITIAL_CAPACITY;
+		while (maxGrowth(capacity) < count) {
+			capacity *= INCREASE_FACTOR;
+		}
+		return capacity;
+	}
+
+	size_t groupMask() const {
+		return _capacity / FlatGroup::WIDTH - 1;
+	}
+
+	// Name			: findIndex
+	// Description	: Searches the slot which holds the given key.
+	// Parameters	:
+	//	@key	- the key to search, or a key-like object
+	//	@hash	- the hash value of the key
+	// Return Value : The slot index, or NOT_FOUND if the key is not in the map
+	template<class Key>
+	size_t findIndex(const Key& key, size_t hash) const {
+		size_t mask = groupMask();
+		size_t group = (hash >> HASH_TAG_BITS) & mask;
+		signed char tag = hashTag(hash);
+
+		for (size_t probe = 1;; probe++) {
+			size_t base = group * FlatGroup::WIDTH;
+			FlatGroup g(ctrl + base);
+
+			for (uint32_t m = g.Match(tag); m != 0; m &= m - 1) {
+				size_t index = base + FlatGroup::LowestBit(m);
+				if (slots[index].key == key) {
+					Stats::RecordSearch((int) probe);
+					return index;
+				}
+			}
+
+			// A group with an empty slot ends every probe sequence which
+			// reaches it, so the key can't be further away
+			if (g.MatchEmpty() != 0) {
+				Stats::RecordSearch((int) probe);
+				return NOT_FOUND;
+			}
+			group = (group + probe) & mask;
+		}
+	}
+
+	// Name			: probeLength
+	// Description	: Counts the groups a probe of the given hash reads until
+	//					it reaches the given group.
+	// Parameters	:
+	//	@hash	- the hash value of a key
+	//	@target	- a group of the key's probe sequence
+	// Return Value : the number of groups, 1 if the target is the first
+	int probeLength(size_t hash, size_t target) const {
+		size_t mask = groupMask();
+		size_t group = (hash >> HASH_TAG_BITS) & mask;
+		int length = 1;
+
+		for (size_t probe = 1; group != target; probe++) {
+			group = (group + probe) & mask;
+			length++;
+		}
+		return length;
+	}
+
+	// Name			: findInsertIndex
+	// Description	: Finds the first slot in the probe sequence of the given
+	//					hash which can take a new key.
+	// Parameters	:
+	//	@hash	- the hash value of the new key
+	// Return Value : The slot index
+	size_t findInsertIndex(size_t hash) const {
+		size_t mask = groupMask();
+		size_t group = (hash >> HASH_TAG_BITS) & mask;
+
+		for (size_t probe = 1;; probe++) {
+			size_t base = group * FlatGroup::WIDTH;
+			uint32_t m = FlatGroup(ctrl + base).MatchEmptyOrDeleted();
+			if (m != 0) {
+				return base + FlatGroup::LowestBit(m);
+			}
+			group = (group + probe) & mask;
+		}
+	}
+
+	// Name			: findOrPrepareInsert
+	// Description	: Searches the slot which holds the given key. While
+	//					probing, the first slot which can take the key is
+	//					remembered, so a miss doesn't need a second probe.
+	// Parameters	:
+	//	@key	- the key to search
+	//	@hash	- the hash value of the key
+	//	@index	- receives the slot of the key if found, otherwise the slot
+	//				in which it should be inserted
+	// Return Value : true if the key was found
+	bool findOrPrepareInsert(const K& key, size_t hash, size_t* index) const {
+		size_t mask = groupMask();
+		size_t group = (hash >> HASH_TAG_BITS) & mask;
+		signed char tag = hashTag(hash);
+		size_t insert_index = NOT_FOUND;
+
+		for (size_t probe = 1;; probe++) {
+			size_t base = group * FlatGroup::WIDTH;
+			FlatGroup g(ctrl + base);
+
+			for (uint32_t m = g.Match(tag); m != 0; m &= m - 1) {
+				size_t i = base + FlatGroup::LowestBit(m);
+				if (slots[i].key == key) {
+					Stats::RecordSearch((int) probe);
+					*index = i;
+					return true;
+				}
+			}
+
+			if (insert_index == NOT_FOUND) {
+				uint32_t free_mask = g.MatchEmptyOrDeleted();
+				if (free_mask != 0) {
+					insert_index = base + FlatGroup::LowestBit(free_mask);
+				}
+			}
+			if (g.MatchEmpty() != 0) {
+				Stats::RecordSearch((int) probe);
+				*index = insert_index;
+				return false;
+			}
+			group = (group + probe) & mask;
+		}
+	}
+
+	// Name			: emplaceSlot
+	// Description	: Inserts the key with a value constructed in place from
+	//					the given arguments, unless the key already exists.
+	//					The table is probed once, unless it has to grow first.
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated,
+	//				moved into the slot if it's an rvalue
+	//	@args 	- the arguments of the value constructor
+	// Return Value : A pair of the slot index of the key, and whether the
+	//					key was inserted by this call
+	template<class Key, class ... Args>
+	std::pair<size_t, bool> emplaceSlot(Key&& key, Args&&... args) {
+		return emplaceHashed(hashFunction(key), std::forward<Key>(key),
+				std::forward<Args>(args)...);
+	}
+
+	// Name			: emplaceHashed
+	// Description	: emplaceSlot, for a key whose hash value is known
+	// Parameters	:
+	//	@hash	- the hash value of the key
+	//	@key 	- key with which the specified value is to be associated
+	//	@args 	- the arguments of the value constructor
+	// Return Value : A pair of the slot index of the key, and whether the
+	//					key was inserted by this call
+	template<class Key, class ... Args>
+	std::pair<size_t, bool> emplaceHashed(size_t hash, Key&& key,
+			Args&&... args) {
+		size_t index;
+
+		bool found = findOrPrepareInsert(key, hash, &index);
+		Stats::RecordInsert(found == false);
+		if (found == true) {
+			return std::pair<size_t, bool>(index, false);
+		}
+
+		if (growth_left == 0 && ctrl[index] == FlatGroup::EMPTY) {
+			growOrPurge();
+			index = findInsertIndex(hash);
+		}
+
+		new (&slots[index]) Slot(std::forward<Key>(key),
+				std::forward<Args>(args)...);
+		if (ctrl[index] == FlatGroup::EMPTY) {
+			growth_left--;
+		}
+		ctrl[index] = hashTag(hash);
+		_count++;
+
+		return std::pair<size_t, bool>(index, true);
+	}
+
+	// Name			: allocateTable
+	// Description	: Allocates a new table with all slots empty.
+	// Parameters	:
+	//	@capacity - number of slots, a power of two multiple of the group
+	//				width
+	// Return Value : None
+	// If memory allocation failes, a matching exception would be thrown by
+	//	the system.
+	void allocateTable(size_t capacity) {
+		CtrlAllocator ctrl_alloc(alloc);
+		SlotAllocator slot_alloc(alloc);
+		signed char* new_ctrl = CtrlAllocatorTraits::allocate(ctrl_alloc,
+				capacity);
+		Slot* new_slots;
+		try {
+			new_slots = SlotAllocatorTraits::allocate(slot_alloc, capacity);
+		} catch (...) {
+			CtrlAllocatorTraits::deallocate(ctrl_alloc, new_ctrl, capacity);
+			throw;
+		}
+
+		Stats::RecordMemory(0,
+				(long long) capacity * (long long) (sizeof(Slot) + 1));
+		ctrl = new_ctrl;
+		slots = new_slots;
+		_capacity = capacity;
+		growth_left = maxGrowth(capacity);
+
+		for (size_t i = 0; i < capacity; i++) {
+			ctrl[i] = FlatGroup::EMPTY;
+		}
+	}
+
+	// Name			: freeTable
+	// Description	: Frees the memory of a table. The slots must be
+	//					destructed already.
+	// Parameters	:
+	//	@table_ctrl		- the control array
+	//	@table_slots	- the slot array
+	//	@capacity		- number of slots
+	// Return Value : None
+	void freeTable(signed char* table_ctrl, Slot* table_slots,
+			size_t capacity) {
+		CtrlAllocator ctrl_alloc(alloc);
+		SlotAllocator slot_alloc(alloc);
+
+		CtrlAllocatorTraits::deallocate(ctrl_alloc, table_ctrl, capacity);
+		SlotAllocatorTraits::deallocate(slot_alloc, table_slots, capacity);
+		Stats::RecordMemory(0,
+				-(long long) capacity * (long long) (sizeof(Slot) + 1));
+	}
+
+	// Name			: Resize
+	// Description	: This function moves all the mappings to a new table
+	//					with the requested capacity. Deleted slots are
+	//					dropped on the way.
+	// Parameters	:
+	//	@new_capacity - the capacity of the new table
+	// Return Value : None
+	void Resize(size_t new_capacity) {
+		long long start = Stats::Now();
+		signed char* old_ctrl = ctrl;
+		Slot* old_slots = slots;
+		size_t old_capacity = _capacity;
+
+		allocateTable(new_capacity);
+
+		for (size_t i = 0; i < old_capacity; i++) {
+			if (old_ctrl[i] < 0) {
+				continue;
+			}
+			size_t hash = hashFunction(old_slots[i].key);
+			size_t index = findInsertIndex(hash);
+
+			new (&slots[index]) Slot(std::move(old_slots[i].key),
+					std::move(old_slots[i].value));
+			old_slots[i].~Slot();
+			ctrl[index] = hashTag(hash);
+			growth_left--;
+		}
+
+		freeTable(old_ctrl, old_slots, old_capacity);
+		Stats::RecordRehash(Stats::Now() - start);
+	}
+
+	// Name			: growOrPurge
+	// Description	: Called when no empty slot is left for new keys. If
+	//					most of the used slots are deleted ones, the table is
+	//					rebuilt in place, otherwise it grows.
+	// Parameters	: None
+	// Return Value : None
+	void growOrPurge() {
+		if ((size_t) _count <= maxGrowth(_capacity) / 2) {
+			Resize(_capacity);
+		} else {
+			Resize(_capacity * INCREASE_FACTOR);
+		}
+	}
+
+	// Name			: shrinkCheck
+	// Description	: Shrinks the table if the load factor policy says so.
+	//					The table won't be smaller than it's initial (or
+	//					reserved) capacity.
+	// Parameters	: None
+	// Return Value : None
+	void shrinkCheck() {
+		if (_capacity > min_capacity
+				&& policy.ShouldShrink(_count, _capacity)) {
+			Resize(_capacity / DECREASE_FACTOR);
+		}
+	}
+
+	// Name			: shrinkToCount
+	// Description	: Called after many removals. Shrinks the table once,
+	//					straight to the smallest capacity which holds it's
+	//					mappings. A table which keeps it's capacity is
+	//					rebuilt in place if most of it's used slots are
+	//					deleted ones.
+	// Parameters	: None
+	// Return Value : None
+	void shrinkToCount() {
+		if (_capacity > min_capacity
+				&& policy.ShouldShrink(_count, _capacity)) {
+			size_t new_capacity = capacityFor(_count);
+			if (new_capacity < min_capacity) {
+				new_capacity = min_capacity;
+			}
+			if (new_capacity < _capacity) {
+				Resize(new_capacity);
+				return;
+			}
+		}
+
+		size_t deleted = maxGrowth(_capacity) - growth_left - (size_t) _count;
+		if (deleted > (size_t) _count) {
+			Resize(_capacity);
+		}
+	}
+
+	// Name			: eraseSlot
+	// Description	: Destructs the mapping of a used slot, and marks the
+	//					slot empty or deleted.
+	// Parameters	:
+	//	@index - the slot index
+	// Return Value : None
+	void eraseSlot(size_t index) {
+		slots[index].~Slot();
+
+		// If the group still has an empty slot no probe sequence passes
+		// through it, so the slot can become empty again
+		size_t base = index & ~((size_t) FlatGroup::WIDTH - 1);
+		if (FlatGroup(ctrl + base).MatchEmpty() != 0) {
+			ctrl[index] = FlatGroup::EMPTY;
+			growth_left++;
+		} else {
+			ctrl[index] = FlatGroup::DELETED;
+		}
+		_count--;
+	}
+
+	// Name			: lookupKey
+	// Description	: Searches a key, for TryFind
+	// Parameters	:
+	//	@key - the key, or a key-like object
+	// Return Value : Pointer to the element, or NULL if the key wasn't found
+	template<class Key>
+	V* lookupKey(const Key& key) const {
+		size_t index = findIndex(key, hashFunction(key));
+
+		Stats::RecordLookup(index != NOT_FOUND);
+		return (index == NOT_FOUND) ? NULL : &slots[index].value;
+	}
+
+	// Name			: eraseKey
+	// Description	: Removes the mapping of a key, for Erase and Delete
+	// Parameters	:
+	//	@key - the key, or a key-like object
+	// Return Value : true if the mapping was removed, false if the key
+	//					wasn't found
+	template<class Key>
+	bool eraseKey(const Key& key) {
+		size_t index = findIndex(key, hashFunction(key));
+		Stats::RecordErase(index != NOT_FOUND);
+		if (index == NOT_FOUND) {
+			return false;
+		}
+
+		eraseSlot(index);
+		shrinkCheck();
+		return true;
+	}
+
+	// Name			: useExecutor
+	// Description	: Tests if a whole-table operation is worth splitting
+	//					between threads.
+	// Parameters	: None
+	// Return Value : true if the operation should run on the executor
+	bool useExecutor() const {
+		return (executor != NULL && executor->getConcurrency() > 1
+				&& _capacity >= PARALLEL_MIN_SLOTS);
+	}
+
+	//
+	//	Class		: DestructTask
+	//	Description : Destructs the used slots on the executor's threads.
+	//
+	class DestructTask: public ParallelTask {
+	private:
+		HashMap* map;
+
+	public:
+		explicit DestructTask(HashMap* map) :
+				map(map) {
+		}
+
+		void Run(int first, int last) {
+			for (int i = first; i < last; i++) {
+				if (map->ctrl[i] >= 0) {
+					map->slots[i].~Slot();
+				}
+			}
+		}
+	};
+
+	//
+	//	Class		: EraseTask
+	//	Description : Removes the mappings which match a predicate, a group
+	//					per index, on the executor's threads. The counts are
+	//					applied to the map once all the groups were swept.
+	//
+	template<class Predicate>
+	class EraseTask: public ParallelTask {
+	private:
+		HashMap* map;
+		Predicate& predicate;
+		std::atomic<int> removed;
+		std::atomic<size_t> emptied;
+
+	public:
+		EraseTask(HashMap* map, Predicate& predicate) :
+				map(map), predicate(predicate), removed(0), emptied(0) {
+		}
+
+		void Run(int first, int last) {
+			int run_removed = 0;
+			size_t run_emptied = 0;
+
+			try {
+				for (int group = first; group < last; group++) {
+					sweepGroup((size_t) group * FlatGroup::WIDTH, &run_removed,
+							&run_emptied);
+				}
+			} catch (...) {
+				removed.fetch_add(run_removed, std::memory_order_relaxed);
+				emptied.fetch_add(run_emptied, std::memory_order_relaxed);
+				throw;
+			}
+			removed.fetch_add(run_removed, std::memory_order_relaxed);
+			emptied.fetch_add(run_emptied, std::memory_order_relaxed);
+		}
+
+		// Name			: sweepGroup
+		// Description	: Removes the matching mappings of a group, and turns
+		//					it's deleted slots empty if it has an empty one.
+		//					The counts are kept up slot by slot, so they're
+		//					right if the predicate throws.
+		// Parameters	:
+		//	@base			- the index of the first slot of the group
+		//	@run_removed	- incremented for every removed mapping
+		//	@run_emptied	- incremented for every slot which became empty
+		// Return Value : None
+		void sweepGroup(size_t base, int* run_removed, size_t* run_emptied) {
+			for (int i = 0; i < FlatGroup::WIDTH; i++) {
+				if (map->ctrl[base + i] >= 0
+						&& predicate((const K&) map->slots[base + i].key,
+								map->slots[base + i].value) == true) {
+					map->slots[base + i].~Slot();
+					map->ctrl[base + i] = FlatGroup::DELETED;
+					(*run_removed)++;
+				}
+			}
+			if (FlatGroup(map->ctrl + base).MatchEmpty() != 0) {
+				for (int i = 0; i < FlatGroup::WIDTH; i++) {
+					if (map->ctrl[base + i] == FlatGroup::DELETED) {
+						map->ctrl[base + i] = FlatGroup::EMPTY;
+						(*run_emptied)++;
+					}
+				}
+			}
+		}
+
+		// Name			: Apply
+		// Description	: Subtracts the removed mappings from the map, and
+		//					adds the slots which became empty to it's growth.
+		// Parameters	: None
+		// Return Value : the number of removed mappings
+		int Apply() {
+			int res = removed.exchange(0, std::memory_order_relaxed);
+
+			map->_count -= res;
+			map->growth_left += emptied.exchange(0, std::memory_order_relaxed);
+			return res;
+		}
+	};
+
+	//
+	//	Class		: VisitTask
+	//	Description : Visits the used slots on the executor's threads.
+	//
+	template<class Visitor>
+	class VisitTask: public ParallelTask {
+	private:
+		HashMap* map;
+		Visitor& visitor;
+
+	public:
+		VisitTask(HashMap* map, Visitor& visitor) :
+				map(map), visitor(visitor) {
+		}
+
+		void Run(int first, int last) {
+			for (int i = first; i < last; i++) {
+				if (map->ctrl[i] >= 0) {
+					visitor((const K&) map->slots[i].key, map->slots[i].value);
+				}
+			}
+		}
+	};
+
+	//
+	//	Class		: ValueOutput / FlagOutput
+	//	Description : Result sinks of lookupBatch, the first stores the
+	//					elements and the second whether they were found.
+	//
+	struct ValueOutput {
+		V** out;
+
+		void operator()(int index, V* value) const {
+			out[index] = value;
+		}
+	};
+
+	struct FlagOutput {
+		bool* out;
+
+		void operator()(int index, V* value) const {
+			out[index] = (value != NULL);
+		}
+	};
+
+	// Name			: prefetchGroup
+	// Description	: Hashes a group of keys and prefetches the first group
+	//					of control bytes each key probes. Once they were all
+	//					requested, the bytes are matched against the hash
+	//					tags, and the first candidate slot of every key is
+	//					prefetched too. The misses of the group overlap.
+	// Parameters	:
+	//	@keys	- the keys of the group
+	//	@count	- number of keys, up to BATCH_GROUP
+	//	@hashes	- receives the hash values of the keys
+	// Return Value : None
+	void prefetchGroup(const K* keys, int count, size_t* hashes) const {
+		size_t mask = groupMask();
+
+		for (int i = 0; i < count; i++) {
+			hashes[i] = hashFunction(keys[i]);
+			PrefetchRead(
+					ctrl + ((hashes[i] >> HASH_TAG_BITS) & mask)
+							* FlatGroup::WIDTH);
+		}
+		for (int i = 0; i < count; i++) {
+			size_t base = ((hashes[i] >> HASH_TAG_BITS) & mask)
+					* FlatGroup::WIDTH;
+			uint32_t m = FlatGroup(ctrl + base).Match(hashTag(hashes[i]));
+			if (m != 0) {
+				PrefetchRead(&slots[base + FlatGroup::LowestBit(m)]);
+			}
+		}
+	}
+
+	// Name			: lookupBatch
+	// Description	: Searches many keys, a prefetched group at a time.
+	// Parameters	:
+	//	@keys	- the keys to search
+	//	@count	- number of keys
+	//	@output	- callable, invoked as output(index, value) for every key,
+	//				with NULL for the missing keys
+	// Return Value : the number of keys found
+	template<class Output>
+	int lookupBatch(const K* keys, int count, Output output) const {
+		size_t hashes[BATCH_GROUP];
+		int found = 0;
+
+		for (int first = 0; first < count; first += BATCH_GROUP) {
+			int group = (count - first < BATCH_GROUP) ?
+					count - first : BATCH_GROUP;
+
+			prefetchGroup(keys + first, group, hashes);
+			for (int i = 0; i < group; i++) {
+				size_t index = findIndex(keys[first + i], hashes[i]);
+				Stats::RecordLookup(index != NOT_FOUND);
+				if (index == NOT_FOUND) {
+					output(first + i, (V*) NULL);
+				} else {
+					found++;
+					output(first + i, &slots[index].value);
+				}
+			}
+		}
+		return found;
+	}
+
+	HashMap(const HashMap&);
+	HashMap& operator=(const HashMap&);
+
+public:
+
+	// HashMap contstructor
+	explicit HashMap(const Hash& hash = Hash(), const Allocator& allocator =
+			Allocator()) :
+			ctrl(NULL), slots(NULL), _capacity(0), growth_left(0), _count(
+					EMPTY_TABLE), hasher(hash), alloc(allocator), policy(
+					DEFAULT_MAX_LOAD, DEFAULT_MIN_LOAD), min_capacity(
+					INITIAL_CAPACITY), executor(NULL) {
+		allocateTable(INITIAL_CAPACITY);
+	}
+
+	// Name			: SetExecutor
+	// Description	: Sets the executor which splits the whole-table
+	//					operations of a large map between threads: the
+	//					destructor and ParallelForEach. The operations of
+	//					the map still must not run concurrently.
+	// Parameters	:
+	//	@new_executor - the executor, it must outlive it's use by the map.
+	//					NULL runs everything on the calling thread.
+	// Return Value : None
+	void SetExecutor(Executor* new_executor) {
+		executor = new_executor;
+	}
+
+	// Name			: SetLoadFactorPolicy
+	// Description	: Replaces the thresholds which decide when the map grows
+	//					and shrinks. The table is rebuilt for the new policy.
+	// Parameters	:
+	//	@new_policy - the new policy
+	// Return Value : None
+	// 	If the policy could make the map grow and shrink back to back, or
+	// leaves no empty slots (maximal load of 1 or more),
+	// HashMapInvalidArgException will be thrown.
+	void SetLoadFactorPolicy(const LoadFactorPolicy& new_policy) {
+		if (new_policy.isValid(INCREASE_FACTOR) == false
+				|| new_policy.getMaxLoad() >= 1) {
+			throw HashMapInvalidArgException();
+		}
+
+		policy = new_policy;
+		size_t new_capacity = capacityFor(_count);
+		if (new_capacity < min_capacity) {
+			new_capacity = min_capacity;
+		}
+		Resize(new_capacity);
+	}
+
+	// Name			: Reserve
+	// Description	: Resizes the map at once to hold the given number of
+	//					mappings without further growing, and keeps it from
+	//					shrinking under that size until ShrinkToFit is called.
+	// Parameters	:
+	//	@count - the expected number of mappings
+	// Return Value : None
+	// 	If the count is negative, HashMapInvalidArgException will be thrown.
+	void Reserve(int count) {
+		if (count < 0) {
+			throw HashMapInvalidArgException();
+		}
+
+		size_t new_capacity = capacityFor(count);
+		if (new_capacity > min_capacity) {
+			min_capacity = new_capacity;
+		}
+		if (new_capacity > _capacity) {
+			Resize(new_capacity);
+		}
+	}
+
+	// Name			: ShrinkToFit
+	// Description	: Resizes the map at once to the smallest size which holds
+	//					it's mappings, and cancels the effect of Reserve.
+	// Parameters	: None
+	// Return Value : None
+	void ShrinkToFit() {
+		min_capacity = INITIAL_CAPACITY;
+
+		size_t new_capacity = capacityFor(_count);
+		if (new_capacity < _capacity) {
+			Resize(new_capacity);
+		}
+	}
+
+	// Name			: BulkLoad
+	// Description	: Inserts many mappings at once. The table is resized
+	//					once up front, and the values are moved into it.
+	// Parameters	:
+	//	@keys	- the keys
+	//	@values	- the values, in the order of the keys
+	//	@count	- number of mappings
+	// Return Value : None
+	// 	If the count is negative, HashMapInvalidArgException will be thrown.
+	// If a key already exists, HashMapKeyAlreadyExistsException will be
+	// thrown, and the mappings before it stay in the map.
+	void BulkLoad(const K* keys, V* values, int count) {
+		if (count < 0 || (count > 0 && (keys == NULL || values == NULL))) {
+			throw HashMapInvalidArgException();
+		}
+
+		size_t new_capacity = capacityFor(_count + count);
+		if (new_capacity > _capacity) {
+			Resize(new_capacity);
+		}
+
+		for (int i = 0; i < count; i++) {
+			if (emplaceSlot(keys[i], std::move(values[i])).second == false) {
+				Stats::RecordException();
+				throw HashMapKeyAlreadyExistsException();
+			}
+		}
+	}
+
+	// Name			: Insert
+	// Description	: This function inserts an element to the map
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@data 	-  value to be associated with the specified key
+	// Return Value : Reference to the inserted object
+	// 	If the key already exist, HashMapKeyAlreadyExistsException will be
+	// thrown.
+	V* Insert(K key, const V& obj) {
+		return Emplace(std::move(key), obj);
+	}
+
+	// Name			: Insert
+	// Description	: This function inserts an element to the map, and moves
+	//					the given object into it
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@data 	-  value to be associated with the specified key
+	// Return Value : Reference to the inserted object
+	// 	If the key already exist, HashMapKeyAlreadyExistsException will be
+	// thrown.
+	V* Insert(K key, V&& obj) {
+		return Emplace(std::move(key), std::move(obj));
+	}
+
+	// Name			: Emplace
+	// Description	: Inserts an element to the map, which is constructed in
+	//					place from the given arguments.
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@args 	- the arguments of the value constructor
+	// Return Value : Reference to the inserted object
+	// 	If the key already exist, HashMapKeyAlreadyExistsException will be
+	// thrown.
+	template<class ... Args>
+	V* Emplace(K key, Args&&... args) {
+		std::pair<size_t, bool> res = emplaceSlot(std::move(key),
+				std::forward<Args>(args)...);
+		if (res.second == false) {
+			Stats::RecordException();
+			throw HashMapKeyAlreadyExistsException();
+		}
+
+		return &slots[res.first].value;
+	}
+
+	// Name			: InsertOrAssign
+	// Description	: Inserts an element to the map, or assigns the given
+	//					object to the existing element with the same key.
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@obj 	- value to be associated with the specified key, copied or
+	//				moved
+	// Return Value : true if the element was inserted, false if assigned
+	template<class Value>
+	bool InsertOrAssign(K key, Value&& obj) {
+		std::pair<size_t, bool> res = emplaceSlot(std::move(key),
+				std::forward<Value>(obj));
+		if (res.second == false) {
+			slots[res.first].value = std::forward<Value>(obj);
+		}
+
+		return res.second;
+	}
+
+	// Name			: TryEmplace
+	// Description	: Inserts an element to the map if the key doesn't exist.
+	//					Otherwise the map isn't changed, and the arguments
+	//					aren't used.
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@args 	- the arguments of the value constructor
+	// Return Value : A pair of a pointer to the element with the given key,
+	//					and whether it was inserted by this call
+	template<class ... Args>
+	std::pair<V*, bool> TryEmplace(K key, Args&&... args) {
+		std::pair<size_t, bool> res = emplaceSlot(std::move(key),
+				std::forward<Args>(args)...);
+
+		return std::pair<V*, bool>(&slots[res.first].value, res.second);
+	}
+
+	// Name			: Delete
+	// Description	: Removes the mapping for the specified key from this map if present.
+	// Parameters	:
+	//	@key - key whose mapping is to be removed from the map
+	// Return Value : None, if the key wasn't found a suitable exception will
+	// be thrown (HashMapKeyNotFoundException).
+	void Delete(const K & key) {
+		if (eraseKey(key) == false) {
+			Stats::RecordException();
+			throw HashMapKeyNotFoundException();
+		}
+	}
+
+	// Name			: Delete
+	// Description	: Delete, by a key-like object (see IsHashKeyLike)
+	// Parameters	:
+	//	@key - compares equal to the key whose mapping is to be removed
+	// Return Value : None, if the key wasn't found a suitable exception will
+	// be thrown (HashMapKeyNotFoundException).
+	template<class Key>
+	typename std::enable_if<IsHashKeyLike<Hash, K, Key>::value>::type Delete(
+			const Key& key) {
+		if (eraseKey(key) == false) {
+			Stats::RecordException();
+			throw HashMapKeyNotFoundException();
+		}
+	}
+
+	// Name			: Erase
+	// Description	: Removes the mapping for the specified key from this map
+	//					if present.
+	// Parameters	:
+	//	@key - key whose mapping is to be removed from the map
+	// Return Value : true if the mapping was removed, false if the key
+	//					wasn't found
+	bool Erase(const K & key) {
+		return eraseKey(key);
+	}
+
+	// Name			: Erase
+	// Description	: Erase, by a key-like object (see IsHashKeyLike)
+	// Parameters	:
+	//	@key - compares equal to the key whose mapping is to be removed
+	// Return Value : true if the mapping was removed, false if the key
+	//					wasn't found
+	template<class Key>
+	typename std::enable_if<IsHashKeyLike<Hash, K, Key>::value, bool>::type Erase(
+			const Key& key) {
+		return eraseKey(key);
+	}
+
+	// Name			: EraseIf
+	// Description	: Removes all the mappings which match a predicate, in
+	//					one sweep over the groups. The matching slots are
+	//					marked deleted, and a group which still has an empty
+	//					slot turns all it's deleted slots empty again. The
+	//					table is resized once at the end, if it should shrink
+	//					or if most of it's used slots are still deleted.
+	//					With an executor the groups of a large map are swept
+	//					by it's threads.
+	// Parameters	:
+	//	@predicate - callable, invoked as predicate(key, value) for each
+	//				mapping, returns true for the mappings to remove. On the
+	//				executor it's shared by the threads, and must be safe to
+	//				call concurrently.
+	// Return Value : the number of removed mappings
+	//	If the predicate throws, the mappings it wasn't called for stay in
+	// the map, and the exception is rethrown.
+	template<class Predicate>
+	int EraseIf(Predicate predicate) {
+		int groups = (int) (_capacity / FlatGroup::WIDTH);
+		EraseTask<Predicate> task(this, predicate);
+
+		try {
+			if (useExecutor()) {
+				executor->ParallelFor(task, groups,
+						PARALLEL_GRAIN / FlatGroup::WIDTH);
+			} else {
+				task.Run(0, groups);
+			}
+		} catch (...) {
+			task.Apply();
+			throw;
+		}
+
+		int removed = task.Apply();
+		for (int i = 0; i < removed; i++) {
+			Stats::RecordErase(true);
+		}
+
+		shrinkToCount();
+		return removed;
+	}
+
+	// Name			: DeleteBatch
+	// Description	: Removes the mappings of many keys at once. The control
+	//					bytes of every group of keys are prefetched before
+	//					they're probed, as in FindBatch, and the table is
+	//					resized once at the end instead of after every
+	//					removal.
+	// Parameters	:
+	//	@keys	- the keys to remove, the missing ones are skipped
+	//	@count	- number of keys
+	//	@erased	- optional, receives true for every key which was removed
+	// Return Value : the number of removed mappings
+	// 	If the count is negative, HashMapInvalidArgException will be thrown.
+	int DeleteBatch(const K* keys, int count, bool* erased = NULL) {
+		if (count < 0 || (count > 0 && keys == NULL)) {
+			throw HashMapInvalidArgException();
+		}
+
+		size_t hashes[BATCH_GROUP];
+		int res = 0;
+
+		for (int first = 0; first < count; first += BATCH_GROUP) {
+			int group = (count - first < BATCH_GROUP) ?
+					count - first : BATCH_GROUP;
+
+			prefetchGroup(keys + first, group, hashes);
+			for (int i = 0; i < group; i++) {
+				size_t index = findIndex(keys[first + i], hashes[i]);
+
+				Stats::RecordErase(index != NOT_FOUND);
+				if (index != NOT_FOUND) {
+					eraseSlot(index);
+					res++;
+				}
+				if (erased != NULL) {
+					erased[first + i] = (index != NOT_FOUND);
+				}
+			}
+		}
+
+		shrinkToCount();
+		return res;
+	}
+
+	// Name			: Find
+	// Description	: Finds an element with key equivalent to key.
+	// Parameters	:
+	//	key - key value of the element to search for
+	// Return Value : Reference to an element with key equivalent to key.
+	//					If no such element is found, an exception would be
+	// 					thrown.
+	V& Find(const K& key) const {
+		V* value = TryFind(key);
+		if (value == NULL) {
+			Stats::RecordException();
+			throw HashMapKeyNotFoundException();
+		}
+
+		return *value;
+	}
+
+	// Name			: Find
+	// Description	: Find, by a key-like object (see IsHashKeyLike), which
+	//					is hashed and compared without constructing a key.
+	// Parameters	:
+	//	key - compares equal to the key of the element to search for
+	// Return Value : Reference to the element, if no such element is found
+	//					an exception would be thrown.
+	template<class Key>
+	typename std::enable_if<IsHashKeyLike<Hash, K, Key>::value, V&>::type Find(
+			const Key& key) const {
+		V* value = TryFind(key);
+		if (value == NULL) {
+			Stats::RecordException();
+			throw HashMapKeyNotFoundException();
+		}
+
+		return *value;
+	}
+
+	// Name			: TryFind
+	// Description	: Finds an element with key equivalent to key, without
+	//					throwing on a miss.
+	// Parameters	:
+	//	key - key value of the element to search for
+	// Return Value : Pointer to the element with key equivalent to key, or
+	//					NULL if no such element is found.
+	V* TryFind(const K& key) const {
+		return lookupKey(key);
+	}
+
+	// Name			: TryFind
+	// Description	: TryFind, by a key-like object (see IsHashKeyLike)
+	// Parameters	:
+	//	key - compares equal to the key of the element to search for
+	// Return Value : Pointer to the element, or NULL if no such element is
+	//					found.
+	template<class Key>
+	typename std::enable_if<IsHashKeyLike<Hash, K, Key>::value, V*>::type TryFind(
+			const Key& key) const {
+		return lookupKey(key);
+	}
+
+	// Name			: FindBatch
+	// Description	: Finds the elements of many keys at once. The keys are
+	//					taken in groups, and the control bytes and candidate
+	//					slots of a whole group are prefetched before it's
+	//					searched, so the cache misses of a group overlap.
+	// Parameters	:
+	//	@keys	- the keys to search
+	//	@count	- number of keys
+	//	@out	- receives a pointer to the element of every key, or NULL
+	//				if it's not in the map
+	// Return Value : the number of keys found
+	// 	If the count is negative, HashMapInvalidArgException will be thrown.
+	int FindBatch(const K* keys, int count, V** out) const {
+		if (count < 0 || (count > 0 && (keys == NULL || out == NULL))) {
+			throw HashMapInvalidArgException();
+		}
+
+		ValueOutput output = { out };
+		return lookupBatch(keys, count, output);
+	}
+
+	// Name			: ContainsBatch
+	// Description	: Tests many keys at once, the way FindBatch searches
+	//					them.
+	// Parameters	:
+	//	@keys	- the keys to test
+	//	@count	- number of keys
+	//	@out	- receives true for every key which is in the map
+	// Return Value : the number of keys found
+	// 	If the count is negative, HashMapInvalidArgException will be thrown.
+	int ContainsBatch(const K* keys, int count, bool* out) const {
+		if (count < 0 || (count > 0 && (keys == NULL || out == NULL))) {
+			throw HashMapInvalidArgException();
+		}
+
+		FlagOutput output = { out };
+		return lookupBatch(keys, count, output);
+	}
+
+	// Name			: InsertBatch
+	// Description	: Inserts many mappings at once, skipping the keys which
+	//					already exist. The table grows once up front, and
+	//					the probe groups of every group of keys are
+	//					prefetched before they're inserted.
+	// Parameters	:
+	//	@keys		- the keys
+	//	@values		- the values, in the order of the keys, copied
+	//	@count		- number of mappings
+	//	@inserted	- optional, receives true for every key which was
+	//					inserted and false for the existing ones
+	// Return Value : the number of inserted mappings
+	// 	If the count is negative, HashMapInvalidArgException will be thrown.
+	// If memory allocation failes, the mappings before the failed one stay
+	// in the map.
+	int InsertBatch(const K* keys, const V* values, int count,
+			bool* inserted = NULL) {
+		if (count < 0 || (count > 0 && (keys == NULL || values == NULL))) {
+			throw HashMapInvalidArgException();
+		}
+
+		size_t new_capacity = capacityFor(_count + count);
+		if (new_capacity > _capacity) {
+			Resize(new_capacity);
+		}
+
+		size_t hashes[BATCH_GROUP];
+		int res = 0;
+
+		for (int first = 0; first < count; first += BATCH_GROUP) {
+			int group = (count - first < BATCH_GROUP) ?
+					count - first : BATCH_GROUP;
+
+			prefetchGroup(keys + first, group, hashes);
+			for (int i = 0; i < group; i++) {
+				bool added = emplaceHashed(hashes[i], keys[first + i],
+						values[first + i]).second;
+				if (added == true) {
+					res++;
+				}
+				if (inserted != NULL) {
+					inserted[first + i] = added;
+				}
+			}
+		}
+		return res;
+	}
+
+	// Name			: InsertRange
+	// Description	: Inserts the mappings of a range, skipping the keys
+	//					which already exist, and the repeated keys of the
+	//					range after their first mapping. The range is read
+	//					once, so it may be a stream. The table is resized
+	//					once up front, and the mappings are inserted the way
+	//					InsertBatch inserts them.
+	// Parameters	:
+	//	@first	- the first mapping, a pair-like object with first (the
+	//				key) and second (the value)
+	//	@last	- the end of the range
+	// Return Value : the number of inserted mappings
+	// If memory allocation failes, the mappings before the failed one stay
+	// in the map.
+	template<class InputIterator>
+	int InsertRange(InputIterator first, InputIterator last) {
+		std::vector<K> keys;
+		std::vector<V> values;
+		size_t length = RangeLengthHint(first, last);
+
+		keys.reserve(length);
+		values.reserve(length);
+		for (; first != last; ++first) {
+			keys.push_back(first->first);
+			values.push_back(first->second);
+		}
+		if (keys.empty()) {
+			return 0;
+		}
+		return InsertBatch(&keys[0], &values[0], (int) keys.size());
+	}
+
+	// Name			: isEmpty
+	// Description	: This function tests whether the map is empty or not.
+	// Parameters	: None
+	// Return Value : true if this map contains no key-value mappings
+	bool Empty() const {
+		return (EMPTY_TABLE == _count);
+	}
+
+	// Name			: Contains
+	// Description	: Tests if this map contains a mapping for the specified key.
+	// Parameters	:
+	//	key - The key whose presence in this map is to be tested
+	// Return Value : true if this map contains a mapping for the specified key
+	bool Contains(const K& key) const {
+		return (TryFind(key) != NULL);
+	}
+
+	// Name			: Contains
+	// Description	: Contains, by a key-like object (see IsHashKeyLike)
+	// Parameters	:
+	//	key - compares equal to the key whose presence is to be tested
+	// Return Value : true if this map contains a mapping for the key
+	template<class Key>
+	typename std::enable_if<IsHashKeyLike<Hash, K, Key>::value, bool>::type Contains(
+			const Key& key) const {
+		return (TryFind(key) != NULL);
+	}
+
+	// Name			: getSize
+	// Description	: Returns the number of key-value mappings in this map.
+	// Parameters	: None
+	// Return Value : the number of key-value mappings in this map
+	int getSize() const {
+		return _count;
+	}
+
+	// Name			: GetStats
+	// Description	: Returns the counters of the statistics policy, and the
+	//					state of the table. The buckets are the slots.
+	// Parameters	: None
+	// Return Value : a copy of the counters
+	StatsSnapshot GetStats() const {
+		StatsSnapshot res = Stats::Snapshot();
+
+		res.size = _count;
+		res.buckets = (long long) _capacity;
+		res.load_factor = (double) _count / (double) _capacity;
+		return res;
+	}
+
+	// Name			: getHasher
+	// Description	: Returns the hash functor of the map
+	// Parameters	: None
+	// Return Value : the hash functor
+	const Hash& getHasher() const {
+		return hasher;
+	}
+
+	// Name			: Diagnostics
+	// Description	: Examines the groups of slots in one pass: the
+	//					distribution of their occupied slots, the uniformity
+	//					of the occupancy, the hottest groups, and the height
+	//					of every group, which is the longest probe sequence
+	//					of a key stored in it. The keys of the examined
+	//					groups are hashed again. A stride samples the groups
+	//					of a large map.
+	// Parameters	:
+	//	@top	- number of hottest groups to report
+	//	@stride	- examines every stride-th group, 1 examines all of them
+	// Return Value : the diagnostics
+	// 	If top is negative or stride isn't positive,
+	// HashMapInvalidArgException will be thrown.
+	HashMapDiagnostics Diagnostics(int top = DEFAULT_TOP_BUCKETS,
+			int stride = 1) const {
+		if (top < 0 || stride < 1) {
+			throw HashMapInvalidArgException();
+		}
+
+		HashMapDiagnostics res;
+		int groups = (int) (_capacity / FlatGroup::WIDTH);
+		res.buckets = groups;
+		res.stride = stride;
+
+		DiagnosticsCollector collector(&res, top);
+		for (int g = 0; g < groups; g += stride) {
+			size_t base = (size_t) g * FlatGroup::WIDTH;
+			int size = 0;
+			int height = 0;
+
+			for (size_t i = base; i < base + FlatGroup::WIDTH; i++) {
+				if (ctrl[i] < 0) {
+					continue;
+				}
+				size++;
+				int length = probeLength(hashFunction(slots[i].key),
+						(size_t) g);
+				if (length > height) {
+					height = length;
+				}
+			}
+			collector.Add(g, size, height);
+		}
+		collector.Finish();
+		return res;
+	}
+
+	// Name			: ParallelForEach
+	// Description	: Visits every mapping of the map. With an executor the
+	//					slots of a large map are visited by it's threads at
+	//					once. The order is unspecified, and the map must not
+	//					be changed during the scan.
+	// Parameters	:
+	//	@visitor - callable, invoked as visitor(key, value) for each
+	//				mapping. It's shared by the threads, and must be safe to
+	//				call concurrently.
+	// Return Value : None
+	template<class Visitor>
+	void ParallelForEach(Visitor visitor) {
+		VisitTask<Visitor> task(this, visitor);
+
+		if (useExecutor()) {
+			executor->ParallelFor(task, (int) _capacity, PARALLEL_GRAIN);
+		} else {
+			task.Run(0, (int) _capacity);
+		}
+	}
+
+	// HashMap destructor
+	~HashMap() {
+		DestructTask task(this);
+
+		if (std::is_trivially_destructible<Slot>::value == false) {
+			if (useExecutor()) {
+				executor->ParallelFor(task, (int) _capacity, PARALLEL_GRAIN);
+			} else {
+				task.Run(0, (int) _capacity);
+			}
+		}
+
+		freeTable(ctrl, slots, _capacity);
+	}
+};
+
+#endif /* FLAT_HASH_MAP_HPP_ */
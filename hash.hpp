@@ -0,0 +1,174 @@
+#ifndef HASH_HPP_
+#define HASH_HPP_
+
+//
+//	File		: hash.hpp
+//	Description	: Hash functors used by HashMap. The maps select buckets
+//					by masking the hash value with a power of two, so every
+//					bit of the result must depend on every bit of the key.
+//					DefaultHash provides a multiply-fold mixer (wyhash
+//					style) for integers and strings, and mixes the result of
+//					std::hash for every other type.
+//					The string hash is transparent (is_transparent), it
+//					hashes a const char* (and a std::string_view) like the
+//					std::string of the same characters, so the maps search
+//					strings without constructing one.
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+//
+//	Class		: HashMix
+//	Description : Mixing primitives of the built-in hash functions
+//
+class HashMix {
+private:
+	//
+	// Constants
+	//
+	static const uint64_t SECRET0 = 0xa0761d6478bd642fULL;
+	static const uint64_t SECRET1 = 0xe7037ed1a0b428dbULL;
+	static const uint64_t SECRET2 = 0x8ebc6af09c88c6e3ULL;
+	static const uint64_t SECRET3 = 0x589965cc75374cc3ULL;
+
+	static uint64_t read64(const unsigned char* p) {
+		uint64_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	static uint64_t read32(const unsigned char* p) {
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	// Name			: readSmall
+	// Description	: Reads 1 to 3 bytes into one word, touching every byte
+	// Parameters	:
+	//	@p 		- pointer to the bytes
+	//	@len	- number of bytes (1 to 3)
+	// Return Value : the packed word
+	static uint64_t readSmall(const unsigned char* p, size_t len) {
+		return (((uint64_t) p[0]) << 16) | (((uint64_t) p[len >> 1]) << 8)
+				| p[len - 1];
+	}
+
+public:
+	// Name			: Mum
+	// Description	: Multiplies two 64 bit words into 128 bits and folds
+	//					the halves together with xor.
+	// Parameters	:
+	//	@a, @b - the two words
+	// Return Value : the folded product
+	static uint64_t Mum(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+		__uint128_t r = (__uint128_t) a * b;
+		return (uint64_t) r ^ (uint64_t) (r >> 64);
+#else
+		uint64_t ha = a >> 32, hb = b >> 32;
+		uint64_t la = (uint32_t) a, lb = (uint32_t) b;
+		uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+		uint64_t t = rl + (rm0 << 32);
+		uint64_t c = t < rl;
+		uint64_t lo = t + (rm1 << 32);
+		c += lo < t;
+		uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+		return lo ^ hi;
+#endif
+	}
+
+	// Name			: Integer
+	// Description	: Hashes a 64 bit integer
+	// Parameters	:
+	//	@x - the integer
+	// Return Value : the hash value
+	static uint64_t Integer(uint64_t x) {
+		return Mum(x ^ SECRET0, SECRET1);
+	}
+
+	// Name			: Bytes
+	// Description	: Hashes a byte sequence, 16 bytes per step
+	// Parameters	:
+	//	@data	- pointer to the bytes
+	//	@len	- number of bytes
+	// Return Value : the hash value
+	static uint64_t Bytes(const void* data, size_t len) {
+		const unsigned char* p = static_cast<const unsigned char*>(data);
+		uint64_t seed = SECRET0 ^ Mum(len ^ SECRET1, SECRET0);
+		uint64_t a, b;
+
+		if (len <= 16) {
+			if (len >= 4) {
+				a = (read32(p) << 32) | read32(p + ((len >> 3) << 2));
+				b = (read32(p + len - 4) << 32)
+						| read32(p + len - 4 - ((len >> 3) << 2));
+			} else if (len > 0) {
+				a = readSmall(p, len);
+				b = 0;
+			} else {
+				a = b = 0;
+			}
+		} else {
+			size_t i = len;
+			while (i > 16) {
+				seed = Mum(read64(p) ^ SECRET1, read64(p + 8) ^ seed);
+				p += 16;
+				i -= 16;
+			}
+			a = read64(p + i - 16);
+			b = read64(p + i - 8);
+		}
+
+		return Mum(SECRET1 ^ len, Mum(a ^ SECRET1, b ^ seed) ^ SECRET3)
+				^ SECRET2;
+	}
+};
+
+//
+//	Class		: DefaultHash
+//	Description : Default hash functor of HashMap. Any functor with the
+//					interface of std::hash can be used instead, as long as
+//					it's low bits are well distributed.
+//
+template<class K, class Enable = void> struct DefaultHash {
+	size_t operator()(const K& key) const {
+		return (size_t) HashMix::Integer((uint64_t) std::hash<K>()(key));
+	}
+};
+
+template<class K> struct DefaultHash<K,
+		typename std::enable_if<
+				std::is_integral<K>::value || std::is_enum<K>::value>::type> {
+	size_t operator()(K key) const {
+		return (size_t) HashMix::Integer(static_cast<uint64_t>(key));
+	}
+};
+
+template<> struct DefaultHash<std::string> {
+	typedef void is_transparent;
+
+	size_t operator()(const std::string& key) const {
+		return (size_t) HashMix::Bytes(key.data(), key.size());
+	}
+
+	size_t operator()(const char* key) const {
+		return (size_t) HashMix::Bytes(key, std::strlen(key));
+	}
+
+#if __cplusplus >= 201703L
+	size_t operator()(std::string_view key) const {
+		return (size_t) HashMix::Bytes(key.data(), key.size());
+	}
+#endif
+};
+
+#endif /* HASH_HPP_ */
@@ -3,112 +3,1349 @@
 
 #include "avltree.hpp"
 #include "exceptions.hpp"
+#include "parallel_task.hpp"
+#include "hash.hpp"
+#include "pool_allocator.hpp"
+#include "simd.hpp"
+#include "stats.hpp"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-#define THRESHOLD_INCREASE 0.75
-#define THRESHOLD_DECREASE 0.25
+//
+//	Class		: LoadFactorPolicy
+//	Description : Decides when a HashMap grows and shrinks. The map grows
+//					when the load factor reaches the maximal load and
+//					shrinks when it drops under the minimal load. With the
+//					default thresholds a resize in either direction leaves
+//					the load factor at 0.375, a factor of two away from both
+//					thresholds, so a workload that oscillates around one of
+//					them can't make the map resize back and forth.
+//
+class LoadFactorPolicy {
+private:
+	double max_load;
+	double min_load;
 
-template<typename V, class K> class HashMap {
+public:
+	//
+	// Constants
+	//
+	static constexpr double DEFAULT_MAX_LOAD = 0.75;
+	static constexpr double DEFAULT_MIN_LOAD = 0.1875;
+
+	// LoadFactorPolicy constructor
+	//	@max_load - grow threshold
+	//	@min_load - shrink threshold, zero disables shrinking
+	explicit LoadFactorPolicy(double max_load = DEFAULT_MAX_LOAD,
+			double min_load = DEFAULT_MIN_LOAD) :
+			max_load(max_load), min_load(min_load) {
+	}
+
+	double getMaxLoad() const {
+		return max_load;
+	}
+
+	double getMinLoad() const {
+		return min_load;
+	}
+
+	// Name			: isValid
+	// Description	: Tests that a table resized by the given factor can't
+	//					cross the opposite threshold right away.
+	// Parameters	:
+	//	@factor - the resize factor of the table
+	// Return Value : true if the policy can be used with the factor
+	bool isValid(int factor) const {
+		return (0 < max_load && 0 <= min_load && min_load * factor < max_load
+				&& max_load / factor > min_load);
+	}
+
+	// Name			: ShouldGrow
+	// Description	: Tests if the table must grow.
+	// Parameters	:
+	//	@count	- number of mappings
+	//	@size	- table size
+	// Return Value : true if the table must grow
+	bool ShouldGrow(size_t count, size_t size) const {
+		return (max_load * size <= count);
+	}
+
+	// Name			: ShouldShrink
+	// Description	: Tests if the table should shrink.
+	// Parameters	:
+	//	@count	- number of mappings
+	//	@size	- table size
+	// Return Value : true if the table should shrink
+	bool ShouldShrink(size_t count, size_t size) const {
+		return (count < min_load * size);
+	}
+
+	// Name			: MinimalSize
+	// Description	: Computes the smallest table size, which is the initial
+	//					size times a power of two, that holds the given
+	//					number of mappings without growing.
+	// Parameters	:
+	//	@count			- number of mappings
+	//	@initial_size	- the initial table size
+	// Return Value : the table size
+	size_t MinimalSize(size_t count, size_t initial_size) const {
+		size_t size = initial_size;
+		while (ShouldGrow(count, size)) {
+			size *= 2;
+		}
+		return size;
+	}
+};
+
+//
+//	Struct		: HashMapDiagnostics
+//	Description : Shape of the buckets of a HashMap, as returned by
+//					Diagnostics. A bucket is an entry of the chained
+//					storage, whose height is the height of it's tree, or a
+//					group of slots of the flat storage, whose size counts
+//					the keys which hash to it and whose height is the
+//					number of groups probed to reach one of them.
+//					With a stride above one only every stride-th bucket
+//					is examined, and the counts are those of the sample.
+//
+struct HashMapDiagnostics {
+	//
+	// Constants
+	//
+	// Buckets larger than this are counted in the last histogram entry
+	static const int SIZE_HISTOGRAM_SIZE = 32;
+
+	int buckets;
+	int stride;
+	int examined_buckets;
+	long long examined_mappings;
+	// Old entries of an incremental resize which weren't moved yet. Their
+	// mappings aren't examined.
+	int unmigrated_buckets;
+
+	// size_histogram[i] is the number of examined buckets of size i
+	long long size_histogram[SIZE_HISTOGRAM_SIZE];
+	int empty_buckets;
+	int max_bucket_size;
+	double mean_bucket_size;
+	// Heights of the non-empty buckets
+	int max_height;
+	double mean_height;
+
+	// Pearson's chi-squared statistic of the bucket sizes against a
+	// uniform hash, and the statistic divided by it's degrees of freedom,
+	// which is close to 1 for a uniform hash and grows with the clustering
+	double chi_squared;
+	double uniformity;
+
+	// The largest examined buckets, as (bucket index, size), largest first
+	std::vector<std::pair<int, int> > hottest;
+
+	HashMapDiagnostics() :
+			buckets(0), stride(1), examined_buckets(0), examined_mappings(0),
+					unmigrated_buckets(0), empty_buckets(0),
+					max_bucket_size(0), mean_bucket_size(0), max_height(0),
+					mean_height(0), chi_squared(0), uniformity(0) {
+		for (int i = 0; i < SIZE_HISTOGRAM_SIZE; i++) {
+			size_histogram[i] = 0;
+		}
+	}
+};
+
+//
+//	Class		: DiagnosticsCollector
+//	Description : Builds a HashMapDiagnostics in one pass over the
+//					buckets. The hottest buckets are kept in a min-heap of
+//					the requested size.
+//
+class DiagnosticsCollector {
+private:
+	HashMapDiagnostics* diagnostics;
+	size_t top;
+	double sum_squares;
+	long long sum_heights;
+
+	static bool hotter(const std::pair<int, int>& lhs,
+			const std::pair<int, int>& rhs) {
+		return (lhs.second > rhs.second
+				|| (lhs.second == rhs.second && lhs.first < rhs.first));
+	}
+
+public:
+	// DiagnosticsCollector constructor
+	//	@diagnostics	- the result, whose buckets and stride are set
+	//	@top			- number of hottest buckets to keep
+	DiagnosticsCollector(HashMapDiagnostics* diagnostics, int top) :
+			diagnostics(diagnostics), top((top < 0) ? 0 : (size_t) top),
+					sum_squares(0), sum_heights(0) {
+	}
+
+	// Name			: Add
+	// Description	: Counts an examined bucket
+	// Parameters	:
+	//	@index	- the bucket index
+	//	@size	- number of mappings in the bucket
+	//	@height	- the bucket height
+	// Return Value : None
+	void Add(int index, int size, int height) {
+		HashMapDiagnostics& d = *diagnostics;
+
+		d.examined_buckets++;
+		d.examined_mappings += size;
+		d.size_histogram[(size < HashMapDiagnostics::SIZE_HISTOGRAM_SIZE) ?
+				size : HashMapDiagnostics::SIZE_HISTOGRAM_SIZE - 1]++;
+		sum_squares += (double) size * (double) size;
+		if (size > d.max_bucket_size) {
+			d.max_bucket_size = size;
+		}
+
+		if (size == 0) {
+			d.empty_buckets++;
+			return;
+		}
+		sum_heights += height;
+		if (height > d.max_height) {
+			d.max_height = height;
+		}
+
+		if (top == 0) {
+			return;
+		}
+		std::pair<int, int> bucket(index, size);
+		if (d.hottest.size() < top) {
+			d.hottest.push_back(bucket);
+			std::push_heap(d.hottest.begin(), d.hottest.end(), hotter);
+		} else if (hotter(bucket, d.hottest.front())) {
+			std::pop_heap(d.hottest.begin(), d.hottest.end(), hotter);
+			d.hottest.back() = bucket;
+			std::push_heap(d.hottest.begin(), d.hottest.end(), hotter);
+		}
+	}
+
+	// Name			: Finish
+	// Description	: Computes the means and the uniformity, once all the
+	//					buckets were added.
+	// Parameters	: None
+	// Return Value : None
+	void Finish() {
+		HashMapDiagnostics& d = *diagnostics;
+		int used = d.examined_buckets - d.empty_buckets;
+
+		if (d.examined_buckets > 0) {
+			d.mean_bucket_size = (double) d.examined_mappings
+					/ (double) d.examined_buckets;
+		}
+		if (used > 0) {
+			d.mean_height = (double) sum_heights / (double) used;
+		}
+
+		// sum((n - E)^2 / E) = sum(n^2) / E - M, for M mappings and
+		// E = M / B expected in each of the B buckets
+		if (d.examined_mappings > 0) {
+			d.chi_squared = sum_squares / d.mean_bucket_size
+					- (double) d.examined_mappings;
+			if (d.examined_buckets > 1) {
+				d.uniformity = d.chi_squared / (d.examined_buckets - 1);
+			}
+		}
+
+		std::sort_heap(d.hottest.begin(), d.hottest.end(), hotter);
+	}
+};
+
+// Name			: RangeLengthHint
+// Description	: Returns the length of a range which can be measured
+//					before it's read (forward iterators), for the buffers of
+//					InsertRange.
+// Parameters	:
+//	@first	- the first element
+//	@last	- the end of the range
+// Return Value : the length, 0 for input iterators
+template<class Iterator>
+size_t RangeLengthHint(Iterator first, Iterator last,
+		std::forward_iterator_tag) {
+	return (size_t) std::distance(first, last);
+}
+
+template<class Iterator>
+size_t RangeLengthHint(Iterator, Iterator, std::input_iterator_tag) {
+	return 0;
+}
+
+template<class Iterator>
+size_t RangeLengthHint(Iterator first, Iterator last) {
+	return RangeLengthHint(first, last,
+			typename std::iterator_traits<Iterator>::iterator_category());
+}
+
+//
+//	Class		: IsHashKeyLike
+//	Description : Selects the key-like overloads of the map lookups. They
+//					need a transparent hash functor (see IsTransparent), and
+//					keys which compare with the key-like type (see
+//					TransparentKeys).
+//
+template<class Hash, class K, class Key> struct IsHashKeyLike: std::integral_constant<
+		bool, IsTransparent<Hash>::value
+				&& IsKeyLike<DefaultCompare<K>, K, Key>::value> {
+};
+
+//
+//	Storage engines, selected by the third template parameter of HashMap.
+//	The fourth parameter is the hash functor (see hash.hpp), the fifth is
+//	the allocator of the values and of the buckets (see pool_allocator.hpp),
+//	and the sixth is the statistics policy (see stats.hpp).
+//	ChainedStorage	- every bucket is an AVL tree, whose nodes hold the keys
+//					  and the values (this file). Pointers to the values
+//					  stay valid until their mapping is removed.
+//	FlatStorage		- open addressing, keys and values are kept inline in
+//					  a contiguous slot array (flat_hash_map.hpp). Values
+//					  move when the table is resized.
+//
+struct ChainedStorage {
+};
+struct FlatStorage {
+};
+
+template<typename V, class K, class Storage = ChainedStorage,
+		class Hash = DefaultHash<K>, class Allocator = std::allocator<V>,
+		class Stats = NoStats>
+class HashMap: private Stats {
 	//
 	//	Class		: HashMap
 	//	Description : Implementation of hash map, which uses
 	//					dynamic chain hashing. It's entries are
-	//					AVL trees
+	//					AVL trees, which hold the values in their nodes.
+	//					The number of entries is always a power of two.
+	//					A resize relinks the nodes into the new entries, so
+	//					the values never move.
+	//					In incremental resize mode (SetIncrementalResize)
+	//					the old and the new entries arrays live together
+	//					during a resize, and every Insert/Delete moves a
+	//					bounded number of old entries to the new array.
+	//					With an executor (SetExecutor) the whole-table
+	//					operations - a full resize, BulkLoad, the destructor
+	//					and ParallelForEach - split the entries between
+	//					threads.
+	//					The map inherits it's statistics policy, like
+	//					AVLTree. With ContainerStats the buckets record
+	//					their searches, rotations and nodes into the map's
+	//					counters, through a StatsLink.
 
 private:
 	//
 	// Constants
 	//
 	static const int EMPTY_TABLE = 0;
-	static const int INITIAL_SIZE = 10;
+	static const int INITIAL_SIZE = 16;
 	static const int INCREASE_FACTOR = 2;
 	static const int DECREASE_FACTOR = 2;
+	// Number of keys whose memory is prefetched together by the batched
+	// operations
+	static const int BATCH_GROUP = 16;
+	// Tables smaller than this aren't split between threads
+	static const int PARALLEL_MIN_ENTRIES = 1 << 12;
+	// Number of entries (or of BulkLoad mappings) per executor chunk
+	static const int PARALLEL_GRAIN = 1 << 10;
+	// Number of hottest entries reported by Diagnostics
+	static const int DEFAULT_TOP_BUCKETS = 8;
+
+	typedef std::allocator_traits<Allocator> ValueAllocatorTraits;
+	typedef AVLTree<V, K, Allocator, NoAugmentation, typename Stats::Link> Bucket;
+	typedef typename ValueAllocatorTraits::template rebind_alloc<Bucket> EntriesAllocator;
+	typedef std::allocator_traits<EntriesAllocator> EntriesAllocatorTraits;
 
-	AVLTree<V*, K> *entries;
+	Bucket *entries;
 	int _size;
 	int _count;
+	Hash hasher;
+	Allocator alloc;
+	LoadFactorPolicy policy;
+	// The map doesn't shrink under this size (see Reserve)
+	int min_size;
+
+	// Resize in progress - old_entries is NULL when there's none
+	Bucket *old_entries;
+	int old_size;
+	int migrate_index;
+	int migrate_step;
+
+	// Runs the whole-table operations, serially when NULL
+	Executor* executor;
+
+	// Name			: allocateEntries
+	// Description	: Allocates an array of empty buckets, which share the
+	//					map's allocator.
+	// Parameters	:
+	//	@size - number of buckets
+	// Return Value : pointer to the new array
+	// If memory allocation failes, a matching exception would be thrown by
+	//	the system.
+	Bucket* allocateEntries(int size) {
+		EntriesAllocator entries_alloc(alloc);
+		Bucket* res = EntriesAllocatorTraits::allocate(entries_alloc, size);
+		int i = 0;
+
+		try {
+			for (; i < size; i++) {
+				EntriesAllocatorTraits::construct(entries_alloc, res + i,
+						alloc, Stats::GetLink());
+			}
+		} catch (...) {
+			while (i > 0) {
+				EntriesAllocatorTraits::destroy(entries_alloc, res + (--i));
+			}
+			EntriesAllocatorTraits::deallocate(entries_alloc, res, size);
+			throw;
+		}
+		Stats::RecordMemory(0, (long long) size * (long long) sizeof(Bucket));
+		return res;
+	}
+
+	// Name			: destroyEntries
+	// Description	: Destructs an array of buckets and frees it.
+	// Parameters	:
+	//	@buckets	- the array
+	//	@size		- number of buckets
+	// Return Value : None
+	void destroyEntries(Bucket* buckets, int size) {
+		EntriesAllocator entries_alloc(alloc);
+
+		for (int i = 0; i < size; i++) {
+			EntriesAllocatorTraits::destroy(entries_alloc, buckets + i);
+		}
+		EntriesAllocatorTraits::deallocate(entries_alloc, buckets, size);
+		Stats::RecordMemory(0, -(long long) size * (long long) sizeof(Bucket));
+	}
 
 	// Name			: hashFunction
 	// Description	: This function converts a given key to it's matching
-	//					hashing value
+	//					entry index, by masking the hash value with the
+	//					table size.
 	// Parameters	:
 	//	@key 	- key with which result should be associated
-	// Return Value : The hash value associated with the given key
+	// Return Value : The entry index associated with the given key
 	int hashFunction(const K& key) const {
-		int res = ((int) key % _size);
+		return (int) (hasher(key) & (size_t) (_size - 1));
+	}
 
-		if (0 <= res) {
-			return res;
-		} else {
-			return res + _size;
+	// Name			: prepareEntry
+	// Description	: Returns the entry of the given key in the new array. If
+	//					a resize is in progress, the old entry of the key is
+	//					moved first, so the key can only be in the new entry.
+	// Parameters	:
+	//	@hash 	- the hash value of the key
+	// Return Value : The entry index associated with the given key
+	int prepareEntry(size_t hash) {
+		if (old_entries != NULL) {
+			int old_index = (int) (hash & (size_t) (old_size - 1));
+			if (old_index >= migrate_index) {
+				migrateEntry(old_index);
+			}
 		}
+		return (int) (hash & (size_t) (_size - 1));
 	}
 
 	// Name			: loadFactorCheckAndResize
 	// Description	: This function checks if the current load factor of the
-	//					hash table is valid (i.e between the 2 thresholds)
+	//					hash table is valid according to the load factor
+	//					policy. Growing is only checked after an insertion
+	//					and shrinking only after a removal, so a reserved
+	//					table isn't shrunk by the first insertions.
+	//					A resize in progress is advanced first.
+	// Parameters	:
+	//	@inserted	- true after an insertion, false after a removal
+	// Return Value : None
+	void loadFactorCheckAndResize(bool inserted) {
+		if (old_entries != NULL) {
+			migrateStep();
+		}
+
+		if (inserted == true) {
+			if (policy.ShouldGrow(_count, _size)) {
+				Resize(_size * INCREASE_FACTOR);
+			}
+		} else if (_size > min_size && policy.ShouldShrink(_count, _size)) {
+			Resize(_size / DECREASE_FACTOR);
+		}
+	}
+
+	// Name			: shrinkToCount
+	// Description	: Shrinks the table once, straight to the smallest size
+	//					which holds it's mappings, after many removals. The
+	//					table won't be smaller than the reserved size.
 	// Parameters	: None
 	// Return Value : None
-	void loadFactorCheckAndResize() {
-		double load_factor = (double) _count / _size;
+	void shrinkToCount() {
+		if (_size <= min_size || policy.ShouldShrink(_count, _size) == false) {
+			return;
+		}
 
-		if (THRESHOLD_INCREASE <= load_factor) {
-			Resize(true);
-		} else if (THRESHOLD_DECREASE >= load_factor) {
-			Resize(false);
+		int new_size = (int) policy.MinimalSize(_count, INITIAL_SIZE);
+		if (new_size < min_size) {
+			new_size = min_size;
+		}
+		if (new_size < _size) {
+			Resize(new_size);
 		}
 	}
 
 	// Name			: Resize
 	// Description	: This function resizes the array which it's entries
-	//					contain the data of hash-map.
-	//					The map won't change it's size to be less that it's
-	//					initial size.
+	//					contain the data of hash-map. In incremental mode the
+	//					entries are moved later, by migrateStep.
 	// Parameters	:
-	//	@increase 	- boolean parameter which indicated if the table has to
-	//					be increased or decreased
+	//	@new_size 	- the new number of entries, a power of two
 	// Return Value : None
 	// If memory allocation failes, a matching exception would be thrown by
 	//	the system.
-	void Resize(bool increase) {
-		if (false == increase && _size == INITIAL_SIZE){
+	void Resize(int new_size) {
+		long long start = Stats::Now();
+
+		// Only one resize at a time
+		completeMigration();
+
+		Bucket* new_entries = allocateEntries(new_size);
+
+		old_entries = entries;
+		old_size = _size;
+		migrate_index = 0;
+		entries = new_entries;
+		_size = new_size;
+
+		if (migrate_step == 0) {
+			completeMigration();
+		}
+		Stats::RecordRehash(Stats::Now() - start);
+	}
+
+	//
+	//	Class		: EntrySelector
+	//	Description : Chooses the entry of a key in the new entries array,
+	//					when the nodes of an old entry are moved.
+	//
+	struct EntrySelector {
+		HashMap* map;
+
+		Bucket* operator()(const K& key) const {
+			return &map->entries[map->hashFunction(key)];
+		}
+	};
+
+	// Name			: migrateEntry
+	// Description	: Moves all the mappings of an old entry to the new
+	//					entries array. The tree nodes are relinked, without
+	//					allocating or copying.
+	// Parameters	:
+	//	@index - the index of the old entry
+	// Return Value : None
+	void migrateEntry(int index) {
+		EntrySelector select = { this };
+		old_entries[index].Distribute(select);
+	}
+
+	// Name			: migrateStep
+	// Description	: Moves the next migrate_step old entries to the new
+	//					entries array. The old array is freed once it's empty.
+	// Parameters	: None
+	// Return Value : None
+	void migrateStep() {
+		long long start = Stats::Now();
+
+		// The index moves past an entry once it's moved, so an entry whose
+		// hash threw is still searched, and moved by the next step
+		for (int i = 0; i < migrate_step && migrate_index < old_size; i++) {
+			migrateEntry(migrate_index);
+			migrate_index++;
+		}
+
+		if (migrate_index == old_size) {
+			destroyEntries(old_entries, old_size);
+			old_entries = NULL;
+			old_size = 0;
+		}
+		Stats::RecordMigration(Stats::Now() - start);
+	}
+
+	// Name			: finishMigration
+	// Description	: Completes the resize in progress, if there's one.
+	// Parameters	: None
+	// Return Value : None
+	void finishMigration() {
+		if (old_entries == NULL) {
 			return;
 		}
-		
-		int old_size = _size;
-		_size = (increase == true) ? (_size * INCREASE_FACTOR) :
-				(_size / DECREASE_FACTOR);
 
-		AVLTree<V*, K>* old_entries = entries;
-		entries = new AVLTree<V*, K> [_size];
-		_count = 0;
+		long long start = Stats::Now();
+		completeMigration();
+		Stats::RecordMigration(Stats::Now() - start);
+	}
+
+	// Name			: completeMigration
+	// Description	: finishMigration, without recording it's duration. The
+	//					duration of a Resize is recorded as a whole.
+	// Parameters	: None
+	// Return Value : None
+	void completeMigration() {
+		if (old_entries == NULL) {
+			return;
+		}
+
+		if (useExecutor(old_size - migrate_index)) {
+			MigrateTask task(this);
+			if (_size >= old_size) {
+				executor->ParallelFor(task, old_size - migrate_index,
+						PARALLEL_GRAIN);
+			} else {
+				executor->ParallelFor(task, _size, PARALLEL_GRAIN);
+			}
+			migrate_index = old_size;
+		}
+
+		while (migrate_index < old_size) {
+			migrateEntry(migrate_index);
+			migrate_index++;
+		}
+		destroyEntries(old_entries, old_size);
+		old_entries = NULL;
+		old_size = 0;
+	}
+
+	// Name			: useExecutor
+	// Description	: Tests if a whole-table operation over the given number
+	//					of entries is worth splitting between threads.
+	// Parameters	:
+	//	@count - number of entries
+	// Return Value : true if the operation should run on the executor
+	bool useExecutor(int count) const {
+		return (executor != NULL && executor->getConcurrency() > 1
+				&& count >= PARALLEL_MIN_ENTRIES);
+	}
+
+	//
+	//	Class		: MigrateTask
+	//	Description : Moves the old entries to the new array on the
+	//					executor's threads. When the table grows the nodes of
+	//					an old entry only go to new entries no other old
+	//					entry reaches, so every index is an old entry. When
+	//					it shrinks several old entries meet in one new
+	//					entry, so every index is a new entry, which pulls
+	//					all of it's old entries.
+	//
+	class MigrateTask: public ParallelTask {
+	private:
+		HashMap* map;
+
+	public:
+		explicit MigrateTask(HashMap* map) :
+				map(map) {
+		}
+
+		void Run(int first, int last) {
+			if (map->_size >= map->old_size) {
+				for (int i = first; i < last; i++) {
+					map->migrateEntry(map->migrate_index + i);
+				}
+				return;
+			}
+
+			for (int i = first; i < last; i++) {
+				for (int old_index = i; old_index < map->old_size; old_index +=
+						map->_size) {
+					if (old_index >= map->migrate_index) {
+						map->migrateEntry(old_index);
+					}
+				}
+			}
+		}
+	};
+
+	//
+	//	Class		: ClearTask
+	//	Description : Deletes the nodes of an entries array on the
+	//					executor's threads.
+	//
+	class ClearTask: public ParallelTask {
+	private:
+		Bucket* buckets;
+
+	public:
+		explicit ClearTask(Bucket* buckets) :
+				buckets(buckets) {
+		}
+
+		void Run(int first, int last) {
+			for (int i = first; i < last; i++) {
+				buckets[i].Clear();
+			}
+		}
+	};
+
+	//
+	//	Class		: EraseTask
+	//	Description : Deletes the mappings which match a predicate from the
+	//					entries, on the executor's threads.
+	//
+	template<class Predicate>
+	class EraseTask: public ParallelTask {
+	private:
+		HashMap* map;
+		Predicate& predicate;
+		std::atomic<int> removed;
+
+	public:
+		EraseTask(HashMap* map, Predicate& predicate) :
+				map(map), predicate(predicate), removed(0) {
+		}
+
+		void Run(int first, int last) {
+			int run_removed = 0;
+
+			for (int i = first; i < last; i++) {
+				Bucket& bucket = map->entries[i];
+				int before = bucket.getSize();
+				try {
+					bucket.template EraseIf<Predicate&>(predicate);
+				} catch (...) {
+					run_removed += before - bucket.getSize();
+					removed.fetch_add(run_removed, std::memory_order_relaxed);
+					throw;
+				}
+				run_removed += before - bucket.getSize();
+			}
+			removed.fetch_add(run_removed, std::memory_order_relaxed);
+		}
+
+		int getRemoved() const {
+			return removed.load(std::memory_order_relaxed);
+		}
+	};
+
+	//
+	//	Class		: VisitTask
+	//	Description : Visits the entries on the executor's threads. The
+	//					indices past the new entries are the old entries
+	//					which weren't moved yet.
+	//
+	template<class Visitor>
+	class VisitTask: public ParallelTask {
+	private:
+		HashMap* map;
+		Visitor& visitor;
+
+	public:
+		VisitTask(HashMap* map, Visitor& visitor) :
+				map(map), visitor(visitor) {
+		}
+
+		void Run(int first, int last) {
+			for (int i = first; i < last; i++) {
+				Bucket& bucket = (i < map->_size) ?
+						map->entries[i] :
+						map->old_entries[map->migrate_index + i - map->_size];
+				for (typename Bucket::iterator it = bucket.begin();
+						it != bucket.end(); ++it) {
+					visitor(it.getKey(), *it);
+				}
+			}
+		}
+	};
+
+	//
+	//	Class		: HashTask
+	//	Description : Computes the entries of the BulkLoad keys on the
+	//					executor's threads.
+	//
+	class HashTask: public ParallelTask {
+	private:
+		const HashMap* map;
+		const K* keys;
+		int* entry_of;
+
+	public:
+		HashTask(const HashMap* map, const K* keys, int* entry_of) :
+				map(map), keys(keys), entry_of(entry_of) {
+		}
+
+		void Run(int first, int last) {
+			for (int i = first; i < last; i++) {
+				entry_of[i] = map->hashFunction(keys[i]);
+			}
+		}
+	};
+
+	//
+	//	Class		: LoadTask
+	//	Description : Inserts the BulkLoad mappings on the executor's
+	//					threads. Every index is an entry, and the mappings of
+	//					an entry are order[starts[i]] to order[starts[i+1]-1].
+	//
+	class LoadTask: public ParallelTask {
+	private:
+		HashMap* map;
+		const K* keys;
+		V* values;
+		const int* starts;
+		const int* order;
+		std::atomic<int> inserted;
+		std::atomic<bool> duplicate;
+
+	public:
+		LoadTask(HashMap* map, const K* keys, V* values, const int* starts,
+				const int* order) :
+				map(map), keys(keys), values(values), starts(starts), order(
+						order), inserted(0), duplicate(false) {
+		}
+
+		int getInserted() const {
+			return inserted.load(std::memory_order_relaxed);
+		}
+
+		bool hasDuplicate() const {
+			return duplicate.load(std::memory_order_relaxed);
+		}
+
+		void Run(int first, int last) {
+			int count = 0;
+
+			try {
+				for (int i = first; i < last; i++) {
+					for (int j = starts[i]; j < starts[i + 1]; j++) {
+						bool added = map->entries[i].TryEmplace(keys[order[j]],
+								std::move(values[order[j]])).second;
+						map->Stats::RecordInsert(added);
+						if (added == true) {
+							count++;
+						} else {
+							duplicate.store(true, std::memory_order_relaxed);
+						}
+					}
+				}
+			} catch (...) {
+				inserted.fetch_add(count, std::memory_order_relaxed);
+				throw;
+			}
+			inserted.fetch_add(count, std::memory_order_relaxed);
+		}
+	};
+
+	// Name			: partitionByEntry
+	// Description	: Orders mappings by their entries, with a counting sort.
+	//					The mappings of an entry keep their input order. The
+	//					keys are hashed by the executor's threads when the
+	//					input is large.
+	// Parameters	:
+	//	@keys	- the keys of the mappings
+	//	@count	- number of mappings
+	//	@starts	- receives _size + 1 indices into the order, the mappings
+	//				of entry i are order[starts[i]] to order[starts[i+1]-1]
+	//	@order	- receives the mapping indices, ordered by entry
+	// Return Value : None
+	void partitionByEntry(const K* keys, int count, std::vector<int>* starts,
+			std::vector<int>* order) const {
+		std::vector<int> entry_of(count);
+		HashTask hash_task(this, keys, &entry_of[0]);
+		if (useExecutor(count)) {
+			executor->ParallelFor(hash_task, count, PARALLEL_GRAIN);
+		} else {
+			hash_task.Run(0, count);
+		}
+
+		// After the second pass starts[i] is the end of entry i, and
+		// filling the order backwards moves it to the start
+		starts->assign(_size + 1, 0);
+		for (int i = 0; i < count; i++) {
+			(*starts)[entry_of[i]]++;
+		}
+		for (int i = 1; i <= _size; i++) {
+			(*starts)[i] += (*starts)[i - 1];
+		}
+		order->resize(count);
+		for (int i = count - 1; i >= 0; i--) {
+			(*order)[--(*starts)[entry_of[i]]] = i;
+		}
+	}
+
+	//
+	//	Class		: KeyOrder
+	//	Description : Orders mapping indices by their keys, and equal keys
+	//					by their input order.
+	//
+	struct KeyOrder {
+		const K* keys;
+
+		bool operator()(int lhs, int rhs) const {
+			if (keys[lhs] < keys[rhs]) {
+				return true;
+			}
+			if (keys[rhs] < keys[lhs]) {
+				return false;
+			}
+			return lhs < rhs;
+		}
+	};
+
+	//
+	//	Class		: IngestTask
+	//	Description : Inserts the InsertRange mappings of every entry, which
+	//					are sorted by key and distinct. The mappings of an
+	//					empty entry are built into it's tree in one linear
+	//					pass, the others are inserted one by one.
+	//
+	class IngestTask: public ParallelTask {
+	private:
+		HashMap* map;
+		const K* keys;
+		V* values;
+		const int* starts;
+		std::atomic<int> inserted;
+
+	public:
+		IngestTask(HashMap* map, const K* keys, V* values, const int* starts) :
+				map(map), keys(keys), values(values), starts(starts), inserted(
+						0) {
+		}
+
+		int getInserted() const {
+			return inserted.load(std::memory_order_relaxed);
+		}
+
+		void Run(int first, int last) {
+			int count = 0;
+
+			try {
+				for (int i = first; i < last; i++) {
+					Bucket& bucket = map->entries[i];
+					int length = starts[i + 1] - starts[i];
+
+					if (length != 0 && bucket.Empty() == true) {
+						bucket.BuildFromSorted(keys + starts[i],
+								values + starts[i], length);
+						count += length;
+						for (int j = 0; j < length; j++) {
+							map->Stats::RecordInsert(true);
+						}
+						continue;
+					}
+					for (int j = starts[i]; j < starts[i + 1]; j++) {
+						bool added = bucket.TryEmplace(keys[j],
+								std::move(values[j])).second;
+						map->Stats::RecordInsert(added);
+						if (added == true) {
+							count++;
+						}
+					}
+				}
+			} catch (...) {
+				inserted.fetch_add(count, std::memory_order_relaxed);
+				throw;
+			}
+			inserted.fetch_add(count, std::memory_order_relaxed);
+		}
+	};
+
+	// Name			: ingest
+	// Description	: Inserts the buffered mappings of InsertRange. The map
+	//					is resized once, the mappings are ordered by entry
+	//					and then by key within every entry, and every entry
+	//					takes it's mappings at once.
+	// Parameters	:
+	//	@keys	- the keys
+	//	@values	- the values, in the order of the keys, moved
+	// Return Value : the number of inserted mappings
+	int ingest(std::vector<K>& keys, std::vector<V>& values) {
+		int count = (int) keys.size();
+		if (count == 0) {
+			return 0;
+		}
+
+		finishMigration();
+		int new_size = (int) policy.MinimalSize(_count + count, INITIAL_SIZE);
+		if (new_size > _size) {
+			Resize(new_size);
+			finishMigration();
+		}
+
+		std::vector<int> starts;
+		std::vector<int> order;
+		partitionByEntry(&keys[0], count, &starts, &order);
+
+		// Sorts every entry, and compacts the mappings into entry order,
+		// keeping the first of equal keys
+		KeyOrder by_key = { &keys[0] };
+		std::vector<K> sorted_keys;
+		std::vector<V> sorted_values;
+		std::vector<int> sorted_starts(_size + 1, 0);
+		sorted_keys.reserve(count);
+		sorted_values.reserve(count);
+		for (int i = 0; i < _size; i++) {
+			sorted_starts[i] = (int) sorted_keys.size();
+			if (starts[i + 1] - starts[i] > 1) {
+				std::sort(order.begin() + starts[i],
+						order.begin() + starts[i + 1], by_key);
+			}
+			for (int j = starts[i]; j < starts[i + 1]; j++) {
+				int index = order[j];
+				if (j > starts[i] && !(keys[order[j - 1]] < keys[index])) {
+					Stats::RecordInsert(false);
+					continue;
+				}
+				sorted_keys.push_back(keys[index]);
+				sorted_values.push_back(std::move(values[index]));
+			}
+		}
+		sorted_starts[_size] = (int) sorted_keys.size();
+
+		IngestTask task(this, &sorted_keys[0], &sorted_values[0],
+				&sorted_starts[0]);
+		try {
+			if (AllocatorThreadSafety<Allocator>::value
+					&& useExecutor(_size)) {
+				executor->ParallelFor(task, _size, PARALLEL_GRAIN);
+			} else {
+				task.Run(0, _size);
+			}
+		} catch (...) {
+			_count += task.getInserted();
+			throw;
+		}
+
+		_count += task.getInserted();
+		return task.getInserted();
+	}
+
+	// Name			: bulkLoadParallel
+	// Description	: Inserts the BulkLoad mappings on the executor's
+	//					threads. The mappings are sorted by entry first, so
+	//					every thread inserts into it's own entries. The map
+	//					must hold all the mappings without growing.
+	// Parameters	:
+	//	@keys	- the keys
+	//	@values	- the values, in the order of the keys
+	//	@count	- number of mappings
+	// Return Value : None
+	// 	If a key already exists, HashMapKeyAlreadyExistsException will be
+	// thrown once all the other mappings were inserted.
+	void bulkLoadParallel(const K* keys, V* values, int count) {
+		std::vector<int> starts;
+		std::vector<int> order;
+		partitionByEntry(keys, count, &starts, &order);
+
+		LoadTask load_task(this, keys, values, &starts[0], &order[0]);
+		try {
+			executor->ParallelFor(load_task, _size, PARALLEL_GRAIN);
+		} catch (...) {
+			_count += load_task.getInserted();
+			throw;
+		}
+
+		_count += load_task.getInserted();
+		if (load_task.hasDuplicate() == true) {
+			Stats::RecordException();
+			throw HashMapKeyAlreadyExistsException();
+		}
+	}
+
+	// Name			: emplaceValue
+	// Description	: Inserts the key to it's bucket if it doesn't exist
+	//					yet, with a value constructed in place from the given
+	//					arguments. The bucket is searched once.
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@args 	- the arguments of the value constructor
+	// Return Value : A pair of a pointer to the value, and whether the key
+	//					was inserted by this call
+	template<class Key, class ... Args>
+	std::pair<V*, bool> emplaceValue(Key&& key, Args&&... args) {
+		return emplaceHashed(hasher(key), std::forward<Key>(key),
+				std::forward<Args>(args)...);
+	}
+
+	// Name			: emplaceHashed
+	// Description	: emplaceValue, for a key whose hash value is known
+	// Parameters	:
+	//	@hash	- the hash value of the key
+	//	@key 	- key with which the specified value is to be associated
+	//	@args 	- the arguments of the value constructor
+	// Return Value : A pair of a pointer to the value, and whether the key
+	//					was inserted by this call
+	template<class Key, class ... Args>
+	std::pair<V*, bool> emplaceHashed(size_t hash, Key&& key,
+			Args&&... args) {
+		int entry_index = prepareEntry(hash);
+		std::pair<V*, bool> res = entries[entry_index].TryEmplace(
+				std::forward<Key>(key), std::forward<Args>(args)...);
+
+		if (res.second == true) {
+			_count++;
+		}
+		Stats::RecordInsert(res.second);
+		return res;
+	}
+
+	//
+	//	Class		: ValueOutput / FlagOutput
+	//	Description : Result sinks of lookupBatch, the first stores the
+	//					elements and the second whether they were found.
+	//
+	struct ValueOutput {
+		V** out;
+
+		void operator()(int index, V* value) const {
+			out[index] = value;
+		}
+	};
+
+	struct FlagOutput {
+		bool* out;
+
+		void operator()(int index, V* value) const {
+			out[index] = (value != NULL);
+		}
+	};
+
+	// Name			: prefetchGroup
+	// Description	: Hashes a group of keys and prefetches their entries,
+	//					and then the roots of the entries' trees. The roots
+	//					are read once all the entries were requested, so
+	//					the two rounds of misses overlap within the group.
+	// Parameters	:
+	//	@keys	- the keys of the group
+	//	@count	- number of keys, up to BATCH_GROUP
+	//	@hashes	- receives the hash values of the keys
+	// Return Value : None
+	void prefetchGroup(const K* keys, int count, size_t* hashes) const {
+		size_t mask = (size_t) (_size - 1);
 
-		for (int i = 0; i < old_size; i++) {
-			int tree_size = old_entries[i].getSize();
-			V*** tree_data = old_entries[i].inOrderExtractData();
-			K* tree_keys = old_entries[i].inOrderExtractKeys();
+		for (int i = 0; i < count; i++) {
+			hashes[i] = hasher(keys[i]);
+			PrefetchRead(&entries[hashes[i] & mask]);
+		}
+		for (int i = 0; i < count; i++) {
+			entries[hashes[i] & mask].PrefetchRoot();
+		}
+	}
 
-			for (int j = 0; j < tree_size; j++) {
-				K temp_key = tree_keys[j];
-				V* temp_obj = *(tree_data[j]);
+	// Name			: lookupBatch
+	// Description	: Searches many keys, a prefetched group at a time.
+	// Parameters	:
+	//	@keys	- the keys to search
+	//	@count	- number of keys
+	//	@output	- callable, invoked as output(index, value) for every key,
+	//				with NULL for the missing keys
+	// Return Value : the number of keys found
+	template<class Output>
+	int lookupBatch(const K* keys, int count, Output output) const {
+		size_t hashes[BATCH_GROUP];
+		int found = 0;
 
-				int entry_index = hashFunction(temp_key);
-				entries[entry_index].Insert(temp_key, temp_obj);
-				_count++;
+		for (int first = 0; first < count; first += BATCH_GROUP) {
+			int group = (count - first < BATCH_GROUP) ?
+					count - first : BATCH_GROUP;
+
+			prefetchGroup(keys + first, group, hashes);
+			for (int i = 0; i < group; i++) {
+				V* value = findHashed(keys[first + i], hashes[i]);
+				if (value != NULL) {
+					found++;
+				}
+				output(first + i, value);
 			}
-			
-			delete[] tree_data;
-			delete[] tree_keys;
 		}
+		return found;
+	}
+
+	// Name			: eraseKey
+	// Description	: Removes the mapping of a key, for Erase and Delete
+	// Parameters	:
+	//	@key - the key, or a key-like object
+	// Return Value : true if the mapping was removed, false if the key
+	//					wasn't found
+	template<class Key>
+	bool eraseKey(const Key& key) {
+		int entry_index = prepareEntry(hasher(key));
+		bool erased = entries[entry_index].Erase(key);
+
+		Stats::RecordErase(erased);
+		if (erased == false) {
+			return false;
+		}
+		_count--;
 
-		delete[] old_entries;
+		loadFactorCheckAndResize(false);
+		return true;
+	}
+
+	// Name			: findHashed
+	// Description	: TryFind, for a key whose hash value is known
+	// Parameters	:
+	//	key 	- key value of the element to search for, or a key-like
+	//				object
+	//	hash	- the hash value of the key
+	// Return Value : Pointer to the element with key equivalent to key, or
+	//					NULL if no such element is found.
+	template<class Key>
+	V* findHashed(const Key& key, size_t hash) const {
+		V* value = NULL;
+
+		if (old_entries != NULL) {
+			int old_index = (int) (hash & (size_t) (old_size - 1));
+			if (old_index >= migrate_index) {
+				value = old_entries[old_index].TryFind(key);
+			}
+		}
+		if (value == NULL) {
+			value = entries[hash & (size_t) (_size - 1)].TryFind(key);
+		}
+
+		Stats::RecordLookup(value != NULL);
+		return value;
 	}
 
 public:
 
 	// HashMap contstructor
-	HashMap() :
-			_size(INITIAL_SIZE), _count(EMPTY_TABLE) {
-		entries = new AVLTree<V*, K> [INITIAL_SIZE];
+	explicit HashMap(const Hash& hash = Hash(), const Allocator& allocator =
+			Allocator()) :
+			_size(INITIAL_SIZE), _count(EMPTY_TABLE), hasher(hash), alloc(
+					allocator), min_size(INITIAL_SIZE), old_entries(NULL), old_size(
+					0), migrate_index(0), migrate_step(0), executor(NULL) {
+		entries = allocateEntries(INITIAL_SIZE);
+	}
+
+	// Name			: SetIncrementalResize
+	// Description	: Selects how the map is resized. With a zero step every
+	//					resize moves all the mappings at once (the default).
+	//					Otherwise the old entries are kept until they're all
+	//					moved, and each Insert/Delete moves up to @step of them.
+	// Parameters	:
+	//	@step - number of old entries to move per operation
+	// Return Value : None
+	// 	If the step is negative, HashMapInvalidArgException will be thrown.
+	void SetIncrementalResize(int step) {
+		if (step < 0) {
+			throw HashMapInvalidArgException();
+		}
+
+		migrate_step = step;
+		if (migrate_step == 0) {
+			finishMigration();
+		}
+	}
+
+	// Name			: SetExecutor
+	// Description	: Sets the executor which splits the whole-table
+	//					operations of a large map between threads: a full
+	//					resize, BulkLoad, the destructor and ParallelForEach.
+	//					BulkLoad and the destructor only use it when the
+	//					allocator is thread safe (see AllocatorThreadSafety).
+	//					The operations of the map still must not run
+	//					concurrently.
+	// Parameters	:
+	//	@new_executor - the executor, it must outlive it's use by the map.
+	//					NULL runs everything on the calling thread.
+	// Return Value : None
+	void SetExecutor(Executor* new_executor) {
+		executor = new_executor;
+	}
+
+	// Name			: SetLoadFactorPolicy
+	// Description	: Replaces the thresholds which decide when the map grows
+	//					and shrinks. The new policy is applied by the next
+	//					Insert/Delete.
+	// Parameters	:
+	//	@new_policy - the new policy
+	// Return Value : None
+	// 	If the policy could make the map grow and shrink back to back,
+	// HashMapInvalidArgException will be thrown.
+	void SetLoadFactorPolicy(const LoadFactorPolicy& new_policy) {
+		if (new_policy.isValid(INCREASE_FACTOR) == false) {
+			throw HashMapInvalidArgException();
+		}
+
+		policy = new_policy;
+	}
+
+	// Name			: Reserve
+	// Description	: Resizes the map at once to hold the given number of
+	//					mappings without further growing, and keeps it from
+	//					shrinking under that size until ShrinkToFit is called.
+	// Parameters	:
+	//	@count - the expected number of mappings
+	// Return Value : None
+	// 	If the count is negative, HashMapInvalidArgException will be thrown.
+	void Reserve(int count) {
+		if (count < 0) {
+			throw HashMapInvalidArgException();
+		}
+
+		int new_size = (int) policy.MinimalSize(count, INITIAL_SIZE);
+		if (new_size > min_size) {
+			min_size = new_size;
+		}
+		if (new_size > _size) {
+			Resize(new_size);
+			finishMigration();
+		}
+	}
+
+	// Name			: ShrinkToFit
+	// Description	: Resizes the map at once to the smallest size which holds
+	//					it's mappings, and cancels the effect of Reserve.
+	// Parameters	: None
+	// Return Value : None
+	void ShrinkToFit() {
+		min_size = INITIAL_SIZE;
+
+		int new_size = (int) policy.MinimalSize(_count, INITIAL_SIZE);
+		if (new_size < _size) {
+			Resize(new_size);
+			finishMigration();
+		}
+	}
+
+	// Name			: BulkLoad
+	// Description	: Inserts many mappings at once. The map is resized once
+	//					up front, and the values are moved into it. With an
+	//					executor and a thread safe allocator the mappings are
+	//					inserted by it's threads.
+	// Parameters	:
+	//	@keys	- the keys
+	//	@values	- the values, in the order of the keys
+	//	@count	- number of mappings
+	// Return Value : None
+	// 	If the count is negative, HashMapInvalidArgException will be thrown.
+	// If a key already exists, HashMapKeyAlreadyExistsException will be
+	// thrown, and the mappings before it stay in the map. A parallel load
+	// inserts all the other mappings first.
+	void BulkLoad(const K* keys, V* values, int count) {
+		if (count < 0 || (count > 0 && (keys == NULL || values == NULL))) {
+			throw HashMapInvalidArgException();
+		}
+
+		finishMigration();
+		int new_size = (int) policy.MinimalSize(_count + count, INITIAL_SIZE);
+		if (new_size > _size) {
+			Resize(new_size);
+			finishMigration();
+		}
+
+		if (AllocatorThreadSafety<Allocator>::value && useExecutor(count)) {
+			bulkLoadParallel(keys, values, count);
+			return;
+		}
+
+		for (int i = 0; i < count; i++) {
+			if (emplaceValue(keys[i], std::move(values[i])).second == false) {
+				Stats::RecordException();
+				throw HashMapKeyAlreadyExistsException();
+			}
+		}
 	}
 
 	// Name			: Insert
@@ -120,22 +1357,83 @@ public:
 	// 	If the key already exist, HashMapKeyAlreadyExistsException will be
 	// thrown.
 	V* Insert(K key, const V& obj) {
-		if (Contains(key)) {
+		return Emplace(std::move(key), obj);
+	}
+
+	// Name			: Insert
+	// Description	: This function inserts an element to the map, and moves
+	//					the given object into it
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@data 	-  value to be associated with the specified key
+	// Return Value : Reference to the inserted object
+	// 	If the key already exist, HashMapKeyAlreadyExistsException will be
+	// thrown.
+	V* Insert(K key, V&& obj) {
+		return Emplace(std::move(key), std::move(obj));
+	}
+
+	// Name			: Emplace
+	// Description	: Inserts an element to the map, which is constructed in
+	//					place from the given arguments.
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@args 	- the arguments of the value constructor
+	// Return Value : Reference to the inserted object
+	// 	If the key already exist, HashMapKeyAlreadyExistsException will be
+	// thrown.
+	template<class ... Args>
+	V* Emplace(K key, Args&&... args) {
+		std::pair<V*, bool> res = emplaceValue(std::move(key),
+				std::forward<Args>(args)...);
+		if (res.second == false) {
+			Stats::RecordException();
 			throw HashMapKeyAlreadyExistsException();
 		}
 
-		int entry_index = hashFunction(key);
-		V* to_add = new V(obj);
-		
-		
-		// Key doesn't exist for sure, no need to use try/catch blocks
-		// Insert the pointer to the tree
-		entries[entry_index].Insert(key, to_add);
-		_count++;
+		loadFactorCheckAndResize(true);
+		return res.first;
+	}
+
+	// Name			: InsertOrAssign
+	// Description	: Inserts an element to the map, or assigns the given
+	//					object to the existing element with the same key.
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@obj 	- value to be associated with the specified key, copied or
+	//				moved
+	// Return Value : true if the element was inserted, false if assigned
+	template<class Value>
+	bool InsertOrAssign(K key, Value&& obj) {
+		std::pair<V*, bool> res = emplaceValue(std::move(key),
+				std::forward<Value>(obj));
+		if (res.second == false) {
+			*res.first = std::forward<Value>(obj);
+			return false;
+		}
+
+		loadFactorCheckAndResize(true);
+		return true;
+	}
 
-		loadFactorCheckAndResize();
+	// Name			: TryEmplace
+	// Description	: Inserts an element to the map if the key doesn't exist.
+	//					Otherwise the map isn't changed, and the arguments
+	//					aren't used.
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@args 	- the arguments of the value constructor
+	// Return Value : A pair of a pointer to the element with the given key,
+	//					and whether it was inserted by this call
+	template<class ... Args>
+	std::pair<V*, bool> TryEmplace(K key, Args&&... args) {
+		std::pair<V*, bool> res = emplaceValue(std::move(key),
+				std::forward<Args>(args)...);
 
-		return to_add;
+		if (res.second == true) {
+			loadFactorCheckAndResize(true);
+		}
+		return res;
 	}
 
 	// Name			: Delete
@@ -145,21 +1443,138 @@ public:
 	// Return Value : None, if the key wasn't found a suitable exception will
 	// be thrown (HashMapKeyNotFoundException).
 	void Delete(const K & key) {
-		if (!Contains(key)) {
+		if (eraseKey(key) == false) {
+			Stats::RecordException();
 			throw HashMapKeyNotFoundException();
 		}
+	}
 
-		int entry_index = hashFunction(key);
+	// Name			: Delete
+	// Description	: Delete, by a key-like object (see IsHashKeyLike)
+	// Parameters	:
+	//	@key - compares equal to the key whose mapping is to be removed
+	// Return Value : None, if the key wasn't found a suitable exception will
+	// be thrown (HashMapKeyNotFoundException).
+	template<class Key>
+	typename std::enable_if<IsHashKeyLike<Hash, K, Key>::value>::type Delete(
+			const Key& key) {
+		if (eraseKey(key) == false) {
+			Stats::RecordException();
+			throw HashMapKeyNotFoundException();
+		}
+	}
 
-		// Key exists for sure, no need to use try/catch blocks
-		// Delete the pointer and then delete from the tree
-		auto tree_it = entries[entry_index].Find(key);
-		delete *tree_it;
-		entries[entry_index].Delete(key);
-		_count--;
+	// Name			: Erase
+	// Description	: Removes the mapping for the specified key from this map
+	//					if present.
+	// Parameters	:
+	//	@key - key whose mapping is to be removed from the map
+	// Return Value : true if the mapping was removed, false if the key
+	//					wasn't found
+	bool Erase(const K & key) {
+		return eraseKey(key);
+	}
+
+	// Name			: Erase
+	// Description	: Erase, by a key-like object (see IsHashKeyLike)
+	// Parameters	:
+	//	@key - compares equal to the key whose mapping is to be removed
+	// Return Value : true if the mapping was removed, false if the key
+	//					wasn't found
+	template<class Key>
+	typename std::enable_if<IsHashKeyLike<Hash, K, Key>::value, bool>::type Erase(
+			const Key& key) {
+		return eraseKey(key);
+	}
+
+	// Name			: EraseIf
+	// Description	: Removes all the mappings which match a predicate, in
+	//					one sweep. Every entry is compacted at once (see
+	//					AVLTree::EraseIf), and the map shrinks once at the
+	//					end, straight to the size which fits the remaining
+	//					mappings. A resize in progress is completed first.
+	//					With an executor and a thread safe allocator the
+	//					entries of a large map are swept by it's threads.
+	// Parameters	:
+	//	@predicate - callable, invoked as predicate(key, value) for each
+	//				mapping, returns true for the mappings to remove. On the
+	//				executor it's shared by the threads, and must be safe to
+	//				call concurrently.
+	// Return Value : the number of removed mappings
+	//	If the predicate throws, the mappings it wasn't called for stay in
+	// the map, and the exception is rethrown.
+	template<class Predicate>
+	int EraseIf(Predicate predicate) {
+		finishMigration();
+
+		EraseTask<Predicate> task(this, predicate);
+		try {
+			if (AllocatorThreadSafety<Allocator>::value
+					&& useExecutor(_size)) {
+				executor->ParallelFor(task, _size, PARALLEL_GRAIN);
+			} else {
+				task.Run(0, _size);
+			}
+		} catch (...) {
+			_count -= task.getRemoved();
+			throw;
+		}
+
+		int removed = task.getRemoved();
+		for (int i = 0; i < removed; i++) {
+			Stats::RecordErase(true);
+		}
+		_count -= removed;
+
+		shrinkToCount();
+		return removed;
+	}
+
+	// Name			: DeleteBatch
+	// Description	: Removes the mappings of many keys at once. The entries
+	//					of every group of keys are prefetched before they're
+	//					removed from, as in FindBatch, and the map shrinks
+	//					once at the end instead of after every removal.
+	// Parameters	:
+	//	@keys	- the keys to remove, the missing ones are skipped
+	//	@count	- number of keys
+	//	@erased	- optional, receives true for every key which was removed
+	// Return Value : the number of removed mappings
+	// 	If the count is negative, HashMapInvalidArgException will be thrown.
+	int DeleteBatch(const K* keys, int count, bool* erased = NULL) {
+		if (count < 0 || (count > 0 && keys == NULL)) {
+			throw HashMapInvalidArgException();
+		}
+
+		size_t hashes[BATCH_GROUP];
+		int res = 0;
+
+		for (int first = 0; first < count; first += BATCH_GROUP) {
+			int group = (count - first < BATCH_GROUP) ?
+					count - first : BATCH_GROUP;
 
-		loadFactorCheckAndResize();
+			prefetchGroup(keys + first, group, hashes);
+			for (int i = 0; i < group; i++) {
+				int entry_index = prepareEntry(hashes[i]);
+				bool removed = entries[entry_index].Erase(keys[first + i]);
 
+				Stats::RecordErase(removed);
+				if (removed == true) {
+					res++;
+					_count--;
+					// A resize in progress still advances per removal
+					if (old_entries != NULL) {
+						migrateStep();
+					}
+				}
+				if (erased != NULL) {
+					erased[first + i] = removed;
+				}
+			}
+		}
+
+		shrinkToCount();
+		return res;
 	}
 
 	// Name			: Find
@@ -170,15 +1585,180 @@ public:
 	//					If no such element is found, an exception would be
 	// 					thrown.
 	V& Find(const K& key) const {
-		if (!Contains(key)) {
+		V* value = TryFind(key);
+		if (value == NULL) {
+			Stats::RecordException();
 			throw HashMapKeyNotFoundException();
 		}
 
-		int entry_index = hashFunction(key);
+		return *value;
+	}
 
-		// Key exists for sure, no need to use try/catch blocks
-		auto tree_it = entries[entry_index].Find(key);
-		return *(*tree_it);
+	// Name			: Find
+	// Description	: Find, by a key-like object (see IsHashKeyLike), which
+	//					is hashed and compared without constructing a key.
+	// Parameters	:
+	//	key - compares equal to the key of the element to search for
+	// Return Value : Reference to the element, if no such element is found
+	//					an exception would be thrown.
+	template<class Key>
+	typename std::enable_if<IsHashKeyLike<Hash, K, Key>::value, V&>::type Find(
+			const Key& key) const {
+		V* value = TryFind(key);
+		if (value == NULL) {
+			Stats::RecordException();
+			throw HashMapKeyNotFoundException();
+		}
+
+		return *value;
+	}
+
+	// Name			: TryFind
+	// Description	: Finds an element with key equivalent to key, without
+	//					throwing on a miss.
+	// Parameters	:
+	//	key - key value of the element to search for
+	// Return Value : Pointer to the element with key equivalent to key, or
+	//					NULL if no such element is found.
+	V* TryFind(const K& key) const {
+		return findHashed(key, hasher(key));
+	}
+
+	// Name			: TryFind
+	// Description	: TryFind, by a key-like object (see IsHashKeyLike)
+	// Parameters	:
+	//	key - compares equal to the key of the element to search for
+	// Return Value : Pointer to the element, or NULL if no such element is
+	//					found.
+	template<class Key>
+	typename std::enable_if<IsHashKeyLike<Hash, K, Key>::value, V*>::type TryFind(
+			const Key& key) const {
+		return findHashed(key, hasher(key));
+	}
+
+	// Name			: FindBatch
+	// Description	: Finds the elements of many keys at once. The keys are
+	//					taken in groups, and the memory of a whole group is
+	//					prefetched before it's searched: first the entries,
+	//					then the roots of their trees. The cache misses of a
+	//					group overlap, instead of following one another.
+	// Parameters	:
+	//	@keys	- the keys to search
+	//	@count	- number of keys
+	//	@out	- receives a pointer to the element of every key, or NULL
+	//				if it's not in the map
+	// Return Value : the number of keys found
+	// 	If the count is negative, HashMapInvalidArgException will be thrown.
+	int FindBatch(const K* keys, int count, V** out) const {
+		if (count < 0 || (count > 0 && (keys == NULL || out == NULL))) {
+			throw HashMapInvalidArgException();
+		}
+
+		ValueOutput output = { out };
+		return lookupBatch(keys, count, output);
+	}
+
+	// Name			: ContainsBatch
+	// Description	: Tests many keys at once, the way FindBatch searches
+	//					them.
+	// Parameters	:
+	//	@keys	- the keys to test
+	//	@count	- number of keys
+	//	@out	- receives true for every key which is in the map
+	// Return Value : the number of keys found
+	// 	If the count is negative, HashMapInvalidArgException will be thrown.
+	int ContainsBatch(const K* keys, int count, bool* out) const {
+		if (count < 0 || (count > 0 && (keys == NULL || out == NULL))) {
+			throw HashMapInvalidArgException();
+		}
+
+		FlagOutput output = { out };
+		return lookupBatch(keys, count, output);
+	}
+
+	// Name			: InsertBatch
+	// Description	: Inserts many mappings at once, skipping the keys which
+	//					already exist. The map grows once up front, and the
+	//					entries of every group of keys are prefetched before
+	//					they're inserted into.
+	// Parameters	:
+	//	@keys		- the keys
+	//	@values		- the values, in the order of the keys, copied
+	//	@count		- number of mappings
+	//	@inserted	- optional, receives true for every key which was
+	//					inserted and false for the existing ones
+	// Return Value : the number of inserted mappings
+	// 	If the count is negative, HashMapInvalidArgException will be thrown.
+	// If memory allocation failes, the mappings before the failed one stay
+	// in the map.
+	int InsertBatch(const K* keys, const V* values, int count,
+			bool* inserted = NULL) {
+		if (count < 0 || (count > 0 && (keys == NULL || values == NULL))) {
+			throw HashMapInvalidArgException();
+		}
+
+		// In incremental mode the table keeps growing step by step
+		if (migrate_step == 0) {
+			int new_size = (int) policy.MinimalSize(_count + count, _size);
+			if (new_size > _size) {
+				Resize(new_size);
+			}
+		}
+
+		size_t hashes[BATCH_GROUP];
+		int res = 0;
+
+		for (int first = 0; first < count; first += BATCH_GROUP) {
+			int group = (count - first < BATCH_GROUP) ?
+					count - first : BATCH_GROUP;
+
+			prefetchGroup(keys + first, group, hashes);
+			for (int i = 0; i < group; i++) {
+				bool added = emplaceHashed(hashes[i], keys[first + i],
+						values[first + i]).second;
+				if (added == true) {
+					res++;
+					loadFactorCheckAndResize(true);
+				}
+				if (inserted != NULL) {
+					inserted[first + i] = added;
+				}
+			}
+		}
+		return res;
+	}
+
+	// Name			: InsertRange
+	// Description	: Inserts the mappings of a range, skipping the keys
+	//					which already exist, and the repeated keys of the
+	//					range after their first mapping. The range is read
+	//					once, so it may be a stream. The map is resized once
+	//					up front, the mappings are partitioned by entry and
+	//					sorted by key, and an empty entry builds it's tree
+	//					in one linear pass with no rebalancing. With an
+	//					executor and a thread safe allocator the entries
+	//					are filled by it's threads.
+	// Parameters	:
+	//	@first	- the first mapping, a pair-like object with first (the
+	//				key) and second (the value)
+	//	@last	- the end of the range
+	// Return Value : the number of inserted mappings
+	// If memory allocation failes, some of the mappings may stay in the
+	// map, and the others are dropped.
+	template<class InputIterator>
+	int InsertRange(InputIterator first, InputIterator last) {
+		std::vector<K> keys;
+		std::vector<V> values;
+
+		size_t length = RangeLengthHint(first, last);
+
+		keys.reserve(length);
+		values.reserve(length);
+		for (; first != last; ++first) {
+			keys.push_back(first->first);
+			values.push_back(first->second);
+		}
+		return ingest(keys, values);
 	}
 
 	// Name			: isEmpty
@@ -195,15 +1775,18 @@ public:
 	//	key - The key whose presence in this map is to be tested
 	// Return Value : true if this map contains a mapping for the specified key
 	bool Contains(const K& key) const {
-		int entry_index = hashFunction(key);
-
-		try {
-			entries[entry_index].Find(key);
-		} catch (AVLTreeKeyNotFoundException&) {
-			return false;
-		}
+		return (TryFind(key) != NULL);
+	}
 
-		return true;
+	// Name			: Contains
+	// Description	: Contains, by a key-like object (see IsHashKeyLike)
+	// Parameters	:
+	//	key - compares equal to the key whose presence is to be tested
+	// Return Value : true if this map contains a mapping for the key
+	template<class Key>
+	typename std::enable_if<IsHashKeyLike<Hash, K, Key>::value, bool>::type Contains(
+			const Key& key) const {
+		return (TryFind(key) != NULL);
 	}
 
 	// Name			: getSize
@@ -214,24 +1797,115 @@ public:
 		return _count;
 	}
 
+	// Name			: GetStats
+	// Description	: Returns the counters of the statistics policy, and the
+	//					state of the table. With NoStats only the state is
+	//					set.
+	// Parameters	: None
+	// Return Value : a copy of the counters
+	StatsSnapshot GetStats() const {
+		StatsSnapshot res = Stats::Snapshot();
+
+		res.size = _count;
+		res.buckets = _size;
+		res.load_factor = (double) _count / (double) _size;
+		return res;
+	}
+
+	// Name			: getHasher
+	// Description	: Returns the hash functor of the map
+	// Parameters	: None
+	// Return Value : the hash functor
+	const Hash& getHasher() const {
+		return hasher;
+	}
+
+	// Name			: Diagnostics
+	// Description	: Examines the entries in one pass: the distribution of
+	//					their sizes, the heights of their trees, the
+	//					uniformity of the hash and the hottest entries. The
+	//					heights are kept in the tree roots, so an entry
+	//					costs O(1), and a stride samples the entries of a
+	//					large map. During an incremental resize only the new
+	//					entries are examined.
+	// Parameters	:
+	//	@top	- number of hottest entries to report
+	//	@stride	- examines every stride-th entry, 1 examines all of them
+	// Return Value : the diagnostics
+	// 	If top is negative or stride isn't positive,
+	// HashMapInvalidArgException will be thrown.
+	HashMapDiagnostics Diagnostics(int top = DEFAULT_TOP_BUCKETS,
+			int stride = 1) const {
+		if (top < 0 || stride < 1) {
+			throw HashMapInvalidArgException();
+		}
+
+		HashMapDiagnostics res;
+		res.buckets = _size;
+		res.stride = stride;
+		if (old_entries != NULL) {
+			res.unmigrated_buckets = old_size - migrate_index;
+		}
+
+		DiagnosticsCollector collector(&res, top);
+		for (int i = 0; i < _size; i += stride) {
+			collector.Add(i, entries[i].getSize(), entries[i].getHeight());
+		}
+		collector.Finish();
+		return res;
+	}
+
+	// Name			: ParallelForEach
+	// Description	: Visits every mapping of the map. With an executor the
+	//					entries of a large map are visited by it's threads at
+	//					once. The order is unspecified, and the map must not
+	//					be changed during the scan.
+	// Parameters	:
+	//	@visitor - callable, invoked as visitor(key, value) for each
+	//				mapping. It's shared by the threads, and must be safe to
+	//				call concurrently.
+	// Return Value : None
+	template<class Visitor>
+	void ParallelForEach(Visitor visitor) {
+		int count = _size;
+		if (old_entries != NULL) {
+			count += old_size - migrate_index;
+		}
+
+		VisitTask<Visitor> task(this, visitor);
+		if (useExecutor(count)) {
+			executor->ParallelFor(task, count, PARALLEL_GRAIN);
+		} else {
+			task.Run(0, count);
+		}
+	}
+
 	// HashMap destructor
 	~HashMap() {
-		// Delete the pointers in all the tree nodes
-		// Then, destroy all the entries
-		for (int i = 0; i < _size; i++) {
-			int tree_size = entries[i].getSize();
-			V*** tree_data = entries[i].inOrderExtractData();
-			// The above array cointains pointers to pointers of V type
+		int allocator_copies = _size + 1;
+		if (old_entries != NULL) {
+			allocator_copies += old_size;
+		}
 
-			for (int j = 0; j < tree_size; j++) {
-				delete *(tree_data[j]);
-			}
-			
-			delete[] tree_data;
+		// Values and keys which need no destructor are left to the
+		// allocator, if it can release all of them at once. The map holds
+		// one copy of the allocator, and every bucket holds another one.
+		// The buckets see the released pool, and skip their nodes.
+		if (std::is_trivially_destructible<V>::value
+				&& std::is_trivially_destructible<K>::value) {
+			AllocatorBulkRelease<Allocator>::Release(alloc, allocator_copies);
 		}
 
-		
-		delete[] entries;
+		// The nodes are deleted by the executor's threads, the serial pass
+		// below only destroys the empty buckets
+		if (AllocatorThreadSafety<Allocator>::value && useExecutor(_size)) {
+			ClearTask task(entries);
+			executor->ParallelFor(task, _size, PARALLEL_GRAIN);
+		}
+		destroyEntries(entries, _size);
+		if (old_entries != NULL) {
+			destroyEntries(old_entries, old_size);
+		}
 	}
 };
 
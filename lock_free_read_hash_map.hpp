@@ -0,0 +1,569 @@
+#ifndef LOCK_FREE_READ_HASH_MAP_HPP_
+#define LOCK_FREE_READ_HASH_MAP_HPP_
+
+//
+//	File		: lock_free_read_hash_map.hpp
+//	Description	: Hash map for read mostly workloads, whose lookups take
+//					no lock and write no shared memory.
+//					The buckets are atomic heads of singly linked chains.
+//					A node's key and value never change after it's
+//					published: InsertOrAssign links a new node in place of
+//					the old one, and a resize publishes a new table of new
+//					nodes. Writers are serialized by a mutex. Unlinked
+//					nodes and tables are retired, and freed only when no
+//					reader can still be on them (epoch.hpp).
+//
+
+#include <exception>
+#include "exceptions.hpp"
+#include "epoch.hpp"
+#include "hash.hpp"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+template<typename V, class K, class Hash = DefaultHash<K>,
+		class Allocator = std::allocator<V> >
+class LockFreeReadHashMap {
+	//
+	//	Class		: LockFreeReadHashMap
+	//	Description : Find, TryFind, Contains and Visit run concurrently
+	//					with each other and with one writer, and never wait.
+	//					They return copies of the values, or visit them, since
+	//					the node may be retired once the reader leaves it.
+	//					The keys and values must be copy constructible, a
+	//					resize copies them to the new table.
+	//					The allocator is only used by writers, under the
+	//					writers' mutex.
+
+private:
+	//
+	// Constants
+	//
+	static const size_t INITIAL_SIZE = 16;
+	static const int INCREASE_FACTOR = 2;
+	// Grows when the number of mappings passes 3/4 of the buckets
+	static const size_t MAX_LOAD_NUMERATOR = 3;
+	static const size_t MAX_LOAD_DENOMINATOR = 4;
+	// Retired memory is reclaimed every so many retirements
+	static const size_t RECLAIM_THRESHOLD = 64;
+
+	struct Node {
+		const K key;
+		const V value;
+		const size_t hash;
+		std::atomic<Node*> next;
+
+		template<class KeyArg, class ... Args>
+		Node(size_t hash, Node* next, KeyArg&& key, Args&&... args) :
+				key(std::forward<KeyArg>(key)), value(
+						std::forward<Args>(args)...), hash(hash), next(next) {
+		}
+	};
+
+	struct Table {
+		size_t mask;
+		std::atomic<Node*>* buckets;
+	};
+
+	struct Retired {
+		Node* node;
+		Table* table;
+		uint64_t epoch;
+	};
+
+	typedef std::allocator_traits<Allocator> AllocatorTraits;
+	typedef typename AllocatorTraits::template rebind_alloc<Node> NodeAllocator;
+	typedef std::allocator_traits<NodeAllocator> NodeAllocatorTraits;
+	typedef typename AllocatorTraits::template rebind_alloc<Table> TableAllocator;
+	typedef std::allocator_traits<TableAllocator> TableAllocatorTraits;
+	typedef typename AllocatorTraits::template rebind_alloc<std::atomic<Node*> > BucketsAllocator;
+	typedef std::allocator_traits<BucketsAllocator> BucketsAllocatorTraits;
+
+	std::atomic<Table*> table;
+	std::atomic<int> _count;
+	Hash hasher;
+	Allocator alloc;
+	std::mutex write_lock;
+	std::vector<Retired> retired;
+
+	LockFreeReadHashMap(const LockFreeReadHashMap&);
+	LockFreeReadHashMap& operator=(const LockFreeReadHashMap&);
+
+	// Name			: createNode / destroyNode
+	// Description	: Allocates a published node / frees a node no reader
+	//					can reach
+	// If memory allocation failes, a matching exception would be thrown by
+	//	the system.
+	template<class ... Args>
+	Node* createNode(Args&&... args) {
+		NodeAllocator node_alloc(alloc);
+		Node* node = NodeAllocatorTraits::allocate(node_alloc, 1);
+		try {
+			NodeAllocatorTraits::construct(node_alloc, node,
+					std::forward<Args>(args)...);
+		} catch (...) {
+			NodeAllocatorTraits::deallocate(node_alloc, node, 1);
+			throw;
+		}
+		return node;
+	}
+
+	void destroyNode(Node* node) {
+		NodeAllocator node_alloc(alloc);
+		NodeAllocatorTraits::destroy(node_alloc, node);
+		NodeAllocatorTraits::deallocate(node_alloc, node, 1);
+	}
+
+	// Name			: createTable
+	// Description	: Allocates a table of empty buckets
+	// Parameters	:
+	//	@size - number of buckets, a power of two
+	// Return Value : the new table
+	// If memory allocation failes, a matching exception would be thrown by
+	//	the system.
+	Table* createTable(size_t size) {
+		TableAllocator table_alloc(alloc);
+		BucketsAllocator buckets_alloc(alloc);
+
+		std::atomic<Node*>* buckets = BucketsAllocatorTraits::allocate(
+				buckets_alloc, size);
+		Table* res;
+		try {
+			res = TableAllocatorTraits::allocate(table_alloc, 1);
+		} catch (...) {
+			BucketsAllocatorTraits::deallocate(buckets_alloc, buckets, size);
+			throw;
+		}
+
+		for (size_t i = 0; i < size; i++) {
+			new (&buckets[i]) std::atomic<Node*>(NULL);
+		}
+		res->mask = size - 1;
+		res->buckets = buckets;
+		return res;
+	}
+
+	// Name			: destroyTable
+	// Description	: Frees a table, and optionally the nodes of it's chains
+	// Parameters	:
+	//	@old_table	- the table
+	//	@with_nodes	- true to free the nodes as well
+	// Return Value : None
+	void destroyTable(Table* old_table, bool with_nodes) {
+		size_t size = old_table->mask + 1;
+
+		for (size_t i = 0; i < size; i++) {
+			if (with_nodes == true) {
+				Node* node = old_table->buckets[i].load(
+						std::memory_order_relaxed);
+				while (node != NULL) {
+					Node* next = node->next.load(std::memory_order_relaxed);
+					destroyNode(node);
+					node = next;
+				}
+			}
+			old_table->buckets[i].~atomic();
+		}
+
+		TableAllocator table_alloc(alloc);
+		BucketsAllocator buckets_alloc(alloc);
+		BucketsAllocatorTraits::deallocate(buckets_alloc, old_table->buckets,
+				size);
+		TableAllocatorTraits::deallocate(table_alloc, old_table, 1);
+	}
+
+	// Name			: retire
+	// Description	: Queues unlinked memory until no reader can be on it, and
+	//					reclaims the queue now and then. Called by writers.
+	// Parameters	:
+	//	@node		- an unlinked node, or NULL
+	//	@old_table	- an unpublished table, whose nodes are retired with
+	//					it, or NULL
+	// Return Value : None
+	void retire(Node* node, Table* old_table) {
+		Retired item;
+		item.node = node;
+		item.table = old_table;
+		item.epoch = EpochDomain::Retire();
+		retired.push_back(item);
+
+		if (retired.size() >= RECLAIM_THRESHOLD) {
+			reclaim();
+		}
+	}
+
+	// Name			: reclaim
+	// Description	: Frees the retired memory which no reader can reach.
+	//					Called by writers.
+	// Parameters	: None
+	// Return Value : None
+	void reclaim(void) {
+		uint64_t min_active = EpochDomain::MinActive();
+		size_t kept = 0;
+
+		for (size_t i = 0; i < retired.size(); i++) {
+			if (retired[i].epoch < min_active) {
+				if (retired[i].node != NULL) {
+					destroyNode(retired[i].node);
+				} else {
+					destroyTable(retired[i].table, true);
+				}
+			} else {
+				retired[kept++] = retired[i];
+			}
+		}
+		retired.resize(kept);
+	}
+
+	// Name			: findNode
+	// Description	: Searches the node of the given key. Run by readers
+	//					(inside an EpochGuard) and writers.
+	// Parameters	:
+	//	@key	- the key
+	//	@hash	- the hash of the key
+	// Return Value : the node, NULL if the key isn't in the map
+	const Node* findNode(const K& key, size_t hash) const {
+		Table* current = table.load(std::memory_order_acquire);
+		Node* node = current->buckets[hash & current->mask].load(
+				std::memory_order_acquire);
+
+		while (node != NULL) {
+			if (node->hash == hash && node->key == key) {
+				return node;
+			}
+			node = node->next.load(std::memory_order_acquire);
+		}
+		return NULL;
+	}
+
+	// Name			: findLink
+	// Description	: Searches the link which points to the node of the given
+	//					key. Called by writers.
+	// Parameters	:
+	//	@key	- the key
+	//	@hash	- the hash of the key
+	// Return Value : the link, or the end link (which holds NULL) of the
+	//					key's chain if the key isn't in the map
+	std::atomic<Node*>* findLink(const K& key, size_t hash) {
+		Table* current = table.load(std::memory_order_relaxed);
+		std::atomic<Node*>* link = &current->buckets[hash & current->mask];
+
+		for (Node* node = link->load(std::memory_order_relaxed); node != NULL;
+				node = link->load(std::memory_order_relaxed)) {
+			if (node->hash == hash && node->key == key) {
+				break;
+			}
+			link = &node->next;
+		}
+		return link;
+	}
+
+	// Name			: resize
+	// Description	: Publishes a table of the given size, holding copies of
+	//					all the nodes, and retires the old one. Called by
+	//					writers.
+	// Parameters	:
+	//	@new_size - the number of buckets, a power of two
+	// Return Value : None
+	void resize(size_t new_size) {
+		Table* old_table = table.load(std::memory_order_relaxed);
+		Table* new_table = createTable(new_size);
+
+		try {
+			for (size_t i = 0; i <= old_table->mask; i++) {
+				for (Node* node = old_table->buckets[i].load(
+						std::memory_order_relaxed); node != NULL;
+						node = node->next.load(std::memory_order_relaxed)) {
+					std::atomic<Node*>& bucket = new_table->buckets[node->hash
+							& new_table->mask];
+					bucket.store(
+							createNode(node->hash,
+									bucket.load(std::memory_order_relaxed),
+									node->key, node->value),
+							std::memory_order_relaxed);
+				}
+			}
+		} catch (...) {
+			destroyTable(new_table, true);
+			throw;
+		}
+
+		table.store(new_table, std::memory_order_release);
+		retire(NULL, old_table);
+	}
+
+	// Name			: growIfNeeded
+	// Description	: Grows the table before a new mapping is added, if the
+	//					mapping would pass the maximal load. Called by writers.
+	void growIfNeeded(void) {
+		size_t size = table.load(std::memory_order_relaxed)->mask + 1;
+		size_t count = (size_t) _count.load(std::memory_order_relaxed) + 1;
+
+		if (count * MAX_LOAD_DENOMINATOR > size * MAX_LOAD_NUMERATOR) {
+			resize(size * INCREASE_FACTOR);
+		}
+	}
+
+	// Name			: emplaceValue
+	// Description	: Inserts a mapping, or replaces the existing mapping of
+	//					the key if assign is set. Called by writers.
+	// Parameters	:
+	//	@assign	- true to replace an existing mapping
+	//	@key 	- key with which the specified value is to be associated
+	//	@args 	- the arguments of the value constructor
+	// Return Value : true if a new mapping was inserted
+	template<class ... Args>
+	bool emplaceValue(bool assign, K&& key, Args&&... args) {
+		size_t hash = (size_t) hasher(key);
+		std::atomic<Node*>* link = findLink(key, hash);
+		Node* old_node = link->load(std::memory_order_relaxed);
+
+		if (old_node != NULL) {
+			if (assign == true) {
+				Node* node = createNode(hash,
+						old_node->next.load(std::memory_order_relaxed),
+						std::move(key), std::forward<Args>(args)...);
+				link->store(node, std::memory_order_release);
+				retire(old_node, NULL);
+			}
+			return false;
+		}
+
+		growIfNeeded();
+		Table* current = table.load(std::memory_order_relaxed);
+		std::atomic<Node*>& bucket = current->buckets[hash & current->mask];
+		Node* node = createNode(hash, bucket.load(std::memory_order_relaxed),
+				std::move(key), std::forward<Args>(args)...);
+		bucket.store(node, std::memory_order_release);
+		_count.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+public:
+	// LockFreeReadHashMap constructor
+	explicit LockFreeReadHashMap(const Hash& hash = Hash(),
+			const Allocator& allocator = Allocator()) :
+			_count(0), hasher(hash), alloc(allocator) {
+		table.store(createTable(INITIAL_SIZE), std::memory_order_relaxed);
+	}
+
+	// LockFreeReadHashMap destructor, no other thread may use the map
+	~LockFreeReadHashMap() {
+		for (size_t i = 0; i < retired.size(); i++) {
+			if (retired[i].node != NULL) {
+				destroyNode(retired[i].node);
+			} else {
+				destroyTable(retired[i].table, true);
+			}
+		}
+		destroyTable(table.load(std::memory_order_relaxed), true);
+	}
+
+	// Name			: Reserve
+	// Description	: Grows the table at once to hold the given number of
+	//					mappings without further growing.
+	// Parameters	:
+	//	@count - the expected number of mappings
+	// Return Value : None
+	// 	If the count is negative, HashMapInvalidArgException will be thrown.
+	void Reserve(int count) {
+		if (count < 0) {
+			throw HashMapInvalidArgException();
+		}
+
+		std::lock_guard<std::mutex> guard(write_lock);
+		size_t size = table.load(std::memory_order_relaxed)->mask + 1;
+		size_t new_size = size;
+		while ((size_t) count * MAX_LOAD_DENOMINATOR
+				> new_size * MAX_LOAD_NUMERATOR) {
+			new_size *= INCREASE_FACTOR;
+		}
+		if (new_size > size) {
+			resize(new_size);
+		}
+	}
+
+	// Name			: Insert
+	// Description	: This function inserts an element to the map
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@data 	-  value to be associated with the specified key
+	// Return Value : None
+	// 	If the key already exist, HashMapKeyAlreadyExistsException will be
+	// thrown.
+	void Insert(K key, const V& obj) {
+		if (TryEmplace(std::move(key), obj) == false) {
+			throw HashMapKeyAlreadyExistsException();
+		}
+	}
+
+	// Name			: InsertOrAssign
+	// Description	: Inserts an element to the map, or replaces the existing
+	//					element with the same key. Readers see either the old
+	//					or the new element.
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@obj 	- value to be associated with the specified key, copied or
+	//				moved
+	// Return Value : true if the element was inserted, false if replaced
+	template<class Value>
+	bool InsertOrAssign(K key, Value&& obj) {
+		std::lock_guard<std::mutex> guard(write_lock);
+		return emplaceValue(true, std::move(key), std::forward<Value>(obj));
+	}
+
+	// Name			: TryEmplace
+	// Description	: Inserts an element to the map if the key doesn't exist.
+	//					Otherwise the map isn't changed, and the arguments
+	//					aren't used.
+	// Parameters	:
+	//	@key 	- key with which the specified value is to be associated
+	//	@args 	- the arguments of the value constructor
+	// Return Value : true if the element was inserted by this call
+	template<class ... Args>
+	bool TryEmplace(K key, Args&&... args) {
+		std::lock_guard<std::mutex> guard(write_lock);
+		return emplaceValue(false, std::move(key), std::forward<Args>(args)...);
+	}
+
+	// Name			: Delete
+	// Description	: Removes the mapping for the specified key from this map.
+	// Parameters	:
+	//	@key - key whose mapping is to be removed from the map
+	// Return Value : None, if the key wasn't found a suitable exception will
+	// be thrown (HashMapKeyNotFoundException).
+	void Delete(const K& key) {
+		if (Erase(key) == false) {
+			throw HashMapKeyNotFoundException();
+		}
+	}
+
+	// Name			: Erase
+	// Description	: Removes the mapping for the specified key from this map
+	//					if present. Readers on the removed node still see it
+	//					until they leave it.
+	// Parameters	:
+	//	@key		- key whose mapping is to be removed from the map
+	//	@removed	- if not NULL, receives a copy of the removed value
+	// Return Value : true if the mapping was removed, false if the key
+	//					wasn't found
+	bool Erase(const K& key, V* removed = NULL) {
+		std::lock_guard<std::mutex> guard(write_lock);
+		std::atomic<Node*>* link = findLink(key, (size_t) hasher(key));
+		Node* node = link->load(std::memory_order_relaxed);
+
+		if (node == NULL) {
+			return false;
+		}
+		if (removed != NULL) {
+			*removed = node->value;
+		}
+
+		link->store(node->next.load(std::memory_order_relaxed),
+				std::memory_order_release);
+		_count.fetch_sub(1, std::memory_order_relaxed);
+		retire(node, NULL);
+		return true;
+	}
+
+	// Name			: Reclaim
+	// Description	: Frees the retired memory which no reader can reach any
+	//					more. Writers do it on their own every
+	//					RECLAIM_THRESHOLD retirements.
+	// Parameters	: None
+	// Return Value : None
+	void Reclaim(void) {
+		std::lock_guard<std::mutex> guard(write_lock);
+		reclaim();
+	}
+
+	// Name			: Find
+	// Description	: Finds an element with key equivalent to key, without
+	//					locking.
+	// Parameters	:
+	//	key - key value of the element to search for
+	// Return Value : Copy of the element with key equivalent to key.
+	//					If no such element is found, an exception would be
+	// 					thrown.
+	V Find(const K& key) const {
+		EpochGuard guard;
+		const Node* node = findNode(key, (size_t) hasher(key));
+		if (node == NULL) {
+			throw HashMapKeyNotFoundException();
+		}
+
+		return node->value;
+	}
+
+	// Name			: TryFind
+	// Description	: Copies the element with key equivalent to key, without
+	//					locking or throwing on a miss.
+	// Parameters	:
+	//	key		- key value of the element to search for
+	//	value	- receives a copy of the element
+	// Return Value : true if the element was found
+	bool TryFind(const K& key, V* value) const {
+		EpochGuard guard;
+		const Node* node = findNode(key, (size_t) hasher(key));
+		if (node == NULL) {
+			return false;
+		}
+
+		*value = node->value;
+		return true;
+	}
+
+	// Name			: Contains
+	// Description	: Tests if this map contains a mapping for the specified
+	//					key, without locking.
+	// Parameters	:
+	//	key - The key whose presence in this map is to be tested
+	// Return Value : true if this map contains a mapping for the specified key
+	bool Contains(const K& key) const {
+		EpochGuard guard;
+		return (findNode(key, (size_t) hasher(key)) != NULL);
+	}
+
+	// Name			: Visit
+	// Description	: Calls the visitor on the element of the given key,
+	//					without locking. The element stays valid during the
+	//					call, even if a writer removes it meanwhile.
+	// Parameters	:
+	//	@key		- key value of the element to visit
+	//	@visitor	- callable, invoked as visitor(const V&)
+	// Return Value : true if the element was found
+	template<class Visitor>
+	bool Visit(const K& key, Visitor visitor) const {
+		EpochGuard guard;
+		const Node* node = findNode(key, (size_t) hasher(key));
+		if (node == NULL) {
+			return false;
+		}
+
+		visitor(node->value);
+		return true;
+	}
+
+	// Name			: getSize
+	// Description	: Returns the number of key-value mappings in this map.
+	// Parameters	: None
+	// Return Value : the number of key-value mappings in this map
+	int getSize() const {
+		return _count.load(std::memory_order_relaxed);
+	}
+
+	// Name			: Empty
+	// Description	: This function tests whether the map is empty or not.
+	// Parameters	: None
+	// Return Value : true if this map contains no key-value mappings
+	bool Empty() const {
+		return (getSize() == 0);
+	}
+};
+
+#endif /* LOCK_FREE_READ_HASH_MAP_HPP_ */
@@ -0,0 +1,94 @@
+#ifndef PARALLEL_TASK_HPP_
+#define PARALLEL_TASK_HPP_
+
+//
+//	File		: parallel_task.hpp
+//	Description	: The hook through which the containers split whole-table
+//					operations (resize, destruction, bulk loading and
+//					ParallelForEach) across threads. A container is given
+//					an Executor, and hands it a ParallelTask over a range
+//					of buckets or subtrees. The executor runs the task over
+//					disjoint chunks of the range, and returns when all of
+//					them are done.
+//					The hook is only an interface, so the containers don't
+//					depend on any threading header. ThreadPool, the
+//					built-in executor, is in executor.hpp, and any other
+//					pool can be plugged in by implementing Executor.
+//
+
+#include <cstddef>
+
+//
+//	Class		: ParallelTask
+//	Description : Work which is split into chunks of a range of indices.
+//					Run is called concurrently for disjoint chunks.
+//
+class ParallelTask {
+public:
+	virtual ~ParallelTask() {
+	}
+
+	// Name			: Run
+	// Description	: Processes a chunk of the range
+	// Parameters	:
+	//	@first	- the first index of the chunk
+	//	@last	- the index past the end of the chunk
+	// Return Value : None
+	virtual void Run(int first, int last) = 0;
+};
+
+//
+//	Class		: Executor
+//	Description : Runs a ParallelTask over a range, using any number of
+//					threads, and waits for it. If the task throws, the
+//					chunks which didn't start yet may be skipped, and the
+//					first exception is rethrown to the caller.
+//
+class Executor {
+public:
+	virtual ~Executor() {
+	}
+
+	// Name			: getConcurrency
+	// Description	: Returns the number of threads which run the chunks of
+	//					a task, the caller included.
+	// Parameters	: None
+	// Return Value : the number of threads
+	virtual int getConcurrency() const = 0;
+
+	// Name			: ParallelFor
+	// Description	: Runs the task over [0, count), in chunks of at most
+	//					@grain indices.
+	// Parameters	:
+	//	@task	- the task
+	//	@count	- the size of the range
+	//	@grain	- the maximal chunk size
+	// Return Value : None
+	virtual void ParallelFor(ParallelTask& task, int count, int grain) = 0;
+};
+
+//
+//	Function	: ParallelRun
+//	Description : Runs a task through an optional executor, serially when
+//					there's none. The containers call their executor hook
+//					through it.
+//	Parameters	:
+//	@executor	- the executor, or NULL
+//	@task		- the task
+//	@count		- the size of the range
+//	@grain		- the maximal chunk size
+//	Return Value : None
+inline void ParallelRun(Executor* executor, ParallelTask& task, int count,
+		int grain) {
+	if (count <= 0) {
+		return;
+	}
+
+	if (executor == NULL) {
+		task.Run(0, count);
+	} else {
+		executor->ParallelFor(task, count, grain);
+	}
+}
+
+#endif /* PARALLEL_TASK_HPP_ */
@@ -0,0 +1,868 @@
+#ifndef PERSISTENT_AVLTREE_HPP_
+#define PERSISTENT_AVLTREE_HPP_
+
+//
+//	File		: persistent_avltree.hpp
+//	Description	: AVL tree with immutable versions, for readers which need
+//					a consistent view of a tree while it's written.
+//					Snapshot() returns a Version of the tree in O(1), and
+//					the Version shares all the nodes of the tree. A write
+//					copies only the nodes of it's path (and the siblings a
+//					rebalance rotates), O(log n) nodes, when they are
+//					shared with a version, and changes the nodes no
+//					version holds in place.
+//					The nodes are reference counted - by their parents,
+//					the tree and the versions - and a node is freed when
+//					the last of them drops it, so dropping a version frees
+//					the nodes the tree doesn't share anymore. The nodes
+//					have no parent links, which would tie a node to a
+//					single tree.
+//					The tree is written, and Snapshot() is called, by one
+//					thread at a time. A Version is never changed, so any
+//					number of threads may read it, copy it and drop it
+//					while the tree is written. Dropping the last reference
+//					to a node frees it on the dropping thread, so versions
+//					are dropped on other threads only with a thread safe
+//					allocator (see AllocatorThreadSafety).
+//					The data is copied when it's node is copied, so T
+//					must be copy constructible, and the tree hands out
+//					only const pointers to it.
+//
+
+#include <exception>
+#include "avltree.hpp"
+#include "exceptions.hpp"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+template<class T, typename KeyType, class Allocator = std::allocator<T>,
+		class Compare = DefaultCompare<KeyType> >
+class PersistentAVLTree: private Compare {
+	//
+	//	Class		: PersistentAVLTree
+	//	Description : Compare orders the keys (see DefaultCompare), and the
+	//					tree inherits it, so the empty default takes no
+	//					space.
+	//
+
+protected:
+	//
+	// Constants
+	//
+	static const int LEFT = 0;
+	static const int RIGHT = 1;
+	// An AVL tree of height 64 holds more than 2^44 nodes
+	static const int MAX_HEIGHT = 64;
+	static const int INITIAL_SIZE = 0;
+
+	//
+	//	Class		: Node
+	//	Description : Tree node, shared by the tree and it's versions. The
+	//					reference count is the number of parents, trees and
+	//					versions which hold the node. The node is only used
+	//					by the tree, so it's fields are accessed directly.
+	//
+	class Node {
+	public:
+		Node* _child[2];
+		std::atomic<int> _refs;
+		int _height;
+		KeyType _key;
+		T _data;
+
+		// Node contstructor, the data is constructed in place from the
+		// given arguments
+		template<class Key, class ... Args>
+		explicit Node(Key&& key, Args&&... args) :
+				_refs(1), _height(1), _key(std::forward<Key>(key)), _data(
+						std::forward<Args>(args)...) {
+			_child[LEFT] = _child[RIGHT] = NULL;
+		}
+
+		// Copy of a shared node, which shares the sons of the original.
+		// The sons' reference counts are raised by the tree.
+		Node(const Node& other) :
+				_refs(1), _height(other._height), _key(other._key), _data(
+						other._data) {
+			_child[LEFT] = other._child[LEFT];
+			_child[RIGHT] = other._child[RIGHT];
+		}
+	};
+
+	typedef typename std::allocator_traits<Allocator>::template rebind_alloc<
+			Node> NodeAllocator;
+	typedef std::allocator_traits<NodeAllocator> NodeAllocatorTraits;
+
+	// Name			: height
+	// Description	: Returns the height of a subtree
+	// Parameters	:
+	//	@node - the subtree root, may be NULL
+	// Return Value : the height, 0 for NULL
+	static int height(const Node* node) {
+		return (node == NULL) ? 0 : node->_height;
+	}
+
+	// Name			: updateHeight
+	// Description	: Recomputes the height of a node from it's sons
+	// Parameters	:
+	//	@node - the node, which no version holds
+	// Return Value : None
+	static void updateHeight(Node* node) {
+		int left = height(node->_child[LEFT]);
+		int right = height(node->_child[RIGHT]);
+
+		node->_height = 1 + ((left < right) ? right : left);
+	}
+
+	// Name			: retain
+	// Description	: Adds a reference to a node. The caller already holds
+	//					one, so the order of the increment doesn't matter.
+	// Parameters	:
+	//	@node - the node, may be NULL
+	// Return Value : the node
+	static Node* retain(Node* node) {
+		if (node != NULL) {
+			node->_refs.fetch_add(1, std::memory_order_relaxed);
+		}
+		return node;
+	}
+
+	// Name			: release
+	// Description	: Drops a reference to a node, and frees the node and
+	//					drops it's sons when it was the last one. The
+	//					decrement releases the reads of the dropping thread
+	//					to the thread which frees or changes the node.
+	// Parameters	:
+	//	@node_alloc	- the allocator of the nodes
+	//	@node		- the node, may be NULL
+	// Return Value : None
+	static void release(NodeAllocator& node_alloc, Node* node) {
+		// The right sons are dropped in the loop, so the recursion depth
+		// is at most the height of the tree
+		while (node != NULL
+				&& node->_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			Node* right = node->_child[RIGHT];
+
+			release(node_alloc, node->_child[LEFT]);
+			destroyNode(node_alloc, node);
+			node = right;
+		}
+	}
+
+	// Name			: destroyNode
+	// Description	: Destructs a node and returns it's memory to the
+	//					allocator. It's sons are not dropped.
+	// Parameters	:
+	//	@node_alloc	- the allocator of the nodes
+	//	@node		- the node to destroy
+	// Return Value : None
+	static void destroyNode(NodeAllocator& node_alloc, Node* node) {
+		NodeAllocatorTraits::destroy(node_alloc, node);
+		NodeAllocatorTraits::deallocate(node_alloc, node, 1);
+	}
+
+	// Name			: findNode
+	// Description	: Searches the node of the given key in a subtree
+	// Parameters	:
+	//	@node		- the subtree root, may be NULL
+	//	@compare	- the comparator
+	//	@key		- the key to find
+	// Return Value : the node, or NULL if the key wasn't found
+	static const Node* findNode(const Node* node, const Compare& compare,
+			const KeyType& key) {
+		while (node != NULL) {
+			int order = KeyOrder<Compare, KeyType>::Order(compare, key,
+					node->_key);
+			if (order == 0) {
+				return node;
+			}
+			node = node->_child[(order < 0) ? LEFT : RIGHT];
+		}
+		return NULL;
+	}
+
+	// Name			: scan
+	// Description	: Visits, in key order, the nodes of a subtree whose key
+	//					is in the range [lo, hi). The path to the next node
+	//					is kept in a stack, since the nodes have no parent
+	//					links.
+	// Parameters	:
+	//	@node		- the subtree root, may be NULL
+	//	@compare	- the comparator
+	//	@lo			- the lower bound (inclusive), NULL for no bound
+	//	@hi			- the upper bound (exclusive), NULL for no bound
+	//	@visitor	- callable, invoked as visitor(key, data) for each node
+	// Return Value : the number of visited nodes
+	template<class Visitor>
+	static int scan(const Node* node, const Compare& compare,
+			const KeyType* lo, const KeyType* hi, Visitor& visitor) {
+		const Node* path[MAX_HEIGHT];
+		int depth = 0;
+		int count = 0;
+
+		while (node != NULL) {
+			if (lo != NULL
+					&& KeyOrder<Compare, KeyType>::Less(compare, node->_key,
+							*lo)) {
+				node = node->_child[RIGHT];
+			} else {
+				path[depth++] = node;
+				node = node->_child[LEFT];
+			}
+		}
+		while (depth > 0) {
+			node = path[--depth];
+			if (hi != NULL
+					&& !KeyOrder<Compare, KeyType>::Less(compare, node->_key,
+							*hi)) {
+				break;
+			}
+			visitor(node->_key, node->_data);
+			count++;
+			for (node = node->_child[RIGHT]; node != NULL;
+					node = node->_child[LEFT]) {
+				path[depth++] = node;
+			}
+		}
+		return count;
+	}
+
+	// Name			: isBalancedAux
+	// Description	: Tests the balance factors and the heights of a subtree
+	// Parameters	:
+	//	@node - the subtree root, may be NULL
+	// Return Value : true if the subtree is balanced
+	static bool isBalancedAux(const Node* node) {
+		if (node == NULL) {
+			return true;
+		}
+
+		int left = height(node->_child[LEFT]);
+		int right = height(node->_child[RIGHT]);
+		return (left - right < 2 && right - left < 2
+				&& node->_height == 1 + ((left < right) ? right : left)
+				&& isBalancedAux(node->_child[LEFT])
+				&& isBalancedAux(node->_child[RIGHT]));
+	}
+
+public:
+	//
+	//	Class		: Version
+	//	Description : An immutable version of the tree, as returned by
+	//					Snapshot. Copying a version is O(1), and the copies
+	//					share the nodes.
+	//
+	class Version: private Compare {
+		friend class PersistentAVLTree;
+
+	private:
+		Node* root;
+		int size;
+		NodeAllocator node_alloc;
+
+		// Version constructor, adds a reference to the root
+		Version(Node* root, int size, const NodeAllocator& node_alloc,
+				const Compare& compare) :
+				Compare(compare), root(retain(root)), size(size), node_alloc(
+						node_alloc) {
+		}
+
+		const Compare& compare(void) const {
+			return *this;
+		}
+
+	public:
+		// Version constructor, an empty version
+		Version() :
+				root(NULL), size(INITIAL_SIZE) {
+		}
+
+		// Version copy constructor, shares the nodes
+		Version(const Version& other) :
+				Compare(other), root(retain(other.root)), size(other.size), node_alloc(
+						other.node_alloc) {
+		}
+
+		// Version move constructor, leaves the other version empty
+		Version(Version&& other) :
+				Compare(other), root(other.root), size(other.size), node_alloc(
+						other.node_alloc) {
+			other.root = NULL;
+			other.size = INITIAL_SIZE;
+		}
+
+		Version& operator=(const Version& other) {
+			Version copy(other);
+			Swap(copy);
+			return *this;
+		}
+
+		Version& operator=(Version&& other) {
+			Swap(other);
+			return *this;
+		}
+
+		// Version Destructor, drops the nodes no other version or tree
+		// holds
+		~Version() {
+			release(node_alloc, root);
+		}
+
+		// Name			: Swap
+		// Description	: Exchanges the contents of two versions
+		// Parameters	:
+		//	@other - the other version
+		// Return Value : None
+		void Swap(Version& other) {
+			std::swap(static_cast<Compare&>(*this),
+					static_cast<Compare&>(other));
+			std::swap(root, other.root);
+			std::swap(size, other.size);
+			std::swap(node_alloc, other.node_alloc);
+		}
+
+		// Name			: Find
+		// Description	: Returns the data of the given key
+		// Parameters	:
+		//	@key - the key to find
+		// Return Value : the data of the key
+		// If the key wasn't found, AVLTreeKeyNotFoundException will be thrown.
+		const T& Find(const KeyType& key) const {
+			const Node* node = findNode(root, compare(), key);
+			if (node == NULL) {
+				throw AVLTreeKeyNotFoundException();
+			}
+			return node->_data;
+		}
+
+		// Name			: TryFind
+		// Description	: Searches the data of the given key, without throwing
+		//					on a miss.
+		// Parameters	:
+		//	@key - the key to find
+		// Return Value : pointer to the data, or NULL if the key wasn't found.
+		//					The pointer is valid while the version is held.
+		const T* TryFind(const KeyType& key) const {
+			const Node* node = findNode(root, compare(), key);
+			return (node == NULL) ? NULL : &node->_data;
+		}
+
+		// Name			: Contains
+		// Description	: Tests if the version has the given key
+		// Parameters	:
+		//	@key - the key to find
+		// Return Value : true if the key was found
+		bool Contains(const KeyType& key) const {
+			return (findNode(root, compare(), key) != NULL);
+		}
+
+		// Name			: ForEach
+		// Description	: Visits every node of the version in key order
+		// Parameters	:
+		//	@visitor - callable, invoked as visitor(key, data) for each node
+		// Return Value : None
+		template<class Visitor>
+		void ForEach(Visitor visitor) const {
+			scan(root, compare(), NULL, NULL, visitor);
+		}
+
+		// Name			: RangeScan
+		// Description	: Visits, in key order, every node whose key is in the
+		//					range [lo, hi). It takes O(log n + k) for k
+		//					visited nodes.
+		// Parameters	:
+		//	@lo			- the lower bound (inclusive)
+		//	@hi			- the upper bound (exclusive)
+		//	@visitor	- callable, invoked as visitor(key, data) for each
+		//					node
+		// Return Value : the number of visited nodes
+		template<class Visitor>
+		int RangeScan(const KeyType& lo, const KeyType& hi,
+				Visitor visitor) const {
+			return scan(root, compare(), &lo, &hi, visitor);
+		}
+
+		// Name			: getSize
+		// Description	: Returns the number of nodes in the version
+		// Parameters	: None
+		// Return Value : the number of nodes in the version
+		int getSize(void) const {
+			return size;
+		}
+
+		// Name			: Empty
+		// Description	: Tests if the version has no nodes
+		// Parameters	: None
+		// Return Value : true if the version is empty
+		bool Empty(void) const {
+			return (size == INITIAL_SIZE);
+		}
+	};
+
+protected:
+	//
+	// Members
+	//
+	Node* root;
+	int size;
+	NodeAllocator node_alloc;
+
+	// Name			: createNode
+	// Description	: Allocates and constructs a new node with the tree's
+	//					allocator.
+	// Parameters	:
+	//	@args - the arguments of the Node constructor
+	// Return Value : pointer to the new node
+	template<class ... Args>
+	Node* createNode(Args&&... args) {
+		Node* node = NodeAllocatorTraits::allocate(node_alloc, 1);
+		try {
+			NodeAllocatorTraits::construct(node_alloc, node,
+					std::forward<Args>(args)...);
+		} catch (...) {
+			NodeAllocatorTraits::deallocate(node_alloc, node, 1);
+			throw;
+		}
+		return node;
+	}
+
+	// Name			: compare
+	// Description	: Returns the comparator of the tree
+	// Parameters	: None
+	// Return Value : the comparator
+	const Compare& compare(void) const {
+		return *this;
+	}
+
+	// Name			: own
+	// Description	: Makes the node of a link one which only this tree
+	//					holds, so it may be changed in place. A shared node
+	//					is replaced by a copy, and the original is left to
+	//					the versions which hold it. The links are always
+	//					valid, so a copy which throws leaves the tree as it
+	//					was.
+	// Parameters	:
+	//	@link - the link to the node, in a node this tree owns (or root)
+	// Return Value : the owned node
+	Node* own(Node** link) {
+		Node* node = *link;
+
+		// Acquires the reads of the threads which dropped the node
+		if (node->_refs.load(std::memory_order_acquire) == 1) {
+			return node;
+		}
+
+		Node* copy = createNode(static_cast<const Node&>(*node));
+		retain(copy->_child[LEFT]);
+		retain(copy->_child[RIGHT]);
+		*link = copy;
+		release(node_alloc, node);
+		return copy;
+	}
+
+	// Name			: rotate
+	// Description	: Makes a son of an owned node the root of it's subtree
+	// Parameters	:
+	//	@link	- the link to the node
+	//	@dir	- the side of the son, which is owned too
+	// Return Value : None
+	static void rotate(Node** link, int dir) {
+		Node* node = *link;
+		Node* son = node->_child[dir];
+
+		node->_child[dir] = son->_child[1 - dir];
+		son->_child[1 - dir] = node;
+		updateHeight(node);
+		updateHeight(son);
+		*link = son;
+	}
+
+	// Name			: rebalance
+	// Description	: Updates the height of an owned node whose subtree
+	//					changed, and rotates it if it's balance factor
+	//					became +2 or -2. After an insert the rotated nodes
+	//					are on the path, after a removal the taller sibling
+	//					may be copied.
+	// Parameters	:
+	//	@link - the link to the node
+	// Return Value : None
+	//	If copying a sibling throws, the write is kept and the node stays
+	// out of balance.
+	void rebalance(Node** link) {
+		Node* node = *link;
+		int balance = height(node->_child[RIGHT]) - height(node->_child[LEFT]);
+
+		updateHeight(node);
+		if (balance < 2 && balance > -2) {
+			return;
+		}
+
+		int heavy = (balance > 0) ? RIGHT : LEFT;
+		Node* son = own(&node->_child[heavy]);
+		if (height(son->_child[1 - heavy]) > height(son->_child[heavy])) {
+			// Double rotation - the grandson becomes the subtree root
+			own(&son->_child[1 - heavy]);
+			rotate(&node->_child[heavy], 1 - heavy);
+		}
+		rotate(link, heavy);
+	}
+
+	// Name			: insertAt
+	// Description	: Inserts a new node into a subtree, copying the shared
+	//					nodes of the path. The key must not be in the tree.
+	// Parameters	:
+	//	@link	- the link to the subtree root
+	//	@key	- the key of the new node
+	//	@args	- the arguments of the data constructor
+	// Return Value : None
+	template<class Key, class ... Args>
+	void insertAt(Node** link, Key&& key, Args&&... args) {
+		if (*link == NULL) {
+			*link = createNode(std::forward<Key>(key),
+					std::forward<Args>(args)...);
+			size++;
+			return;
+		}
+
+		Node* node = own(link);
+		int dir = KeyOrder<Compare, KeyType>::Less(compare(), key, node->_key) ?
+				LEFT : RIGHT;
+		insertAt(&node->_child[dir], std::forward<Key>(key),
+				std::forward<Args>(args)...);
+		rebalance(link);
+	}
+
+	// Name			: assignAt
+	// Description	: Assigns the data of a key of a subtree, copying the
+	//					shared nodes of the path. The key must be in the tree.
+	// Parameters	:
+	//	@link	- the link to the subtree root
+	//	@key	- the key
+	//	@data	- the new data
+	// Return Value : None
+	template<class Data>
+	void assignAt(Node** link, const KeyType& key, Data&& data) {
+		for (;;) {
+			Node* node = own(link);
+			int order = KeyOrder<Compare, KeyType>::Order(compare(), key,
+					node->_key);
+			if (order == 0) {
+				node->_data = std::forward<Data>(data);
+				return;
+			}
+			link = &node->_child[(order < 0) ? LEFT : RIGHT];
+		}
+	}
+
+	// Name			: removeNode
+	// Description	: Removes an owned node from the tree. A node with two
+	//					sons is replaced by it's successor, whose path is
+	//					owned before anything is unlinked.
+	// Parameters	:
+	//	@link		- the link to the node
+	//	@removed	- if not NULL, receives the data of the node
+	// Return Value : None
+	void removeNode(Node** link, T* removed) {
+		Node* node = *link;
+		Node* replacement;
+		int depth = -1;
+
+		if (node->_child[LEFT] == NULL || node->_child[RIGHT] == NULL) {
+			replacement = node->_child[(node->_child[LEFT] == NULL) ?
+					RIGHT : LEFT];
+		} else {
+			// Own the left spine of the right subtree, down to the successor
+			Node** spine = &node->_child[RIGHT];
+			depth = 0;
+			while (own(spine)->_child[LEFT] != NULL) {
+				spine = &(*spine)->_child[LEFT];
+				depth++;
+			}
+
+			replacement = *spine;
+			*spine = replacement->_child[RIGHT];
+			replacement->_child[LEFT] = node->_child[LEFT];
+			replacement->_child[RIGHT] = node->_child[RIGHT];
+		}
+
+		if (removed != NULL) {
+			*removed = std::move(node->_data);
+		}
+		*link = replacement;
+		destroyNode(node_alloc, node);
+		size--;
+		if (depth >= 0) {
+			rebalanceSpine(&replacement->_child[RIGHT], depth);
+		}
+	}
+
+	// Name			: rebalanceSpine
+	// Description	: Rebalances the owned nodes of a left spine, from the
+	//					bottom up, after the successor below them was
+	//					unlinked.
+	// Parameters	:
+	//	@link	- the link to the top of the spine
+	//	@depth	- the number of owned nodes of the spine
+	// Return Value : None
+	void rebalanceSpine(Node** link, int depth) {
+		if (depth == 0) {
+			return;
+		}
+		rebalanceSpine(&(*link)->_child[LEFT], depth - 1);
+		rebalance(link);
+	}
+
+	// Name			: eraseAt
+	// Description	: Removes the node of a key from a subtree, copying the
+	//					shared nodes of the path. The key must be in the tree.
+	// Parameters	:
+	//	@link		- the link to the subtree root
+	//	@key		- the key
+	//	@removed	- if not NULL, receives the data of the node
+	// Return Value : None
+	void eraseAt(Node** link, const KeyType& key, T* removed) {
+		Node* node = own(link);
+		int order = KeyOrder<Compare, KeyType>::Order(compare(), key,
+				node->_key);
+
+		if (order == 0) {
+			removeNode(link, removed);
+		} else {
+			eraseAt(&node->_child[(order < 0) ? LEFT : RIGHT], key, removed);
+		}
+		if (*link != NULL) {
+			rebalance(link);
+		}
+	}
+
+public:
+	// PersistentAVLTree constructor
+	explicit PersistentAVLTree(const Allocator& alloc = Allocator()) :
+			root(NULL), size(INITIAL_SIZE), node_alloc(alloc) {
+	}
+
+	// PersistentAVLTree constructor, with a comparator
+	explicit PersistentAVLTree(const Compare& compare,
+			const Allocator& alloc = Allocator()) :
+			Compare(compare), root(NULL), size(INITIAL_SIZE), node_alloc(
+					alloc) {
+	}
+
+	// PersistentAVLTree constructor, a tree which starts at a version.
+	// It's O(1), the tree shares the nodes of the version until they're
+	// written.
+	explicit PersistentAVLTree(const Version& version) :
+			Compare(version.compare()), root(retain(version.root)), size(
+					version.size), node_alloc(version.node_alloc) {
+	}
+
+	// PersistentAVLTree copy constructor, O(1), the trees share the nodes
+	PersistentAVLTree(const PersistentAVLTree& other) :
+			Compare(other.compare()), root(retain(other.root)), size(
+					other.size), node_alloc(other.node_alloc) {
+	}
+
+	// The shared nodes are freed by the allocator of either tree, so the
+	// allocator is copied with them
+	PersistentAVLTree& operator=(const PersistentAVLTree& other) {
+		PersistentAVLTree copy(other);
+
+		std::swap(static_cast<Compare&>(*this), static_cast<Compare&>(copy));
+		std::swap(root, copy.root);
+		std::swap(size, copy.size);
+		std::swap(node_alloc, copy.node_alloc);
+		return *this;
+	}
+
+	// PersistentAVLTree Destructor, drops the nodes no version holds
+	~PersistentAVLTree() {
+		release(node_alloc, root);
+	}
+
+	// Name			: Snapshot
+	// Description	: Returns the current version of the tree, in O(1). The
+	//					version doesn't change when the tree is written.
+	// Parameters	: None
+	// Return Value : the version
+	Version Snapshot(void) const {
+		return Version(root, size, node_alloc, compare());
+	}
+
+	// Name			: Insert
+	// Description	: This function inserts new data into the tree.
+	// Parameters	:
+	//	@key	- the key of the new data
+	//	@data	- the new data
+	// Return Value : None, if the key already exists a suitable exception
+	// will be thrown (AVLTreeKeyAlreadyExistsException).
+	void Insert(const KeyType& key, const T& data) {
+		if (findNode(root, compare(), key) != NULL) {
+			throw AVLTreeKeyAlreadyExistsException();
+		}
+		insertAt(&root, key, data);
+	}
+
+	// Name			: TryEmplace
+	// Description	: Inserts a node of the given key, constructing it's data
+	//					in place, unless the key already exists.
+	// Parameters	:
+	//	@key	- the key of the new node
+	//	@args	- the arguments of the data constructor
+	// Return Value : true if the node was inserted, false if the key
+	//					already existed (the arguments aren't used)
+	template<class ... Args>
+	bool TryEmplace(const KeyType& key, Args&&... args) {
+		if (findNode(root, compare(), key) != NULL) {
+			return false;
+		}
+		insertAt(&root, key, std::forward<Args>(args)...);
+		return true;
+	}
+
+	// Name			: InsertOrAssign
+	// Description	: Inserts a node of the given key, or assigns the data of
+	//					the existing one.
+	// Parameters	:
+	//	@key	- the key
+	//	@data	- the data
+	// Return Value : true if a node was inserted, false if it was assigned
+	template<class Data>
+	bool InsertOrAssign(const KeyType& key, Data&& data) {
+		if (findNode(root, compare(), key) != NULL) {
+			assignAt(&root, key, std::forward<Data>(data));
+			return false;
+		}
+		insertAt(&root, key, std::forward<Data>(data));
+		return true;
+	}
+
+	// Name			: Delete
+	// Description	: This function deletes a node from the tree, by the given
+	// key.
+	// Parameters	:
+	//	@key - the key represents the node to delete
+	// Return Value : None, if the key wasn't found a suitable exception will
+	// be thrown (AVLTreeKeyNotFoundException).
+	void Delete(const KeyType& key) {
+		if (Erase(key) == false) {
+			throw AVLTreeKeyNotFoundException();
+		}
+	}
+
+	// Name			: Erase
+	// Description	: Deletes the node of the given key, if it exists.
+	// Parameters	:
+	//	@key		- the key represents the node to delete
+	//	@removed	- if not NULL, receives the data of the deleted node
+	// Return Value : true if the node was deleted, false if the key wasn't
+	//					found
+	bool Erase(const KeyType& key, T* removed = NULL) {
+		if (findNode(root, compare(), key) == NULL) {
+			return false;
+		}
+		eraseAt(&root, key, removed);
+		return true;
+	}
+
+	// Name			: Find
+	// Description	: Returns the data of the given key
+	// Parameters	:
+	//	@key - the key to find
+	// Return Value : the data of the key, valid until the next write
+	// If the key wasn't found, AVLTreeKeyNotFoundException will be thrown.
+	const T& Find(const KeyType& key) const {
+		const Node* node = findNode(root, compare(), key);
+		if (node == NULL) {
+			throw AVLTreeKeyNotFoundException();
+		}
+		return node->_data;
+	}
+
+	// Name			: TryFind
+	// Description	: Searches the data of the given key, without throwing on
+	//					a miss. The data is const, since it may be shared with
+	//					a version.
+	// Parameters	:
+	//	@key - the key to find
+	// Return Value : pointer to the data, or NULL if the key wasn't found.
+	//					The pointer is valid until the next write.
+	const T* TryFind(const KeyType& key) const {
+		const Node* node = findNode(root, compare(), key);
+		return (node == NULL) ? NULL : &node->_data;
+	}
+
+	// Name			: Contains
+	// Description	: Tests if the tree has the given key
+	// Parameters	:
+	//	@key - the key to find
+	// Return Value : true if the key was found
+	bool Contains(const KeyType& key) const {
+		return (findNode(root, compare(), key) != NULL);
+	}
+
+	// Name			: ForEach
+	// Description	: Visits every node of the tree in key order
+	// Parameters	:
+	//	@visitor - callable, invoked as visitor(key, data) for each node
+	// Return Value : None
+	template<class Visitor>
+	void ForEach(Visitor visitor) const {
+		scan(root, compare(), NULL, NULL, visitor);
+	}
+
+	// Name			: RangeScan
+	// Description	: Visits, in key order, every node whose key is in the
+	//					range [lo, hi). It takes O(log n + k) for k visited
+	//					nodes.
+	// Parameters	:
+	//	@lo			- the lower bound (inclusive)
+	//	@hi			- the upper bound (exclusive)
+	//	@visitor	- callable, invoked as visitor(key, data) for each node
+	// Return Value : the number of visited nodes
+	template<class Visitor>
+	int RangeScan(const KeyType& lo, const KeyType& hi, Visitor visitor) const {
+		return scan(root, compare(), &lo, &hi, visitor);
+	}
+
+	// Name			: Clear
+	// Description	: Deletes all the nodes. The nodes which a version holds
+	//					are freed when the last version drops them.
+	// Parameters	: None
+	// Return Value : None
+	void Clear(void) {
+		Node* old = root;
+
+		root = NULL;
+		size = INITIAL_SIZE;
+		release(node_alloc, old);
+	}
+
+	// Name			: getSize
+	// Description	: Returns the number of nodes in the tree
+	// Parameters	: None
+	// Return Value : the number of nodes in the tree
+	int getSize(void) const {
+		return size;
+	}
+
+	// Name			: Empty
+	// Description	: Tests if the tree has no nodes
+	// Parameters	: None
+	// Return Value : true if the tree is empty
+	bool Empty(void) const {
+		return (size == INITIAL_SIZE);
+	}
+
+	// Name			: isBalanced
+	// Description	: This function tests if the tree is balanced. It should
+	//					always return true.
+	// Parameters	: None
+	// Return Value : true if balanced, false otherwise
+	bool isBalanced(void) const {
+		return isBalancedAux(root);
+	}
+};
+
+#endif /* PERSISTENT_AVLTREE_HPP_ */
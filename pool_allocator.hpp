@@ -0,0 +1,296 @@
+#ifndef POOL_ALLOCATOR_HPP_
+#define POOL_ALLOCATOR_HPP_
+
+//
+//	File		: pool_allocator.hpp
+//	Description	: Slab/free-list memory pool, and a standard allocator
+//					which carves AVLTree nodes and HashMap values from it.
+//					Small blocks are cut from large slabs and recycled
+//					through per-size free lists, so the general purpose
+//					allocator is only called once per slab. A pool is not
+//					thread safe, and should be used by one thread at a time.
+//
+
+#include <cstddef>
+#include <new>
+#include <memory>
+#include <type_traits>
+
+//
+//	Class		: SlabPool
+//	Description : Pool of small memory blocks. The pool is reference
+//					counted by the PoolAllocators which use it.
+//
+class SlabPool {
+private:
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	struct Slab {
+		Slab* next;
+	};
+
+	//
+	// Constants
+	//
+	static const size_t SIZE_CLASSES = 16;
+	static const size_t SLAB_SIZE = 64 * 1024;
+
+	FreeBlock* free_lists[SIZE_CLASSES];
+	Slab* slabs;
+	char* cursor;
+	char* limit;
+	int owners;
+	bool released;
+
+	static size_t sizeClass(size_t bytes) {
+		return (bytes + ALIGNMENT - 1) / ALIGNMENT - 1;
+	}
+
+	// Name			: newSlab
+	// Description	: Allocates a new slab, and moves the bump cursor to it.
+	// Parameters	: None
+	// Return Value : None
+	// If memory allocation failes, a matching exception would be thrown by
+	//	the system.
+	void newSlab() {
+		Slab* slab = static_cast<Slab*>(::operator new(SLAB_SIZE));
+		slab->next = slabs;
+		slabs = slab;
+		cursor = reinterpret_cast<char*>(slab) + SLAB_HEADER_SIZE;
+		limit = reinterpret_cast<char*>(slab) + SLAB_SIZE;
+	}
+
+	SlabPool(const SlabPool&);
+	SlabPool& operator=(const SlabPool&);
+
+public:
+	//
+	// Constants
+	//
+	static const size_t ALIGNMENT = 16;
+	static const size_t MAX_BLOCK_SIZE = ALIGNMENT * SIZE_CLASSES;
+	static const size_t SLAB_HEADER_SIZE = ALIGNMENT;
+
+	SlabPool() :
+			slabs(NULL), cursor(NULL), limit(NULL), owners(1), released(
+					false) {
+		for (size_t i = 0; i < SIZE_CLASSES; i++) {
+			free_lists[i] = NULL;
+		}
+	}
+
+	// Name			: Allocate
+	// Description	: Allocates a block of the given size. Blocks larger than
+	//					MAX_BLOCK_SIZE bypass the pool.
+	// Parameters	:
+	//	@bytes - the requested size
+	// Return Value : pointer to the new block
+	void* Allocate(size_t bytes) {
+		if (bytes > MAX_BLOCK_SIZE) {
+			return ::operator new(bytes);
+		}
+
+		released = false;
+		size_t index = sizeClass(bytes);
+		FreeBlock* block = free_lists[index];
+		if (block != NULL) {
+			free_lists[index] = block->next;
+			return block;
+		}
+
+		size_t block_size = (index + 1) * ALIGNMENT;
+		if (cursor == NULL || (size_t) (limit - cursor) < block_size) {
+			newSlab();
+		}
+		void* res = cursor;
+		cursor += block_size;
+		return res;
+	}
+
+	// Name			: Deallocate
+	// Description	: Returns a block to the free list of it's size.
+	// Parameters	:
+	//	@p		- the block
+	//	@bytes	- the size which was used to allocate it
+	// Return Value : None
+	void Deallocate(void* p, size_t bytes) {
+		if (bytes > MAX_BLOCK_SIZE) {
+			::operator delete(p);
+			return;
+		}
+		if (released == true) {
+			// The block's slab is already gone
+			return;
+		}
+
+		FreeBlock* block = static_cast<FreeBlock*>(p);
+		size_t index = sizeClass(bytes);
+		block->next = free_lists[index];
+		free_lists[index] = block;
+	}
+
+	// Name			: Release
+	// Description	: Frees all the slabs at once. Every block which was
+	//					allocated from the pool (except large ones) becomes
+	//					invalid.
+	// Parameters	: None
+	// Return Value : None
+	void Release() {
+		while (slabs != NULL) {
+			Slab* next = slabs->next;
+			::operator delete(slabs);
+			slabs = next;
+		}
+		for (size_t i = 0; i < SIZE_CLASSES; i++) {
+			free_lists[i] = NULL;
+		}
+		cursor = limit = NULL;
+		released = true;
+	}
+
+	// Name			: ReleaseIfOwnedBy
+	// Description	: Releases the pool if it's only used by the given number
+	//					of allocators, which means that their owner is the
+	//					only user of the pool.
+	// Parameters	:
+	//	@count - the number of allocators held by the caller
+	// Return Value : true if the pool is released (now or by an earlier call
+	//					that wasn't followed by an allocation)
+	bool ReleaseIfOwnedBy(int count) {
+		if (released == false && owners == count) {
+			Release();
+		}
+		return released;
+	}
+
+	void Acquire() {
+		owners++;
+	}
+
+	// Name			: Drop
+	// Description	: Removes one user of the pool.
+	// Parameters	: None
+	// Return Value : true if it was the last user
+	bool Drop() {
+		return (--owners == 0);
+	}
+
+	~SlabPool() {
+		Release();
+	}
+};
+
+//
+//	Class		: PoolAllocator
+//	Description : Standard allocator backed by a SlabPool. Copies (and
+//					rebound copies) share the same pool, and the pool is
+//					destroyed with it's last allocator.
+//
+template<class T> class PoolAllocator {
+private:
+	template<class U> friend class PoolAllocator;
+
+	SlabPool* pool;
+
+public:
+	typedef T value_type;
+
+	PoolAllocator() :
+			pool(new SlabPool()) {
+	}
+
+	PoolAllocator(const PoolAllocator& other) :
+			pool(other.pool) {
+		pool->Acquire();
+	}
+
+	template<class U>
+	PoolAllocator(const PoolAllocator<U>& other) :
+			pool(other.pool) {
+		pool->Acquire();
+	}
+
+	PoolAllocator& operator=(const PoolAllocator& other) {
+		other.pool->Acquire();
+		if (pool->Drop() == true) {
+			delete pool;
+		}
+		pool = other.pool;
+		return *this;
+	}
+
+	~PoolAllocator() {
+		if (pool->Drop() == true) {
+			delete pool;
+		}
+	}
+
+	T* allocate(size_t n) {
+		static_assert(alignof(T) <= SlabPool::ALIGNMENT,
+				"PoolAllocator doesn't support over-aligned types");
+		return static_cast<T*>(pool->Allocate(n * sizeof(T)));
+	}
+
+	void deallocate(T* p, size_t n) {
+		pool->Deallocate(p, n * sizeof(T));
+	}
+
+	SlabPool& getPool() const {
+		return *pool;
+	}
+
+	template<class U>
+	bool operator==(const PoolAllocator<U>& rhs) const {
+		return pool == rhs.pool;
+	}
+
+	template<class U>
+	bool operator!=(const PoolAllocator<U>& rhs) const {
+		return pool != rhs.pool;
+	}
+};
+
+//
+//	Class		: AllocatorBulkRelease
+//	Description : Lets a container drop all of it's memory at once, instead
+//					of freeing it block by block, when it's allocator
+//					supports it (only PoolAllocator does).
+//
+template<class Alloc> struct AllocatorBulkRelease {
+	// Name			: Release
+	// Description	: Releases all the memory of the allocator, if the caller
+	//					is it's only user.
+	// Parameters	:
+	//	@alloc	- the allocator
+	//	@count	- the number of copies of the allocator held by the caller
+	// Return Value : true if all the memory was released, and the caller
+	//					must not free it's blocks one by one.
+	static bool Release(const Alloc&, int) {
+		return false;
+	}
+};
+
+template<class T> struct AllocatorBulkRelease<PoolAllocator<T> > {
+	static bool Release(const PoolAllocator<T>& alloc, int count) {
+		return alloc.getPool().ReleaseIfOwnedBy(count);
+	}
+};
+
+//
+//	Class		: AllocatorThreadSafety
+//	Description : Tells if several threads may allocate and free blocks of
+//					copies of an allocator at once. The parallel operations
+//					of the containers (see parallel_task.hpp) free or allocate
+//					nodes from the worker threads only when it's set, and
+//					run serially otherwise. Only std::allocator is known
+//					to be safe, PoolAllocator isn't.
+//
+template<class Alloc> struct AllocatorThreadSafety: std::false_type {
+};
+
+template<class T> struct AllocatorThreadSafety<std::allocator<T> > : std::true_type {
+};
+
+#endif /* POOL_ALLOCATOR_HPP_ */
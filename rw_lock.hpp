@@ -0,0 +1,140 @@
+#ifndef RW_LOCK_HPP_
+#define RW_LOCK_HPP_
+
+//
+//	File		: rw_lock.hpp
+//	Description	: Readers-writer spin lock for short critical sections,
+//					such as the shards of ConcurrentHashMap. Any number of
+//					readers may hold the lock together, and a waiting
+//					writer keeps new readers out so it isn't starved.
+//					Waiters spin a little and then yield the processor.
+//					The lock satisfies the standard Lockable requirements
+//					(lock/unlock), so std::lock_guard can hold it
+//					exclusively. SharedLockGuard holds it shared.
+//
+
+#include <atomic>
+#include <thread>
+
+class ReaderWriterLock {
+private:
+	//
+	// Constants
+	//
+	static const int WRITER = 1;
+	static const int WRITER_WAITING = 2;
+	// Each reader adds one READER to the state
+	static const int READER = 4;
+	static const int SPINS_BEFORE_YIELD = 64;
+
+	std::atomic<int> state;
+
+	ReaderWriterLock(const ReaderWriterLock&);
+	ReaderWriterLock& operator=(const ReaderWriterLock&);
+
+	static void backoff(int* spins) {
+		if (++(*spins) >= SPINS_BEFORE_YIELD) {
+			*spins = 0;
+			std::this_thread::yield();
+		}
+	}
+
+public:
+	ReaderWriterLock() :
+			state(0) {
+	}
+
+	// Name			: lock
+	// Description	: Acquires the lock exclusively, waiting for the readers
+	//					and the writer which hold it.
+	// Parameters	: None
+	// Return Value : None
+	void lock() {
+		int spins = 0;
+
+		for (;;) {
+			int current = state.load(std::memory_order_relaxed);
+			if ((current & ~WRITER_WAITING) == 0) {
+				// Taking the lock clears the waiting flag, other waiting
+				// writers set it again
+				if (state.compare_exchange_weak(current, WRITER,
+						std::memory_order_acquire,
+						std::memory_order_relaxed)) {
+					return;
+				}
+				continue;
+			}
+
+			if ((current & WRITER_WAITING) == 0) {
+				state.fetch_or(WRITER_WAITING, std::memory_order_relaxed);
+			}
+			backoff(&spins);
+		}
+	}
+
+	// Name			: try_lock
+	// Description	: Acquires the lock exclusively if it's free
+	// Parameters	: None
+	// Return Value : true if the lock was acquired
+	bool try_lock() {
+		int current = state.load(std::memory_order_relaxed);
+		return ((current & ~WRITER_WAITING) == 0)
+				&& state.compare_exchange_strong(current, WRITER,
+						std::memory_order_acquire, std::memory_order_relaxed);
+	}
+
+	void unlock() {
+		state.fetch_and(~WRITER, std::memory_order_release);
+	}
+
+	// Name			: lock_shared
+	// Description	: Acquires the lock shared, waiting while a writer holds
+	//					or waits for it.
+	// Parameters	: None
+	// Return Value : None
+	void lock_shared() {
+		int spins = 0;
+
+		for (;;) {
+			int current = state.load(std::memory_order_relaxed);
+			if ((current & (WRITER | WRITER_WAITING)) == 0) {
+				if (state.compare_exchange_weak(current, current + READER,
+						std::memory_order_acquire,
+						std::memory_order_relaxed)) {
+					return;
+				}
+				continue;
+			}
+			backoff(&spins);
+		}
+	}
+
+	void unlock_shared() {
+		state.fetch_sub(READER, std::memory_order_release);
+	}
+};
+
+//
+//	Class		: SharedLockGuard
+//	Description : Holds a ReaderWriterLock shared for the lifetime of the
+//					guard.
+//
+class SharedLockGuard {
+private:
+	ReaderWriterLock& lock;
+
+	SharedLockGuard(const SharedLockGuard&);
+	SharedLockGuard& operator=(const SharedLockGuard&);
+
+public:
+	explicit SharedLockGuard(ReaderWriterLock& lock) :
+			lock(lock) {
+		lock.lock_shared();
+	}
+
+	~SharedLockGuard() {
+		lock.unlock_shared();
+	}
+};
+
+#endif /* RW_LOCK_HPP_ */
@@ -0,0 +1,309 @@
+#ifndef SIMD_HPP_
+#define SIMD_HPP_
+
+//
+//	File		: simd.hpp
+//	Description	: Vector kernels for the containers which keep several
+//					keys contiguously: matching a byte against a group of
+//					16 control bytes (FlatGroup), and ranking an integer key
+//					in a block of integer keys (BPlusTree nodes). It also
+//					holds the software prefetch of the batched lookups.
+//					The instruction set is selected at compile time: SSE2
+//					(and AVX2 when it's enabled), NEON on AArch64, or the
+//					scalar code. Defining SIMD_DISABLE forces the scalar
+//					code.
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if !defined(SIMD_DISABLE)
+#if defined(__SSE2__) || defined(_M_X64) \
+		|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+#endif
+
+//
+//	Class		: SimdBytes
+//	Description : Matching a value against 16 consecutive bytes. Every
+//					function returns a mask, whose bit i is set if byte i
+//					matches.
+//
+class SimdBytes {
+public:
+	//
+	// Constants
+	//
+	static const int WIDTH = 16;
+
+	// Name			: MatchEqual
+	// Description	: Finds the bytes which equal the given value
+	// Parameters	:
+	//	@bytes 	- the 16 bytes, no alignment is required
+	//	@value	- the value to look for
+	// Return Value : bit mask of the equal bytes
+	static uint32_t MatchEqual(const signed char* bytes, signed char value) {
+#if defined(SIMD_SSE2)
+		__m128i group = _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(bytes));
+		return (uint32_t) _mm_movemask_epi8(
+				_mm_cmpeq_epi8(group, _mm_set1_epi8(value)));
+#elif defined(SIMD_NEON)
+		return moveMask(vceqq_s8(vld1q_s8(bytes), vdupq_n_s8(value)));
+#else
+		uint32_t mask = 0;
+		for (int i = 0; i < WIDTH; i++) {
+			if (bytes[i] == value) {
+				mask |= (1u << i);
+			}
+		}
+		return mask;
+#endif
+	}
+
+	// Name			: MatchNegative
+	// Description	: Finds the bytes whose sign bit is set
+	// Parameters	:
+	//	@bytes 	- the 16 bytes, no alignment is required
+	// Return Value : bit mask of the negative bytes
+	static uint32_t MatchNegative(const signed char* bytes) {
+#if defined(SIMD_SSE2)
+		return (uint32_t) _mm_movemask_epi8(
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes)));
+#elif defined(SIMD_NEON)
+		return moveMask(vcltzq_s8(vld1q_s8(bytes)));
+#else
+		uint32_t mask = 0;
+		for (int i = 0; i < WIDTH; i++) {
+			if (bytes[i] < 0) {
+				mask |= (1u << i);
+			}
+		}
+		return mask;
+#endif
+	}
+
+private:
+#if defined(SIMD_NEON)
+	// Name			: moveMask
+	// Description	: Packs the results of a byte comparison (0 or 0xFF per
+	//					byte) into a bit mask, as SSE2's movemask does
+	static uint32_t moveMask(uint8x16_t matches) {
+		static const uint8_t weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2,
+				4, 8, 16, 32, 64, 128 };
+		uint8x16_t bits = vandq_u8(matches, vld1q_u8(weights));
+		return (uint32_t) vaddv_u8(vget_low_u8(bits))
+				| ((uint32_t) vaddv_u8(vget_high_u8(bits)) << 8);
+	}
+#endif
+};
+
+//
+//	Class		: SimdKeys
+//	Description : Ranking a key in a block of integer keys, by comparing
+//					4 or 8 keys per instruction. The keys of the block don't
+//					have to be sorted. Supported<Key> tells whether the
+//					kernels are vectorized for the key type, other callers
+//					should keep their scalar search.
+//
+class SimdKeys {
+public:
+	template<class Key> struct Supported: public std::integral_constant<bool,
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+			std::is_integral<Key>::value && !std::is_same<Key, bool>::value
+					&& (sizeof(Key) == 4
+#if defined(SIMD_AVX2) || defined(SIMD_NEON)
+							|| sizeof(Key) == 8
+#endif
+					)
+#else
+			false
+#endif
+	> {
+	};
+
+	// Name			: CountLess
+	// Description	: Counts the keys of a block which are less than the
+	//					given key. On a sorted block, it's the index of the
+	//					lower bound of the key.
+	// Parameters	:
+	//	@keys	- the block
+	//	@count	- number of keys in the block
+	//	@key	- the key to rank
+	// Return Value : the number of smaller keys
+	template<class Key>
+	static int CountLess(const Key* keys, int count, Key key) {
+		return countLanes<false>(keys, count, key,
+				std::integral_constant<size_t, sizeof(Key)>());
+	}
+
+	// Name			: CountLessEqual
+	// Description	: Counts the keys of a block which are not greater than
+	//					the given key. On a sorted block, it's the index of
+	//					the upper bound of the key.
+	// Parameters	:
+	//	@keys	- the block
+	//	@count	- number of keys in the block
+	//	@key	- the key to rank
+	// Return Value : the number of keys which are not greater
+	template<class Key>
+	static int CountLessEqual(const Key* keys, int count, Key key) {
+		return count
+				- countLanes<true>(keys, count, key,
+						std::integral_constant<size_t, sizeof(Key)>());
+	}
+
+private:
+	// Unsigned keys are compared as signed lanes, after flipping the sign
+	// bit of both sides
+	template<class Key, class Lane>
+	static Lane bias() {
+		return std::is_signed<Key>::value ?
+				(Lane) 0 : (Lane) ((Lane) 1 << (sizeof(Lane) * 8 - 1));
+	}
+
+	// Name			: countLanes
+	// Description	: Counts the keys which are less than (or, if Greater is
+	//					set, greater than) the given key
+	template<bool Greater, class Key>
+	static int countLanes(const Key* keys, int count, Key key,
+			std::integral_constant<size_t, 4>) {
+		const uint32_t flip = bias<Key, uint32_t>();
+		const int32_t probe = (int32_t) ((uint32_t) key ^ flip);
+		int res = 0;
+		int i = 0;
+
+#if defined(SIMD_AVX2)
+		__m256i probe8 = _mm256_set1_epi32(probe);
+		__m256i flip8 = _mm256_set1_epi32((int32_t) flip);
+		for (; i + 8 <= count; i += 8) {
+			__m256i block = _mm256_xor_si256(flip8,
+					_mm256_loadu_si256(
+							reinterpret_cast<const __m256i*>(keys + i)));
+			__m256i hits =
+					Greater ?
+							_mm256_cmpgt_epi32(block, probe8) :
+							_mm256_cmpgt_epi32(probe8, block);
+			res += bitCount(
+					(uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(hits)));
+		}
+#endif
+#if defined(SIMD_SSE2)
+		__m128i probe4 = _mm_set1_epi32(probe);
+		__m128i flip4 = _mm_set1_epi32((int32_t) flip);
+		for (; i + 4 <= count; i += 4) {
+			__m128i block = _mm_xor_si128(flip4,
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)));
+			__m128i hits =
+					Greater ?
+							_mm_cmpgt_epi32(block, probe4) :
+							_mm_cmplt_epi32(block, probe4);
+			res += bitCount(
+					(uint32_t) _mm_movemask_ps(_mm_castsi128_ps(hits)));
+		}
+#elif defined(SIMD_NEON)
+		int32x4_t probe4 = vdupq_n_s32(probe);
+		uint32x4_t flip4 = vdupq_n_u32(flip);
+		uint32x4_t acc = vdupq_n_u32(0);
+		for (; i + 4 <= count; i += 4) {
+			int32x4_t block = vreinterpretq_s32_u32(
+					veorq_u32(vld1q_u32(reinterpret_cast<const uint32_t*>(keys + i)), flip4));
+			uint32x4_t hits =
+					Greater ? vcgtq_s32(block, probe4) : vcltq_s32(block, probe4);
+			acc = vsubq_u32(acc, hits);
+		}
+		res += (int) vaddvq_u32(acc);
+#endif
+		for (; i < count; i++) {
+			int32_t lane = (int32_t) ((uint32_t) keys[i] ^ flip);
+			res += Greater ? (lane > probe) : (lane < probe);
+		}
+		return res;
+	}
+
+	template<bool Greater, class Key>
+	static int countLanes(const Key* keys, int count, Key key,
+			std::integral_constant<size_t, 8>) {
+		const uint64_t flip = bias<Key, uint64_t>();
+		const int64_t probe = (int64_t) ((uint64_t) key ^ flip);
+		int res = 0;
+		int i = 0;
+
+#if defined(SIMD_AVX2)
+		__m256i probe4 = _mm256_set1_epi64x(probe);
+		__m256i flip4 = _mm256_set1_epi64x((int64_t) flip);
+		for (; i + 4 <= count; i += 4) {
+			__m256i block = _mm256_xor_si256(flip4,
+					_mm256_loadu_si256(
+							reinterpret_cast<const __m256i*>(keys + i)));
+			__m256i hits =
+					Greater ?
+							_mm256_cmpgt_epi64(block, probe4) :
+							_mm256_cmpgt_epi64(probe4, block);
+			res += bitCount(
+					(uint32_t) _mm256_movemask_pd(_mm256_castsi256_pd(hits)));
+		}
+#elif defined(SIMD_NEON)
+		int64x2_t probe2 = vdupq_n_s64(probe);
+		uint64x2_t flip2 = vdupq_n_u64(flip);
+		uint64x2_t acc = vdupq_n_u64(0);
+		for (; i + 2 <= count; i += 2) {
+			int64x2_t block = vreinterpretq_s64_u64(
+					veorq_u64(vld1q_u64(reinterpret_cast<const uint64_t*>(keys + i)), flip2));
+			uint64x2_t hits =
+					Greater ? vcgtq_s64(block, probe2) : vcltq_s64(block, probe2);
+			acc = vsubq_u64(acc, hits);
+		}
+		res += (int) vaddvq_u64(acc);
+#endif
+		for (; i < count; i++) {
+			int64_t lane = (int64_t) ((uint64_t) keys[i] ^ flip);
+			res += Greater ? (lane > probe) : (lane < probe);
+		}
+		return res;
+	}
+
+	static int bitCount(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_popcount(mask);
+#else
+		int count = 0;
+		for (; mask != 0; mask &= mask - 1) {
+			count++;
+		}
+		return count;
+#endif
+	}
+};
+
+//
+//	Function	: PrefetchRead
+//	Description : Hints the processor to load the cache line of the given
+//					address, which is read soon. Batched lookups issue it
+//					for a group of keys before they touch any of them, so
+//					the cache misses overlap. It never faults, so any
+//					address may be given.
+//	Parameters	:
+//	@address - the address
+//	Return Value : None
+inline void PrefetchRead(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_prefetch(address, 0, 3);
+#elif defined(SIMD_SSE2)
+	_mm_prefetch(reinterpret_cast<const char*>(address), _MM_HINT_T0);
+#else
+	(void) address;
+#endif
+}
+
+#endif /* SIMD_HPP_ */
@@ -0,0 +1,778 @@
+#ifndef SNAPSHOT_HPP_
+#define SNAPSHOT_HPP_
+
+//
+//	File		: snapshot.hpp
+//	Description	: Read-only snapshot images of the containers, which are
+//					mapped into memory and searched in place.
+//					Serialize(tree, path) writes a sorted image of an
+//					AVLTree - the keys in order, then the values in the
+//					same order, searched by MappedSortedMap.
+//					Serialize(map, path) writes a hashed image of a
+//					HashMap - an open addressing table of control bytes,
+//					keys and values, searched by MappedHashMap.
+//					An image is a header followed by sections at offsets
+//					from the start of the file, so it can be mapped at any
+//					address, and every process which maps it shares the
+//					same pages of the page cache. Keys and values are
+//					copied byte by byte, so they must be trivially
+//					copyable, and an image is read by a build with the
+//					same types, byte order and hash functor.
+//					The mapping uses POSIX mmap, so the header is only
+//					included by the users of the images, and not by the
+//					containers themselves.
+//
+
+#include <exception>
+#include "avltree.hpp"
+#include "exceptions.hpp"
+#include "flat_hash_map.hpp"
+#include "hash.hpp"
+#include "hash_map.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#error "snapshot.hpp maps the images with POSIX mmap, which this platform doesn't have"
+#endif
+
+//
+//	Enum		: SnapshotLayout
+//	Description : The kind of an image.
+//	SNAPSHOT_SORTED	- sorted keys and values, from an AVLTree
+//	SNAPSHOT_HASHED	- open addressing table, from a HashMap
+//
+enum SnapshotLayout {
+	SNAPSHOT_SORTED = 1, SNAPSHOT_HASHED = 2
+};
+
+//
+//	Struct		: SnapshotHeader
+//	Description : The first bytes of an image. The offsets are from the
+//					start of the file, and every section starts on a
+//					SECTION_ALIGNMENT boundary. A sorted image has no
+//					control bytes, and it's capacity is it's count.
+//
+struct SnapshotHeader {
+	//
+	// Constants
+	//
+	static const uint32_t VERSION = 1;
+	static const uint64_t SECTION_ALIGNMENT = 64;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t layout;
+	uint32_t key_size;
+	uint32_t key_align;
+	uint32_t value_size;
+	uint32_t value_align;
+	uint64_t count;
+	uint64_t capacity;
+	// Hash value of a value-initialized key, which tells whether the
+	// reader hashes the keys the same way (zero for sorted images)
+	uint64_t hash_check;
+	uint64_t ctrl_offset;
+	uint64_t keys_offset;
+	uint64_t values_offset;
+	uint64_t file_size;
+
+	static const char* Magic() {
+		return "CTRSNAP";
+	}
+
+	static uint64_t align(uint64_t offset) {
+		return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+	}
+
+	// Name			: Make
+	// Description	: Creates the header of an image, and lays out it's
+	//					sections.
+	// Parameters	:
+	//	@layout		- the image kind
+	//	@count		- number of mappings
+	//	@capacity	- number of slots of a hashed image
+	//	@hash_check	- see hash_check
+	// Return Value : the header
+	template<class K, class V>
+	static SnapshotHeader Make(SnapshotLayout layout, uint64_t count,
+			uint64_t capacity, uint64_t hash_check) {
+		SnapshotHeader header;
+
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, Magic(), sizeof(header.magic));
+		header.version = VERSION;
+		header.layout = (uint32_t) layout;
+		header.key_size = (uint32_t) sizeof(K);
+		header.key_align = (uint32_t) alignof(K);
+		header.value_size = (uint32_t) sizeof(V);
+		header.value_align = (uint32_t) alignof(V);
+		header.count = count;
+		header.capacity = (layout == SNAPSHOT_SORTED) ? count : capacity;
+		header.hash_check = hash_check;
+
+		uint64_t offset = align(sizeof(SnapshotHeader));
+		if (layout == SNAPSHOT_HASHED) {
+			header.ctrl_offset = offset;
+			offset = align(offset + header.capacity);
+		}
+		header.keys_offset = offset;
+		header.values_offset = align(offset + header.capacity * sizeof(K));
+		header.file_size = header.values_offset + header.capacity * sizeof(V);
+		return header;
+	}
+
+	// Name			: Matches
+	// Description	: Tests that a mapped header describes an image of the
+	//					given kind and types, whose sections fit in the file.
+	// Parameters	:
+	//	@layout		- the expected kind
+	//	@mapped_size - the size of the file
+	// Return Value : true if the image can be read
+	template<class K, class V>
+	bool Matches(SnapshotLayout layout, uint64_t mapped_size) const {
+		SnapshotHeader expected = Make<K, V>(layout, count, capacity,
+				hash_check);
+
+		return (std::memcmp(magic, expected.magic, sizeof(magic)) == 0
+				&& version == VERSION && this->layout == (uint32_t) layout
+				&& key_size == expected.key_size
+				&& key_align == expected.key_align
+				&& value_size == expected.value_size
+				&& value_align == expected.value_align && count <= capacity
+				&& capacity <= mapped_size
+				&& ctrl_offset == expected.ctrl_offset
+				&& keys_offset == expected.keys_offset
+				&& values_offset == expected.values_offset
+				&& file_size == expected.file_size
+				&& file_size <= mapped_size);
+	}
+};
+
+//
+//	Struct		: SnapshotSlots
+//	Description : The slots of a hashed image. The table is probed
+//					linearly from the home slot of a hash, and a control
+//					byte is EMPTY or FULL with the low bits of the hash,
+//					so most mismatching keys aren't read. The table is at
+//					most three quarters full, so every probe ends.
+//
+struct SnapshotSlots {
+	//
+	// Constants
+	//
+	static const unsigned char EMPTY = 0;
+	static const unsigned char FULL = 0x80;
+	static const size_t TAG_BITS = 7;
+	static const size_t TAG_MASK = 0x7F;
+	static const uint64_t MIN_CAPACITY = 16;
+
+	static uint64_t Capacity(uint64_t count) {
+		uint64_t capacity = MIN_CAPACITY;
+		while (capacity * 3 < count * 4) {
+			capacity *= 2;
+		}
+		return capacity;
+	}
+
+	static unsigned char Tag(size_t hash) {
+		return (unsigned char) (FULL | (hash & TAG_MASK));
+	}
+
+	static uint64_t Home(size_t hash, uint64_t capacity) {
+		return (uint64_t) (hash >> TAG_BITS) & (capacity - 1);
+	}
+
+	// Name			: HashCheck
+	// Description	: Computes the hash_check of a hashed image
+	// Parameters	:
+	//	@hasher - the hash functor of the image
+	// Return Value : the hash value of a value-initialized key
+	template<class K, class Hash>
+	static uint64_t HashCheck(const Hash& hasher) {
+		return (uint64_t) hasher(K());
+	}
+};
+
+//
+//	Class		: SnapshotWriter
+//	Description : Writes an image next to it's path, and renames it over
+//					the path once it's complete. Processes which mapped the
+//					previous image keep reading it, and a failed write
+//					leaves the path unchanged.
+//
+class SnapshotWriter {
+private:
+	std::string path;
+	std::string temp_path;
+	std::FILE* file;
+	uint64_t offset;
+
+	SnapshotWriter(const SnapshotWriter&);
+	SnapshotWriter& operator=(const SnapshotWriter&);
+
+	void fail() {
+		std::fclose(file);
+		file = NULL;
+		std::remove(temp_path.c_str());
+		throw SnapshotIOException();
+	}
+
+public:
+	// SnapshotWriter constructor
+	//	@path - the path of the image
+	// If the file can't be created, SnapshotIOException will be thrown.
+	explicit SnapshotWriter(const std::string& path) :
+			path(path), temp_path(path + ".tmp"), file(NULL), offset(0) {
+		file = std::fopen(temp_path.c_str(), "wb");
+		if (file == NULL) {
+			throw SnapshotIOException();
+		}
+	}
+
+	// SnapshotWriter destructor, drops an image which wasn't committed
+	~SnapshotWriter() {
+		if (file != NULL) {
+			std::fclose(file);
+			std::remove(temp_path.c_str());
+		}
+	}
+
+	// Name			: Write
+	// Description	: Appends bytes to the image
+	// Parameters	:
+	//	@data	- the bytes
+	//	@bytes	- number of bytes
+	// Return Value : None
+	// If the write fails, SnapshotIOException will be thrown.
+	void Write(const void* data, size_t bytes) {
+		if (bytes != 0 && std::fwrite(data, 1, bytes, file) != bytes) {
+			fail();
+		}
+		offset += bytes;
+	}
+
+	// Name			: PadTo
+	// Description	: Appends zero bytes up to the given offset
+	// Parameters	:
+	//	@target - the offset of the next section
+	// Return Value : None
+	void PadTo(uint64_t target) {
+		static const char zeros[SnapshotHeader::SECTION_ALIGNMENT] = { 0 };
+
+		while (offset < target) {
+			uint64_t left = target - offset;
+			Write(zeros, (left < sizeof(zeros)) ? (size_t) left : sizeof(zeros));
+		}
+	}
+
+	// Name			: Commit
+	// Description	: Completes the image, and moves it to it's path
+	// Parameters	: None
+	// Return Value : None
+	// If the image can't be completed, SnapshotIOException will be thrown.
+	void Commit() {
+		if (std::fflush(file) != 0 || fsync(fileno(file)) != 0) {
+			fail();
+		}
+		if (std::fclose(file) != 0) {
+			file = NULL;
+			std::remove(temp_path.c_str());
+			throw SnapshotIOException();
+		}
+		file = NULL;
+
+		if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+			std::remove(temp_path.c_str());
+			throw SnapshotIOException();
+		}
+	}
+};
+
+//
+//	Class		: HashedSnapshotBuilder
+//	Description : Collects the mappings of a HashMap into the table of a
+//					hashed image, and writes it.
+//
+template<class K, class V> class HashedSnapshotBuilder {
+private:
+	uint64_t capacity;
+	uint64_t count;
+	std::vector<unsigned char> ctrl;
+	std::vector<char> keys;
+	std::vector<char> values;
+
+public:
+	// HashedSnapshotBuilder constructor
+	//	@expected - the number of mappings which will be added
+	explicit HashedSnapshotBuilder(uint64_t expected) :
+			capacity(SnapshotSlots::Capacity(expected)), count(0), ctrl(
+					(size_t) capacity,
+					(unsigned char) SnapshotSlots::EMPTY), keys(
+					(size_t) capacity * sizeof(K)), values(
+					(size_t) capacity * sizeof(V)) {
+	}
+
+	// Name			: Add
+	// Description	: Adds a mapping to the table. The keys must be distinct.
+	// Parameters	:
+	//	@hash	- the hash value of the key
+	//	@key	- the key
+	//	@value	- the value
+	// Return Value : None
+	void Add(size_t hash, const K& key, const V& value) {
+		uint64_t mask = capacity - 1;
+		uint64_t index = SnapshotSlots::Home(hash, capacity);
+
+		while (ctrl[(size_t) index] != SnapshotSlots::EMPTY) {
+			index = (index + 1) & mask;
+		}
+		ctrl[(size_t) index] = SnapshotSlots::Tag(hash);
+		std::memcpy(&keys[(size_t) index * sizeof(K)], &key, sizeof(K));
+		std::memcpy(&values[(size_t) index * sizeof(V)], &value, sizeof(V));
+		count++;
+	}
+
+	// Name			: Write
+	// Description	: Writes the image
+	// Parameters	:
+	//	@path		- the path of the image
+	//	@hash_check	- see SnapshotSlots::HashCheck
+	// Return Value : None
+	// If the image can't be written, SnapshotIOException will be thrown.
+	void Write(const std::string& path, uint64_t hash_check) const {
+		SnapshotHeader header = SnapshotHeader::Make<K, V>(SNAPSHOT_HASHED,
+				count, capacity, hash_check);
+		SnapshotWriter writer(path);
+
+		writer.Write(&header, sizeof(header));
+		writer.PadTo(header.ctrl_offset);
+		writer.Write(&ctrl[0], ctrl.size());
+		writer.PadTo(header.keys_offset);
+		writer.Write(&keys[0], keys.size());
+		writer.PadTo(header.values_offset);
+		writer.Write(&values[0], values.size());
+		writer.Commit();
+	}
+};
+
+//
+//	Class		: MappedFile
+//	Description : A file mapped read-only into memory. The pages are
+//					shared with every other process which maps the file.
+//
+class MappedFile {
+private:
+	void* data;
+	size_t size;
+
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+public:
+	MappedFile() :
+			data(NULL), size(0) {
+	}
+
+	~MappedFile() {
+		Close();
+	}
+
+	// Name			: Open
+	// Description	: Maps a file, after unmapping the current one
+	// Parameters	:
+	//	@path - the path of the file
+	// Return Value : None
+	// If the file can't be mapped, SnapshotIOException will be thrown.
+	void Open(const std::string& path) {
+		Close();
+
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw SnapshotIOException();
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+			close(fd);
+			throw SnapshotIOException();
+		}
+
+		void* mapped = mmap(NULL, (size_t) info.st_size, PROT_READ,
+				MAP_SHARED, fd, 0);
+		// The mapping keeps the file, the descriptor isn't needed
+		close(fd);
+		if (mapped == MAP_FAILED) {
+			throw SnapshotIOException();
+		}
+		data = mapped;
+		size = (size_t) info.st_size;
+	}
+
+	void Close() {
+		if (data != NULL) {
+			munmap(data, size);
+			data = NULL;
+			size = 0;
+		}
+	}
+
+	const char* getData() const {
+		return static_cast<const char*>(data);
+	}
+
+	size_t getSize() const {
+		return size;
+	}
+};
+
+//
+//	Class		: MappedSortedMap
+//	Description : Read-only map over a mapped sorted image (see
+//					Serialize). A lookup is a binary search of the
+//					mapped keys, and the values are returned in place.
+//
+template<typename V, class K> class MappedSortedMap {
+private:
+	MappedFile file;
+	const K* keys;
+	const V* values;
+	int count;
+
+	MappedSortedMap(const MappedSortedMap&);
+	MappedSortedMap& operator=(const MappedSortedMap&);
+
+public:
+	MappedSortedMap() :
+			keys(NULL), values(NULL), count(0) {
+	}
+
+	explicit MappedSortedMap(const std::string& path) :
+			keys(NULL), values(NULL), count(0) {
+		OpenMapped(path);
+	}
+
+	// Name			: OpenMapped
+	// Description	: Maps a sorted image, replacing the current one
+	// Parameters	:
+	//	@path - the path of the image
+	// Return Value : None
+	// If the file can't be mapped, SnapshotIOException will be thrown, and
+	// if it isn't a sorted image of these types, SnapshotFormatException.
+	void OpenMapped(const std::string& path) {
+		static_assert(std::is_trivially_copyable<K>::value
+				&& std::is_trivially_copyable<V>::value,
+				"mapped keys and values must be trivially copyable");
+
+		Close();
+		file.Open(path);
+
+		SnapshotHeader header;
+		if (file.getSize() < sizeof(header)) {
+			file.Close();
+			throw SnapshotFormatException();
+		}
+		std::memcpy(&header, file.getData(), sizeof(header));
+		if (header.Matches<K, V>(SNAPSHOT_SORTED, file.getSize()) == false) {
+			file.Close();
+			throw SnapshotFormatException();
+		}
+
+		keys = reinterpret_cast<const K*>(file.getData() + header.keys_offset);
+		values = reinterpret_cast<const V*>(file.getData()
+				+ header.values_offset);
+		count = (int) header.count;
+	}
+
+	void Close() {
+		file.Close();
+		keys = NULL;
+		values = NULL;
+		count = 0;
+	}
+
+	// Name			: TryFind
+	// Description	: Searches the image for a key
+	// Parameters	:
+	//	@key - the key to search
+	// Return Value : pointer to the mapped value, or NULL if the key is
+	//					missing
+	const V* TryFind(const K& key) const {
+		int low = 0;
+		int high = count;
+
+		while (low < high) {
+			int middle = low + (high - low) / 2;
+			if (keys[middle] < key) {
+				low = middle + 1;
+			} else {
+				high = middle;
+			}
+		}
+
+		if (low < count && !(key < keys[low])) {
+			return &values[low];
+		}
+		return NULL;
+	}
+
+	// Name			: Find
+	// Description	: Searches the image for a key
+	// Parameters	:
+	//	@key - the key to search
+	// Return Value : reference to the mapped value
+	// 	If the key is missing, SnapshotKeyNotFoundException will be thrown.
+	const V& Find(const K& key) const {
+		const V* value = TryFind(key);
+		if (value == NULL) {
+			throw SnapshotKeyNotFoundException();
+		}
+		return *value;
+	}
+
+	bool Contains(const K& key) const {
+		return (TryFind(key) != NULL);
+	}
+
+	int getSize() const {
+		return count;
+	}
+};
+
+//
+//	Class		: MappedHashMap
+//	Description : Read-only map over a mapped hashed image (see
+//					Serialize). The hash functor must hash the
+//					keys the way the map which wrote the image did.
+//
+template<typename V, class K, class Hash = DefaultHash<K> > class MappedHashMap {
+private:
+	MappedFile file;
+	const unsigned char* ctrl;
+	const K* keys;
+	const V* values;
+	uint64_t capacity;
+	int count;
+	Hash hasher;
+
+	MappedHashMap(const MappedHashMap&);
+	MappedHashMap& operator=(const MappedHashMap&);
+
+public:
+	explicit MappedHashMap(const Hash& hash = Hash()) :
+			ctrl(NULL), keys(NULL), values(NULL), capacity(0), count(0), hasher(
+					hash) {
+	}
+
+	explicit MappedHashMap(const std::string& path, const Hash& hash =
+			Hash()) :
+			ctrl(NULL), keys(NULL), values(NULL), capacity(0), count(0), hasher(
+					hash) {
+		OpenMapped(path);
+	}
+
+	// Name			: OpenMapped
+	// Description	: Maps a hashed image, replacing the current one
+	// Parameters	:
+	//	@path - the path of the image
+	// Return Value : None
+	// If the file can't be mapped, SnapshotIOException will be thrown, and
+	// if it isn't a hashed image of these types and hash functor,
+	// SnapshotFormatException.
+	void OpenMapped(const std::string& path) {
+		static_assert(std::is_trivially_copyable<K>::value
+				&& std::is_trivially_copyable<V>::value,
+				"mapped keys and values must be trivially copyable");
+
+		Close();
+		file.Open(path);
+
+		SnapshotHeader header;
+		if (file.getSize() < sizeof(header)) {
+			file.Close();
+			throw SnapshotFormatException();
+		}
+		std::memcpy(&header, file.getData(), sizeof(header));
+		// A power of two capacity with an empty slot ends every probe
+		if (header.Matches<K, V>(SNAPSHOT_HASHED, file.getSize()) == false
+				|| header.capacity < SnapshotSlots::MIN_CAPACITY
+				|| (header.capacity & (header.capacity - 1)) != 0
+				|| header.count >= header.capacity
+				|| header.hash_check
+						!= SnapshotSlots::HashCheck<K>(hasher)) {
+			file.Close();
+			throw SnapshotFormatException();
+		}
+
+		ctrl = reinterpret_cast<const unsigned char*>(file.getData()
+				+ header.ctrl_offset);
+		keys = reinterpret_cast<const K*>(file.getData() + header.keys_offset);
+		values = reinterpret_cast<const V*>(file.getData()
+				+ header.values_offset);
+		capacity = header.capacity;
+		count = (int) header.count;
+	}
+
+	void Close() {
+		file.Close();
+		ctrl = NULL;
+		keys = NULL;
+		values = NULL;
+		capacity = 0;
+		count = 0;
+	}
+
+	// Name			: TryFind
+	// Description	: Searches the image for a key
+	// Parameters	:
+	//	@key - the key to search
+	// Return Value : pointer to the mapped value, or NULL if the key is
+	//					missing
+	const V* TryFind(const K& key) const {
+		if (capacity == 0) {
+			return NULL;
+		}
+
+		size_t hash = hasher(key);
+		uint64_t mask = capacity - 1;
+		unsigned char tag = SnapshotSlots::Tag(hash);
+
+		for (uint64_t i = SnapshotSlots::Home(hash, capacity);;
+				i = (i + 1) & mask) {
+			if (ctrl[i] == SnapshotSlots::EMPTY) {
+				return NULL;
+			}
+			if (ctrl[i] == tag && keys[i] == key) {
+				return &values[i];
+			}
+		}
+	}
+
+	// Name			: Find
+	// Description	: Searches the image for a key
+	// Parameters	:
+	//	@key - the key to search
+	// Return Value : reference to the mapped value
+	// 	If the key is missing, SnapshotKeyNotFoundException will be thrown.
+	const V& Find(const K& key) const {
+		const V* value = TryFind(key);
+		if (value == NULL) {
+			throw SnapshotKeyNotFoundException();
+		}
+		return *value;
+	}
+
+	bool Contains(const K& key) const {
+		return (TryFind(key) != NULL);
+	}
+
+	int getSize() const {
+		return count;
+	}
+};
+
+//
+//	Class		: HashedSnapshotVisitor
+//	Description : Adds the mappings a HashMap's ParallelForEach visits to
+//					a HashedSnapshotBuilder. The keys are hashed by the
+//					visiting threads, and only the table is locked.
+//
+template<class K, class V, class Hash> class HashedSnapshotVisitor {
+private:
+	HashedSnapshotBuilder<K, V>* builder;
+	const Hash* hasher;
+	std::mutex* lock;
+
+public:
+	HashedSnapshotVisitor(HashedSnapshotBuilder<K, V>* builder,
+			const Hash* hasher, std::mutex* lock) :
+			builder(builder), hasher(hasher), lock(lock) {
+	}
+
+	void operator()(const K& key, const V& value) const {
+		size_t hash = (size_t) (*hasher)(key);
+		std::lock_guard<std::mutex> guard(*lock);
+
+		builder->Add(hash, key, value);
+	}
+};
+
+// Name			: Serialize
+// Description	: Writes a sorted snapshot image of a tree - the keys in
+//					order, then the values in the same order - which
+//					MappedSortedMap maps and searches in place. The image
+//					replaces the file at once.
+// Parameters	:
+//	@tree - the tree
+//	@path - the path of the image
+// Return Value : None
+// If the image can't be written, SnapshotIOException will be thrown.
+template<class T, typename KeyType, class Allocator, class Augmentation,
+		class Stats, class Compare>
+void Serialize(
+		const AVLTree<T, KeyType, Allocator, Augmentation, Stats, Compare>& tree,
+		const std::string& path) {
+	typedef AVLTree<T, KeyType, Allocator, Augmentation, Stats, Compare> Tree;
+	static_assert(std::is_trivially_copyable<KeyType>::value
+			&& std::is_trivially_copyable<T>::value,
+			"serialized keys and data must be trivially copyable");
+	static_assert(std::is_same<Compare, DefaultCompare<KeyType> >::value,
+			"MappedSortedMap searches the keys by operator<");
+
+	// The iterators don't change the tree, they just aren't const
+	Tree& nodes = const_cast<Tree&>(tree);
+	SnapshotHeader header = SnapshotHeader::Make<KeyType, T>(SNAPSHOT_SORTED,
+			(uint64_t) tree.getSize(), (uint64_t) tree.getSize(), 0);
+	SnapshotWriter writer(path);
+
+	writer.Write(&header, sizeof(header));
+	writer.PadTo(header.keys_offset);
+	for (typename Tree::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+		writer.Write(&it.getKey(), sizeof(KeyType));
+	}
+	writer.PadTo(header.values_offset);
+	for (typename Tree::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+		writer.Write(&*it, sizeof(T));
+	}
+	writer.Commit();
+}
+
+// Name			: Serialize
+// Description	: Writes a hashed snapshot image of a map, of either
+//					storage, which MappedHashMap maps and searches in
+//					place. The image replaces the file at once.
+// Parameters	:
+//	@map	- the map
+//	@path	- the path of the image
+// Return Value : None
+// If the image can't be written, SnapshotIOException will be thrown.
+template<typename V, class K, class Storage, class Hash, class Allocator,
+		class Stats>
+void Serialize(const HashMap<V, K, Storage, Hash, Allocator, Stats>& map,
+		const std::string& path) {
+	typedef HashMap<V, K, Storage, Hash, Allocator, Stats> Map;
+	static_assert(std::is_trivially_copyable<K>::value
+			&& std::is_trivially_copyable<V>::value,
+			"serialized keys and values must be trivially copyable");
+
+	HashedSnapshotBuilder<K, V> builder((uint64_t) map.getSize());
+	std::mutex lock;
+
+	// The scan doesn't change the map, it just isn't const
+	const_cast<Map&>(map).ParallelForEach(
+			HashedSnapshotVisitor<K, V, Hash>(&builder, &map.getHasher(),
+					&lock));
+	builder.Write(path, SnapshotSlots::HashCheck<K>(map.getHasher()));
+}
+
+#endif /* SNAPSHOT_HPP_ */
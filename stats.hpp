@@ -0,0 +1,395 @@
+#ifndef STATS_HPP_
+#define STATS_HPP_
+
+//
+//	File		: stats.hpp
+//	Description	: Compile-time statistics policies of AVLTree and
+//					HashMap. The policy is the last template parameter of
+//					the containers, and it's hooks are called on every
+//					operation, search, rotation, rehash and allocation.
+//					NoStats	- the default, it's hooks are empty and inline,
+//							  so a container without statistics compiles
+//							  to the same code as before.
+//					ContainerStats - counts everything, and hands out a
+//							  StatsSnapshot through the container's
+//							  GetStats.
+//					The counters are relaxed atomics, since the executor
+//					threads of a whole-table operation (see parallel_task.hpp)
+//					record into the same counters.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+//
+//	Struct		: StatsSnapshot
+//	Description : A copy of the counters of a container, as returned by
+//					GetStats. The map fields are only set by HashMap.
+//
+struct StatsSnapshot {
+	//
+	// Constants
+	//
+	// Searches which visit more nodes (or probe more groups) than this are
+	// counted in the last histogram entry
+	static const int SEARCH_HISTOGRAM_SIZE = 32;
+
+	// Operation counts, the misses are included in the totals
+	unsigned long long inserts;
+	unsigned long long duplicate_inserts;
+	unsigned long long lookups;
+	unsigned long long lookup_misses;
+	unsigned long long erases;
+	unsigned long long erase_misses;
+	// KeyNotFound and KeyAlreadyExists exceptions thrown by the container
+	unsigned long long exceptions;
+
+	// search_lengths[i] is the number of searches from a tree root which
+	// visited i nodes, or probes of a flat table which read i groups
+	unsigned long long search_lengths[SEARCH_HISTOGRAM_SIZE];
+	unsigned long long searches;
+	unsigned long long search_length_total;
+	unsigned long long rotations;
+
+	// Resizes, and the time spent moving mappings between tables. The
+	// longest pause is the longest single call which moved mappings.
+	unsigned long long rehashes;
+	unsigned long long rehash_nanoseconds;
+	unsigned long long max_rehash_nanoseconds;
+
+	// Tree nodes, and all the memory allocated by the container
+	long long live_nodes;
+	long long live_bytes;
+
+	// Map state when the snapshot was taken
+	long long size;
+	long long buckets;
+	double load_factor;
+
+	StatsSnapshot() :
+			inserts(0), duplicate_inserts(0), lookups(0), lookup_misses(0),
+					erases(0), erase_misses(0), exceptions(0), searches(0),
+					search_length_total(0), rotations(0), rehashes(0),
+					rehash_nanoseconds(0), max_rehash_nanoseconds(0),
+					live_nodes(0), live_bytes(0), size(0), buckets(0),
+					load_factor(0) {
+		for (int i = 0; i < SEARCH_HISTOGRAM_SIZE; i++) {
+			search_lengths[i] = 0;
+		}
+	}
+
+	// Name			: MeanSearchLength
+	// Description	: Returns the average number of nodes (or groups) read
+	//					by a search.
+	// Parameters	: None
+	// Return Value : the mean, 0 if nothing was searched
+	double MeanSearchLength() const {
+		return (searches == 0) ?
+				0 : (double) search_length_total / (double) searches;
+	}
+};
+
+//
+//	Class		: NoStats
+//	Description : Statistics policy which records nothing. Link is the
+//					policy of the buckets of a HashMap, see StatsLink.
+//
+struct NoStats {
+	static const bool ENABLED = false;
+	typedef NoStats Link;
+
+	NoStats GetLink() const {
+		return NoStats();
+	}
+
+	static long long Now() {
+		return 0;
+	}
+
+	void RecordInsert(bool) const {
+	}
+
+	void RecordLookup(bool) const {
+	}
+
+	void RecordErase(bool) const {
+	}
+
+	void RecordException() const {
+	}
+
+	void RecordSearch(int) const {
+	}
+
+	void RecordRotation() const {
+	}
+
+	void RecordMemory(long long, long long) const {
+	}
+
+	void RecordRehash(long long) const {
+	}
+
+	void RecordMigration(long long) const {
+	}
+
+	StatsSnapshot Snapshot() const {
+		return StatsSnapshot();
+	}
+};
+
+class StatsLink;
+
+//
+//	Class		: ContainerStats
+//	Description : Statistics policy which counts everything. The Record
+//					methods are const, since searches record too.
+//
+class ContainerStats {
+private:
+	typedef std::atomic<unsigned long long> Counter;
+
+	mutable Counter inserts;
+	mutable Counter duplicate_inserts;
+	mutable Counter lookups;
+	mutable Counter lookup_misses;
+	mutable Counter erases;
+	mutable Counter erase_misses;
+	mutable Counter exceptions;
+	mutable Counter search_lengths[StatsSnapshot::SEARCH_HISTOGRAM_SIZE];
+	mutable Counter search_length_total;
+	mutable Counter rotations;
+	mutable Counter rehashes;
+	mutable Counter rehash_nanoseconds;
+	mutable Counter max_rehash_nanoseconds;
+	mutable std::atomic<long long> live_nodes;
+	mutable std::atomic<long long> live_bytes;
+
+	ContainerStats(const ContainerStats&);
+	ContainerStats& operator=(const ContainerStats&);
+
+	static void add(Counter& counter, unsigned long long amount) {
+		counter.fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	static unsigned long long read(const Counter& counter) {
+		return counter.load(std::memory_order_relaxed);
+	}
+
+	// Name			: recordPause
+	// Description	: Adds the duration of a call which moved mappings
+	// Parameters	:
+	//	@nanoseconds - the duration
+	// Return Value : None
+	void recordPause(long long nanoseconds) const {
+		unsigned long long duration = (nanoseconds < 0) ?
+				0 : (unsigned long long) nanoseconds;
+
+		add(rehash_nanoseconds, duration);
+		// Only the thread which owns the container resizes it
+		if (read(max_rehash_nanoseconds) < duration) {
+			max_rehash_nanoseconds.store(duration, std::memory_order_relaxed);
+		}
+	}
+
+public:
+	static const bool ENABLED = true;
+	typedef StatsLink Link;
+
+	ContainerStats() :
+			inserts(0), duplicate_inserts(0), lookups(0), lookup_misses(0),
+					erases(0), erase_misses(0), exceptions(0),
+					search_length_total(0), rotations(0), rehashes(0),
+					rehash_nanoseconds(0), max_rehash_nanoseconds(0),
+					live_nodes(0), live_bytes(0) {
+		for (int i = 0; i < StatsSnapshot::SEARCH_HISTOGRAM_SIZE; i++) {
+			search_lengths[i].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	inline StatsLink GetLink() const;
+
+	// Name			: Now
+	// Description	: Returns the time of a steady clock, for the rehash
+	//					durations.
+	// Parameters	: None
+	// Return Value : the time in nanoseconds
+	static long long Now() {
+		return (long long) std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void RecordInsert(bool inserted) const {
+		add(inserts, 1);
+		if (inserted == false) {
+			add(duplicate_inserts, 1);
+		}
+	}
+
+	void RecordLookup(bool found) const {
+		add(lookups, 1);
+		if (found == false) {
+			add(lookup_misses, 1);
+		}
+	}
+
+	void RecordErase(bool erased) const {
+		add(erases, 1);
+		if (erased == false) {
+			add(erase_misses, 1);
+		}
+	}
+
+	void RecordException() const {
+		add(exceptions, 1);
+	}
+
+	// Name			: RecordSearch
+	// Description	: Counts a search in the path length histogram
+	// Parameters	:
+	//	@length - the number of nodes visited (or groups probed)
+	// Return Value : None
+	void RecordSearch(int length) const {
+		int index = (length < StatsSnapshot::SEARCH_HISTOGRAM_SIZE) ?
+				length : StatsSnapshot::SEARCH_HISTOGRAM_SIZE - 1;
+
+		add(search_lengths[index], 1);
+		add(search_length_total, (unsigned long long) length);
+	}
+
+	void RecordRotation() const {
+		add(rotations, 1);
+	}
+
+	// Name			: RecordMemory
+	// Description	: Counts allocated (positive) or freed (negative) memory
+	// Parameters	:
+	//	@nodes - the change in the number of tree nodes
+	//	@bytes - the change in the number of bytes
+	// Return Value : None
+	void RecordMemory(long long nodes, long long bytes) const {
+		live_nodes.fetch_add(nodes, std::memory_order_relaxed);
+		live_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	// Name			: RecordRehash
+	// Description	: Counts a resize of the table
+	// Parameters	:
+	//	@nanoseconds - the duration of the resize call
+	// Return Value : None
+	void RecordRehash(long long nanoseconds) const {
+		add(rehashes, 1);
+		recordPause(nanoseconds);
+	}
+
+	// Name			: RecordMigration
+	// Description	: Adds the duration of a call which moved mappings of a
+	//					resize in progress (see HashMap::SetIncrementalResize)
+	// Parameters	:
+	//	@nanoseconds - the duration
+	// Return Value : None
+	void RecordMigration(long long nanoseconds) const {
+		recordPause(nanoseconds);
+	}
+
+	// Name			: Snapshot
+	// Description	: Copies the counters. Counters which are updated at the
+	//					same time may be read before or after the update.
+	// Parameters	: None
+	// Return Value : the snapshot
+	StatsSnapshot Snapshot() const {
+		StatsSnapshot res;
+
+		res.inserts = read(inserts);
+		res.duplicate_inserts = read(duplicate_inserts);
+		res.lookups = read(lookups);
+		res.lookup_misses = read(lookup_misses);
+		res.erases = read(erases);
+		res.erase_misses = read(erase_misses);
+		res.exceptions = read(exceptions);
+		for (int i = 0; i < StatsSnapshot::SEARCH_HISTOGRAM_SIZE; i++) {
+			res.search_lengths[i] = read(search_lengths[i]);
+			res.searches += res.search_lengths[i];
+		}
+		res.search_length_total = read(search_length_total);
+		res.rotations = read(rotations);
+		res.rehashes = read(rehashes);
+		res.rehash_nanoseconds = read(rehash_nanoseconds);
+		res.max_rehash_nanoseconds = read(max_rehash_nanoseconds);
+		res.live_nodes = live_nodes.load(std::memory_order_relaxed);
+		res.live_bytes = live_bytes.load(std::memory_order_relaxed);
+		return res;
+	}
+};
+
+//
+//	Class		: StatsLink
+//	Description : Statistics policy of the buckets of a HashMap with
+//					ContainerStats. It forwards the searches, rotations and
+//					allocations of a bucket to the map's counters. The
+//					operations are counted once, by the map, so the
+//					operation hooks of a bucket are empty.
+//
+class StatsLink {
+private:
+	const ContainerStats* target;
+
+public:
+	static const bool ENABLED = true;
+	typedef StatsLink Link;
+
+	explicit StatsLink(const ContainerStats* target = NULL) :
+			target(target) {
+	}
+
+	StatsLink GetLink() const {
+		return *this;
+	}
+
+	static long long Now() {
+		return ContainerStats::Now();
+	}
+
+	void RecordInsert(bool) const {
+	}
+
+	void RecordLookup(bool) const {
+	}
+
+	void RecordErase(bool) const {
+	}
+
+	void RecordException() const {
+	}
+
+	void RecordSearch(int length) const {
+		target->RecordSearch(length);
+	}
+
+	void RecordRotation() const {
+		target->RecordRotation();
+	}
+
+	void RecordMemory(long long nodes, long long bytes) const {
+		target->RecordMemory(nodes, bytes);
+	}
+
+	void RecordRehash(long long nanoseconds) const {
+		target->RecordRehash(nanoseconds);
+	}
+
+	void RecordMigration(long long nanoseconds) const {
+		target->RecordMigration(nanoseconds);
+	}
+
+	StatsSnapshot Snapshot() const {
+		return target->Snapshot();
+	}
+};
+
+inline StatsLink ContainerStats::GetLink() const {
+	return StatsLink(this);
+}
+
+#endif /* STATS_HPP_ */
@@ -0,0 +1,126 @@
+//
+//	File		: avltree_test.cpp
+//	Description	: Tests of AVLTree::Distribute when the selector throws:
+//					the nodes which weren't moved stay in the source tree,
+//					and a HashMap resize whose hash throws keeps every
+//					mapping it holds reachable.
+//
+
+#include <exception>
+#include "check.hpp"
+#include "avltree.hpp"
+#include "hash_map.hpp"
+#include <cstddef>
+#include <stdexcept>
+
+//
+// Constants
+//
+static const int TREE_SIZE = 1000;
+static const int THROW_AT = 500;
+static const int MAP_SIZE = 5000;
+static const int MIGRATE_STEP = 2;
+
+typedef AVLTree<int, int> Tree;
+
+//
+//	Struct		: ThrowingSelector
+//	Description : Sends the odd keys to one tree and the even keys to
+//					another, and throws on the THROW_AT-th call.
+//
+struct ThrowingSelector {
+	Tree* odd;
+	Tree* even;
+	int* calls;
+
+	Tree* operator()(const int& key) const {
+		if (++*calls == THROW_AT) {
+			throw std::runtime_error("selector failed");
+		}
+		return ((key & 1) != 0) ? odd : even;
+	}
+};
+
+//
+//	Struct		: FlakyHash
+//	Description : Hash which throws once, after a number of calls set by
+//					the test.
+//
+struct FlakyHash {
+	static int& countdown() {
+		static int calls = 0;
+		return calls;
+	}
+
+	size_t operator()(int key) const {
+		if (countdown() > 0 && --countdown() == 0) {
+			throw std::runtime_error("hash failed");
+		}
+		return (size_t) key * 2654435761u;
+	}
+};
+
+static void testDistributeThrows() {
+	Tree source;
+	Tree odd;
+	Tree even;
+	int calls = 0;
+	bool thrown = false;
+
+	for (int i = 0; i < TREE_SIZE; i++) {
+		source.Insert(i, i);
+	}
+
+	ThrowingSelector select = { &odd, &even, &calls };
+	try {
+		source.Distribute(select);
+	} catch (std::runtime_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	CHECK(odd.getSize() + even.getSize() == THROW_AT - 1);
+	CHECK(source.getSize() == TREE_SIZE - (THROW_AT - 1));
+	CHECK(source.isBalanced());
+
+	int found = 0;
+	for (int i = 0; i < TREE_SIZE; i++) {
+		if (source.TryFind(i) != NULL || odd.TryFind(i) != NULL
+				|| even.TryFind(i) != NULL) {
+			found++;
+		}
+	}
+	CHECK(found == TREE_SIZE);
+}
+
+static void testMigrationHashThrows() {
+	HashMap<int, int, ChainedStorage, FlakyHash> map;
+	int failures = 0;
+
+	map.SetIncrementalResize(MIGRATE_STEP);
+	for (int i = 0; i < MAP_SIZE; i++) {
+		if (i % 1000 == 999) {
+			FlakyHash::countdown() = 3;
+		}
+		try {
+			map.Insert(i, i);
+		} catch (std::runtime_error&) {
+			failures++;
+		}
+	}
+	FlakyHash::countdown() = 0;
+	CHECK(failures > 0);
+
+	int found = 0;
+	for (int i = 0; i < MAP_SIZE; i++) {
+		if (map.TryFind(i) != NULL) {
+			found++;
+		}
+	}
+	CHECK(found == map.getSize());
+}
+
+int main() {
+	testDistributeThrows();
+	testMigrationHashThrows();
+	return CheckFailures();
+}
@@ -0,0 +1,36 @@
+#ifndef TESTS_CHECK_HPP_
+#define TESTS_CHECK_HPP_
+
+//
+//	File		: check.hpp
+//	Description	: Minimal checks of the tests. CHECK reports a failed
+//					condition and counts it, and a test's main returns
+//					CheckFailures(), so ctest sees the failure. The checks
+//					run in release builds too, unlike assert.
+//
+
+#include <cstdio>
+
+// Name			: CheckFailures
+// Description	: Returns the counter of the failed checks
+inline int& CheckFailures() {
+	static int failures = 0;
+	return failures;
+}
+
+// Name			: CheckReport
+// Description	: Reports a failed check
+// Parameters	:
+//	@condition	- the text of the condition
+//	@file		- the source file of the check
+//	@line		- the line of the check
+// Return Value : None
+inline void CheckReport(const char* condition, const char* file, int line) {
+	std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+	CheckFailures()++;
+}
+
+#define CHECK(condition) \
+	((condition) ? (void) 0 : CheckReport(#condition, __FILE__, __LINE__))
+
+#endif /* TESTS_CHECK_HPP_ */
@@ -0,0 +1,205 @@
+//
+//	File		: executor_test.cpp
+//	Description	: Tests of ThreadPool: a ParallelFor called from a chunk
+//					runs serially on the workers and on the calling thread
+//					alike, instead of waiting for it's own outer call, and
+//					the calling thread leaves the pool once it's done.
+//
+
+#include <exception>
+#include "check.hpp"
+#include "executor.hpp"
+#include "hash_map.hpp"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+//
+// Constants
+//
+static const int THREADS = 4;
+static const int OUTER_COUNT = 64;
+static const int INNER_COUNT = 4096;
+static const int INNER_GRAIN = 64;
+static const int MAP_SIZE = 20000;
+
+//
+//	Class		: SumTask
+//	Description : Adds the indices of it's range to a total
+//
+class SumTask: public ParallelTask {
+private:
+	std::atomic<long long>* total;
+
+public:
+	explicit SumTask(std::atomic<long long>* total) :
+			total(total) {
+	}
+
+	void Run(int first, int last) {
+		long long sum = 0;
+		for (int i = first; i < last; i++) {
+			sum += i;
+		}
+		total->fetch_add(sum, std::memory_order_relaxed);
+	}
+};
+
+//
+//	Class		: NestedTask
+//	Description : Every chunk runs a SumTask on the same pool, and counts
+//					the chunks the calling thread ran.
+//
+class NestedTask: public ParallelTask {
+private:
+	ThreadPool* pool;
+	std::atomic<long long>* total;
+	std::atomic<int>* caller_chunks;
+	std::thread::id caller;
+
+public:
+	NestedTask(ThreadPool* pool, std::atomic<long long>* total,
+			std::atomic<int>* caller_chunks) :
+			pool(pool), total(total), caller_chunks(caller_chunks), caller(
+					std::this_thread::get_id()) {
+	}
+
+	void Run(int first, int last) {
+		for (int i = first; i < last; i++) {
+			if (std::this_thread::get_id() == caller) {
+				caller_chunks->fetch_add(1, std::memory_order_relaxed);
+			}
+			SumTask inner(total);
+			pool->ParallelFor(inner, INNER_COUNT, INNER_GRAIN);
+		}
+	}
+};
+
+//
+//	Class		: ThrowingTask
+//	Description : Every chunk throws
+//
+class ThrowingTask: public ParallelTask {
+public:
+	void Run(int, int) {
+		throw std::runtime_error("chunk failed");
+	}
+};
+
+//
+//	Class		: ChunkTask
+//	Description : Records the longest chunk it was given
+//
+class ChunkTask: public ParallelTask {
+private:
+	std::atomic<int>* longest;
+
+public:
+	explicit ChunkTask(std::atomic<int>* longest) :
+			longest(longest) {
+	}
+
+	void Run(int first, int last) {
+		int length = last - first;
+		int seen = longest->load(std::memory_order_relaxed);
+		while (seen < length
+				&& !longest->compare_exchange_weak(seen, length,
+						std::memory_order_relaxed)) {
+		}
+	}
+};
+
+// Name			: longestChunk
+// Description	: Runs a ChunkTask on the pool from the calling thread
+// Parameters	:
+//	@pool - the pool
+// Return Value : the longest chunk, the whole range if it ran serially
+static int longestChunk(ThreadPool& pool) {
+	std::atomic<int> longest(0);
+	ChunkTask task(&longest);
+
+	pool.ParallelFor(task, 100, 10);
+	return longest.load();
+}
+
+//
+//	Struct		: OddKey
+//	Description : EraseIf predicate of the odd keys
+//
+struct OddKey {
+	bool operator()(const int& key, const int&) const {
+		return (key % 2) != 0;
+	}
+};
+
+//
+//	Struct		: EraseFromVisitor
+//	Description : ParallelForEach visitor which, on the calling thread,
+//					runs EraseIf on another map of the same pool once.
+//
+struct EraseFromVisitor {
+	HashMap<int, int>* other;
+	std::atomic<bool>* erased;
+	std::thread::id caller;
+
+	void operator()(const int&, int&) const {
+		if (std::this_thread::get_id() == caller
+				&& erased->exchange(true) == false) {
+			other->EraseIf(OddKey());
+		}
+	}
+};
+
+static void testNestedParallelFor() {
+	ThreadPool pool(THREADS);
+	std::atomic<long long> total(0);
+	std::atomic<int> caller_chunks(0);
+	NestedTask task(&pool, &total, &caller_chunks);
+
+	pool.ParallelFor(task, OUTER_COUNT, 1);
+	CHECK(total.load() == (long long) OUTER_COUNT * INNER_COUNT
+			* (INNER_COUNT - 1) / 2);
+	// Back on the pool's own calling thread, ParallelFor splits again
+	CHECK(longestChunk(pool) <= 10);
+}
+
+static void testCallerLeavesPoolAfterThrow() {
+	ThreadPool pool(THREADS);
+	ThrowingTask task;
+	bool thrown = false;
+
+	try {
+		pool.ParallelFor(task, OUTER_COUNT, 1);
+	} catch (std::runtime_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	CHECK(longestChunk(pool) <= 10);
+}
+
+static void testNestedContainerCall() {
+	ThreadPool pool(THREADS);
+	HashMap<int, int> outer;
+	HashMap<int, int> other;
+
+	outer.SetExecutor(&pool);
+	other.SetExecutor(&pool);
+	for (int i = 0; i < MAP_SIZE; i++) {
+		outer.Insert(i, i);
+		other.Insert(i, i);
+	}
+
+	std::atomic<bool> erased(false);
+	EraseFromVisitor visitor = { &other, &erased, std::this_thread::get_id() };
+	outer.ParallelForEach(visitor);
+	if (erased.load()) {
+		CHECK(other.getSize() == MAP_SIZE / 2);
+	}
+}
+
+int main() {
+	testNestedParallelFor();
+	testCallerLeavesPoolAfterThrow();
+	testNestedContainerCall();
+	return CheckFailures();
+}
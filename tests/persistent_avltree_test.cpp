@@ -0,0 +1,384 @@
+//
+//	File		: persistent_avltree_test.cpp
+//	Description	: Tests of PersistentAVLTree. Random writes are checked
+//					against std::map, while snapshots taken along the way
+//					must keep the contents they had when they were taken.
+//					Reader threads scan the versions the writer hands them
+//					and drop them while the writer goes on, and every node
+//					must be freed once the last version is dropped.
+//
+
+#include <exception>
+#include "check.hpp"
+#include "persistent_avltree.hpp"
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+//
+// Constants
+//
+static const unsigned SEED = 20240601;
+static const int RANDOM_STEPS = 200000;
+static const int KEY_RANGE = 2000;
+static const int SNAPSHOT_EVERY = 1000;
+static const int KEPT_SNAPSHOTS = 20;
+static const int READERS = 3;
+static const int READER_KEYS = 4096;
+static const int WRITER_ROUNDS = 200;
+
+// Name			: LiveNodes
+// Description	: Returns the number of blocks held by CountingNodeAllocator
+static std::atomic<long long>& LiveNodes() {
+	static std::atomic<long long> nodes(0);
+	return nodes;
+}
+
+//
+//	Class		: CountingNodeAllocator
+//	Description : std::allocator which counts the blocks it holds, from
+//					any thread.
+//
+template<class T> class CountingNodeAllocator {
+public:
+	typedef T value_type;
+
+	CountingNodeAllocator() {
+	}
+
+	template<class U>
+	CountingNodeAllocator(const CountingNodeAllocator<U>&) {
+	}
+
+	T* allocate(size_t count) {
+		LiveNodes().fetch_add((long long) count);
+		return std::allocator<T>().allocate(count);
+	}
+
+	void deallocate(T* block, size_t count) {
+		LiveNodes().fetch_sub((long long) count);
+		std::allocator<T>().deallocate(block, count);
+	}
+
+	template<class U>
+	bool operator==(const CountingNodeAllocator<U>&) const {
+		return true;
+	}
+
+	template<class U>
+	bool operator!=(const CountingNodeAllocator<U>&) const {
+		return false;
+	}
+};
+
+template<class T> struct AllocatorThreadSafety<CountingNodeAllocator<T> > : std::true_type {
+};
+
+typedef PersistentAVLTree<long, int, CountingNodeAllocator<long> > Tree;
+typedef std::map<int, long> Reference;
+
+//
+//	Struct		: Collector
+//	Description : Visitor which appends the mappings it visits
+//
+struct Collector {
+	std::vector<std::pair<int, long> >* out;
+
+	void operator()(const int& key, const long& data) const {
+		out->push_back(std::make_pair(key, data));
+	}
+};
+
+//
+//	Struct		: Summer
+//	Description : Visitor which sums the data it visits
+//
+struct Summer {
+	long long* sum;
+	int* count;
+
+	void operator()(const int&, const long& data) const {
+		*sum += data;
+		(*count)++;
+	}
+};
+
+// Name			: matches
+// Description	: Tests that a version holds exactly the reference mappings
+// Parameters	:
+//	@version	- the version
+//	@reference	- the expected mappings
+// Return Value : true if they're equal, in the same order
+static bool matches(const Tree::Version& version, const Reference& reference) {
+	std::vector<std::pair<int, long> > out;
+	Collector collector = { &out };
+
+	version.ForEach(collector);
+	if (version.getSize() != (int) reference.size()
+			|| out.size() != reference.size()) {
+		return false;
+	}
+
+	size_t i = 0;
+	for (Reference::const_iterator it = reference.begin();
+			it != reference.end(); ++it, ++i) {
+		if (out[i].first != it->first || out[i].second != it->second) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void testAgainstMap() {
+	std::mt19937 engine(SEED);
+	Tree tree;
+	Reference reference;
+	std::vector<Tree::Version> versions;
+	std::vector<Reference> expected;
+
+	for (int step = 0; step < RANDOM_STEPS; step++) {
+		int key = (int) (engine() % KEY_RANGE);
+		switch (engine() % 4) {
+		case 0:
+			CHECK(tree.TryEmplace(key, (long) step)
+					== reference.insert(std::make_pair(key, (long) step)).second);
+			break;
+		case 1: {
+			long removed = -1;
+			Reference::iterator it = reference.find(key);
+			bool erased = tree.Erase(key, &removed);
+			CHECK(erased == (it != reference.end()));
+			if (it != reference.end()) {
+				CHECK(removed == it->second);
+				reference.erase(it);
+			}
+			break;
+		}
+		case 2:
+			CHECK(tree.InsertOrAssign(key, (long) -step)
+					== (reference.count(key) == 0));
+			reference[key] = -step;
+			break;
+		default: {
+			const long* data = tree.TryFind(key);
+			Reference::iterator it = reference.find(key);
+			CHECK((data != NULL) == (it != reference.end()));
+			if (data != NULL && it != reference.end()) {
+				CHECK(*data == it->second);
+			}
+			break;
+		}
+		}
+		CHECK(tree.getSize() == (int) reference.size());
+
+		if (step % SNAPSHOT_EVERY == 0) {
+			CHECK(tree.isBalanced());
+			versions.push_back(tree.Snapshot());
+			expected.push_back(reference);
+			if ((int) versions.size() > KEPT_SNAPSHOTS) {
+				size_t victim = engine() % versions.size();
+				CHECK(matches(versions[victim], expected[victim]));
+				versions.erase(versions.begin() + victim);
+				expected.erase(expected.begin() + victim);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < versions.size(); i++) {
+		CHECK(matches(versions[i], expected[i]));
+	}
+	CHECK(matches(tree.Snapshot(), reference));
+
+	// RangeScan against the reference bounds
+	std::vector<std::pair<int, long> > out;
+	Collector collector = { &out };
+	int visited = tree.RangeScan(KEY_RANGE / 4, KEY_RANGE / 2, collector);
+	int in_range = 0;
+	for (Reference::iterator it = reference.lower_bound(KEY_RANGE / 4);
+			it != reference.end() && it->first < KEY_RANGE / 2; ++it) {
+		in_range++;
+	}
+	CHECK(visited == in_range && (int) out.size() == in_range);
+}
+
+static void testCopiesAndExceptions() {
+	Tree tree;
+	for (int i = 0; i < 100; i++) {
+		tree.Insert(i, i);
+	}
+
+	Tree::Version version = tree.Snapshot();
+	Tree copy(tree);
+	copy.Clear();
+	CHECK(copy.Empty() && tree.getSize() == 100);
+
+	Tree restored(version);
+	restored.Delete(7);
+	CHECK(version.Contains(7) && !restored.Contains(7) && tree.Contains(7));
+
+	copy = restored;
+	CHECK(copy.getSize() == 99 && !copy.Contains(7));
+
+	bool thrown = false;
+	try {
+		tree.Insert(1, 1);
+	} catch (AVLTreeKeyAlreadyExistsException&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+
+	thrown = false;
+	try {
+		version.Find(-1);
+	} catch (AVLTreeKeyNotFoundException&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+
+	PersistentAVLTree<std::string, std::string> strings;
+	strings.Insert("b", "B");
+	strings.Insert("a", "A");
+	PersistentAVLTree<std::string, std::string>::Version before =
+			strings.Snapshot();
+	strings.Delete("a");
+	strings.InsertOrAssign("b", std::string("C"));
+	CHECK(before.Find("a") == "A" && before.Find("b") == "B");
+	CHECK(!strings.Contains("a") && strings.Find("b") == "C");
+}
+
+//
+//	Struct		: Mailbox
+//	Description : The latest version the writer published to the readers
+//
+struct Mailbox {
+	std::mutex lock;
+	Tree::Version latest;
+	std::atomic<bool> done;
+
+	Mailbox() :
+			done(false) {
+	}
+};
+
+//
+//	Class		: Reader
+//	Description : Scans the latest version until the writer is done. A
+//					version of the writer always holds READER_KEYS keys
+//					whose data sums to the same total.
+//
+class Reader {
+private:
+	Mailbox* mailbox;
+	std::atomic<int>* failures;
+
+public:
+	Reader(Mailbox* mailbox, std::atomic<int>* failures) :
+			mailbox(mailbox), failures(failures) {
+	}
+
+	void operator()() const {
+		const long long expected = (long long) READER_KEYS * (READER_KEYS - 1)
+				/ 2;
+
+		while (mailbox->done.load() == false) {
+			Tree::Version version;
+			{
+				std::lock_guard<std::mutex> guard(mailbox->lock);
+				version = mailbox->latest;
+			}
+
+			long long sum = 0;
+			int count = 0;
+			Summer summer = { &sum, &count };
+			version.ForEach(summer);
+			if (version.Empty() == false
+					&& (count != READER_KEYS || sum != expected)) {
+				failures->fetch_add(1);
+			}
+		}
+	}
+};
+
+static void testConcurrentReaders() {
+	long long before = LiveNodes().load();
+	{
+		Tree tree;
+		for (int i = 0; i < READER_KEYS; i++) {
+			tree.Insert(i, i);
+		}
+
+		Mailbox mailbox;
+		std::atomic<int> failures(0);
+		std::vector<std::thread> readers;
+		for (int i = 0; i < READERS; i++) {
+			readers.push_back(std::thread(Reader(&mailbox, &failures)));
+		}
+
+		// Every round moves each key to a new key with the same data, and
+		// publishes the result, so the readers' sums never change
+		int base = 0;
+		for (int round = 0; round < WRITER_ROUNDS; round++) {
+			for (int i = 0; i < READER_KEYS; i += 64) {
+				long data = tree.Find(base + i);
+				tree.Delete(base + i);
+				tree.Insert(base + READER_KEYS + i, data);
+			}
+			for (int i = 0; i < READER_KEYS; i++) {
+				if (i % 64 != 0) {
+					long data = tree.Find(base + i);
+					tree.Delete(base + i);
+					tree.Insert(base + READER_KEYS + i, data);
+				}
+			}
+			base += READER_KEYS;
+
+			std::lock_guard<std::mutex> guard(mailbox.lock);
+			mailbox.latest = tree.Snapshot();
+		}
+		mailbox.done.store(true);
+		for (size_t i = 0; i < readers.size(); i++) {
+			readers[i].join();
+		}
+
+		CHECK(failures.load() == 0);
+		CHECK(tree.isBalanced() && tree.getSize() == READER_KEYS);
+	}
+	// The tree and the last version are gone, and so are all the nodes
+	CHECK(LiveNodes().load() == before);
+}
+
+static void testPathCopies() {
+	Tree tree;
+	for (int i = 0; i < READER_KEYS; i++) {
+		tree.Insert(i, i);
+	}
+
+	// A write after a snapshot copies about one path, not the tree
+	Tree::Version version = tree.Snapshot();
+	long long before = LiveNodes().load();
+	tree.InsertOrAssign(READER_KEYS / 2, (long) -1);
+	long long copied = LiveNodes().load() - before;
+	CHECK(copied > 0 && copied <= 2 * 13);
+	CHECK(version.Find(READER_KEYS / 2) == READER_KEYS / 2);
+
+	// Without a snapshot the path is owned, and changed in place
+	version = Tree::Version();
+	before = LiveNodes().load();
+	tree.InsertOrAssign(READER_KEYS / 2, (long) -2);
+	CHECK(LiveNodes().load() == before);
+}
+
+int main() {
+	testAgainstMap();
+	testCopiesAndExceptions();
+	testConcurrentReaders();
+	testPathCopies();
+	CHECK(LiveNodes().load() == 0);
+	return CheckFailures();
+}